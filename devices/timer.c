@@ -2,13 +2,17 @@
 
 #include <debug.h>
 #include <inttypes.h>
+#include <pheap.h>
 #include <round.h>
 #include <stdio.h>
 
+#include "intrinsic.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/lapic.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -22,11 +26,138 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* Value of TICKS when the timer interrupt last ran. */
+static int64_t last_tick_handled;
+
+/* If false (default), the PIT interrupts TIMER_FREQ times per
+   second.  If true, the PIT is run in one-shot mode and
+   programmed for the next tick at which something is due: a
+   timer expiring or the running thread's time slice ending.
+   Ticks that pass without an interrupt are credited from the PIT
+   counter, so timer_ticks() keeps counting.  Controlled by
+   kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* 8254 input frequency and the resulting counts per tick. */
+#define PIT_HZ 1193180
+#define PIT_COUNTS_PER_TICK ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Longest one-shot period, in ticks, that fits the 16-bit
+   counter. */
+#define ONESHOT_MAX_TICKS (0xffff / PIT_COUNTS_PER_TICK)
+
+/* One-shot state.  A period starts ONESHOT_PHASE counts past a
+   tick boundary and lasts ONESHOT_COUNT counts, ending exactly on
+   tick ONESHOT_DEADLINE. */
+static bool oneshot_active;       /* PIT in one-shot mode? */
+static uint32_t oneshot_count;    /* Count programmed into the PIT. */
+static uint32_t oneshot_phase;    /* Counts since the last tick boundary. */
+static int64_t oneshot_credited;  /* Whole ticks credited this period. */
+static int64_t oneshot_deadline;  /* Tick at which the PIT fires. */
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+#define NS_PER_SEC 1000000000LL
+#define NS_PER_TICK (NS_PER_SEC / TIMER_FREQ)
+
+/* TSC clocksource.  timer_calibrate() measures the TSC against
+   TSC_CALIBRATE_TICKS PIT ticks; from then on timer_now_ns()
+   reads the TSC instead of counting ticks.  Cycles convert to
+   nanoseconds as (cycles * TSC_MULT) >> 32. */
+#define TSC_CALIBRATE_TICKS 5
+static uint64_t tsc_hz;            /* TSC frequency, 0 until calibrated. */
+static uint64_t tsc_mult;          /* Nanoseconds per cycle, 32.32 fixed point. */
+static uint64_t tsc_base;          /* TSC value at tick 0. */
+
+/* High-resolution sleeps.  A sub-tick sleep blocks the thread on
+   HR_SLEEPERS, earliest deadline first, and the local APIC timer
+   is programmed in one-shot mode for the earliest deadline.
+   Sleeps shorter than HR_SLEEP_MIN_NS cost less than the two
+   context switches and the interrupt, so they spin on the TSC
+   instead, as do all sub-tick sleeps if there is no local APIC. */
+#define HR_SLEEP_MIN_NS 20000
+static uint64_t apic_timer_hz;     /* APIC timer frequency, 0 if unusable. */
+static struct pheap hr_sleepers;   /* Threads in hr_sleep(). */
+
+/* A thread in hr_sleep().  Lives on the sleeping thread's stack. */
+struct hr_sleeper {
+    struct pheap_elem elem;        /* hr_sleepers element. */
+    int64_t deadline;              /* timer_now_ns() at which to wake. */
+    struct thread *thread;         /* Sleeping thread. */
+};
+
+/* APIC ticks.  When interrupts go through the I/O APIC,
+   timer_calibrate() masks the PIT and lets the local APIC timer
+   drive timer ticks as well as hr_sleep().  With no sleeper and
+   without -tickless the APIC timer runs in periodic mode, one
+   interrupt per tick and no reprogramming.  Otherwise it runs in
+   one-shot mode, programmed for the earlier of the first
+   sleeper's deadline and the next tick at which something is due:
+   the next tick, or with -tickless the next timer or time-slice
+   expiry.  In one-shot mode ticks are credited from the TSC. */
+static bool apic_tick;             /* APIC timer drives ticks? */
+static bool apic_periodic;         /* ...in periodic mode? */
+static int64_t apic_next_tick_ns;  /* timer_now_ns() at tick TICKS + 1. */
+static int64_t apic_event_tick;    /* Tick the timer is set for. */
+
+/* Hierarchical timer wheel.
+
+   Armed timers live in WHEEL_LEVELS levels of WHEEL_SIZE slots.
+   Level 0 has one slot per tick and holds the timers due within
+   the next WHEEL_SIZE ticks; each slot of level N covers
+   WHEEL_SIZE^N ticks.  Arming and cancelling a timer is O(1).
+   Whenever a level wraps around, the next slot of the level
+   above is "cascaded" into the lower levels, so a timer is moved
+   at most WHEEL_LEVELS - 1 times before it runs.  Timers farther
+   away than WHEEL_SPAN ticks are parked in the last level and
+   re-filed each time they are cascaded. */
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_SPAN ((int64_t) 1 << (WHEEL_BITS * WHEEL_LEVELS))
+
+/* Maximum number of timer functions run by one timer interrupt.
+   Timers beyond this stay on expired_timers and run on the
+   following ticks, bounding the time spent with interrupts off
+   during a wake-up storm. */
+#define TIMER_EXPIRE_BATCH 64
+
+struct wheel_level {
+    struct list slots[WHEEL_SIZE]; /* Armed timers, by slot. */
+    uint64_t bitmap;               /* Bit N set if slots[N] is nonempty. */
+};
+
+static struct wheel_level wheel[WHEEL_LEVELS];
+static int64_t wheel_clock;        /* Next tick to be processed. */
+static struct list expired_timers; /* Due timers not yet run. */
+
+static void wheel_insert(struct timer *);
+static void wheel_cascade(int level, int slot);
+static void wheel_advance(int64_t now);
+
+static uint32_t oneshot_elapsed(void);
+static void oneshot_credit(uint32_t elapsed);
+static void oneshot_program(int64_t deadline);
+
+static void tsc_calibrate(void);
+static bool tsc_invariant(void);
+static void apic_timer_calibrate(void);
+static void apic_timer_program(int64_t deadline);
+static void apic_tick_start(void);
+static void apic_tick_credit(int64_t now);
+static void apic_tick_program(bool at_tick);
+static void apic_tick_arm(int64_t target);
+static bool hr_wake(int64_t now);
+static bool hr_sleeper_less(const struct pheap_elem *,
+                            const struct pheap_elem *, void *);
+static void hr_sleep(int64_t deadline);
+
+static void tick(void);
 static intr_handler_func timer_interrupt;
+static intr_handler_func apic_timer_interrupt;
 static bool too_many_loops(unsigned loops);
 static void busy_wait(int64_t loops);
 static void real_time_sleep(int64_t num, int32_t denom);
@@ -37,16 +168,24 @@ static void real_time_sleep(int64_t num, int32_t denom);
 void timer_init(void) {
     /* 8254 input frequency divided by TIMER_FREQ, rounded to
        nearest. */
-    uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+    uint16_t count = PIT_COUNTS_PER_TICK;
 
     outb(0x43, 0x34); /* CW: counter 0, LSB then MSB, mode 2, binary. */
     outb(0x40, count & 0xff);
     outb(0x40, count >> 8);
 
+    for (int level = 0; level < WHEEL_LEVELS; level++)
+        for (int slot = 0; slot < WHEEL_SIZE; slot++)
+            list_init(&wheel[level].slots[slot]);
+    list_init(&expired_timers);
+    pheap_init(&hr_sleepers, hr_sleeper_less, NULL);
+
     intr_register_ext(0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates loops_per_tick, used to implement brief delays
+   before the TSC is calibrated, then the TSC clocksource and the
+   local APIC timer. */
 void timer_calibrate(void) {
     unsigned high_bit, test_bit;
 
@@ -68,13 +207,34 @@ void timer_calibrate(void) {
             loops_per_tick |= test_bit;
 
     printf("%'" PRIu64 " loops/s.\n", (uint64_t)loops_per_tick * TIMER_FREQ);
+
+    tsc_calibrate();
+    apic_timer_calibrate();
+
+    /* Calibration needs an interrupt on every tick, so dynamic
+       ticks, and APIC ticks, only start once it is done. */
+    if (intr_apic_mode() && apic_timer_hz != 0)
+        apic_tick_start();
+    else if (timer_tickless) {
+        enum intr_level old_level = intr_disable();
+        oneshot_active = true;
+        oneshot_phase = 0;
+        oneshot_program(ticks + 1);
+        intr_set_level(old_level);
+    }
 }
 
 /* Returns the number of timer ticks since the OS booted. */
 int64_t
 timer_ticks(void) {
     enum intr_level old_level = intr_disable();
-    int64_t t = ticks;
+    int64_t t;
+
+    if (oneshot_active)
+        oneshot_credit(oneshot_elapsed());
+    else if (apic_tick && timer_tickless)
+        apic_tick_credit(timer_now_ns());
+    t = ticks;
     intr_set_level(old_level);
     barrier();
     return t;
@@ -87,6 +247,30 @@ timer_elapsed(int64_t then) {
     return timer_ticks() - then;
 }
 
+/* Returns the number of nanoseconds since the OS booted.  Reads
+   the TSC once timer_calibrate() has run, so successive calls
+   resolve well below a tick; before that it counts whole ticks. */
+int64_t
+timer_now_ns(void) {
+    if (tsc_hz == 0)
+        return timer_ticks() * NS_PER_TICK;
+    return timer_cycles_to_ns(rdtsc() - tsc_base);
+}
+
+/* Converts CYCLES, a difference of two rdtsc() values, to
+   nanoseconds.  Returns 0 before the TSC is calibrated. */
+int64_t
+timer_cycles_to_ns(uint64_t cycles) {
+    return ((unsigned __int128)cycles * tsc_mult) >> 32;
+}
+
+/* Returns the TSC frequency in Hz, or 0 before timer_calibrate()
+   has run. */
+uint64_t
+timer_tsc_hz(void) {
+    return tsc_hz;
+}
+
 /* Suspends execution for approximately TICKS timer ticks. */
 void timer_sleep(int64_t ticks) {
     int64_t start = timer_ticks();
@@ -110,34 +294,616 @@ void timer_nsleep(int64_t ns) {
     real_time_sleep(ns, 1000 * 1000 * 1000);
 }
 
+/* Initializes timer T to run FUNC(AUX) once it is armed and
+   expires.  T starts out disarmed. */
+void timer_setup(struct timer *t, timer_func *func, void *aux) {
+    ASSERT(t != NULL);
+    ASSERT(func != NULL);
+
+    t->func = func;
+    t->aux = aux;
+    t->armed = false;
+}
+
+/* Arms T to expire at tick EXPIRES, an absolute time as returned
+   by timer_ticks().  If EXPIRES has already passed, T expires on
+   the next timer tick.  T must not already be armed. */
+void timer_arm(struct timer *t, int64_t expires) {
+    enum intr_level old_level;
+
+    ASSERT(t != NULL);
+    ASSERT(t->func != NULL);
+
+    old_level = intr_disable();
+    ASSERT(!t->armed);
+    t->expires = expires;
+    t->armed = true;
+    wheel_insert(t);
+    timer_kick(expires);
+    intr_set_level(old_level);
+}
+
+/* In tickless mode, makes sure a timer interrupt arrives no
+   later than tick DEADLINE, reprogramming the PIT or the APIC
+   timer if it was set to fire later.  Does nothing otherwise. */
+void timer_kick(int64_t deadline) {
+    enum intr_level old_level;
+    uint32_t elapsed;
+
+    if (apic_tick) {
+        if (!timer_tickless || deadline >= apic_event_tick)
+            return;
+        old_level = intr_disable();
+        apic_tick_credit(timer_now_ns());
+        apic_tick_arm(deadline > ticks ? deadline : ticks + 1);
+        intr_set_level(old_level);
+        return;
+    }
+
+    if (!oneshot_active || deadline >= oneshot_deadline)
+        return;
+
+    old_level = intr_disable();
+    elapsed = oneshot_elapsed();
+
+    /* If the PIT already fired, the pending interrupt will
+       reprogram it. */
+    if (elapsed < oneshot_count) {
+        oneshot_credit(elapsed);
+        oneshot_phase += elapsed - oneshot_credited * PIT_COUNTS_PER_TICK;
+        oneshot_program(deadline);
+    }
+    intr_set_level(old_level);
+}
+
+/* Disarms T.  Returns true if T was armed and will now not run,
+   false if it had already run or was never armed. */
+bool timer_cancel(struct timer *t) {
+    enum intr_level old_level;
+    bool was_armed;
+
+    ASSERT(t != NULL);
+
+    old_level = intr_disable();
+    was_armed = t->armed;
+    if (was_armed) {
+        list_remove(&t->elem);
+        if (t->level >= 0) {
+            struct wheel_level *wl = &wheel[t->level];
+            if (list_empty(&wl->slots[t->slot]))
+                wl->bitmap &= ~(1ULL << t->slot);
+        }
+        t->armed = false;
+    }
+    intr_set_level(old_level);
+
+    return was_armed;
+}
+
+/* Returns the tick at which the earliest armed timer expires, or
+   INT64_MAX if no timer is armed.  The result may be in the past
+   if a timer is already due. */
+int64_t
+timer_next_expiry(void) {
+    enum intr_level old_level = intr_disable();
+    int64_t next = INT64_MAX;
+
+    if (!list_empty(&expired_timers))
+        next = wheel_clock - 1;
+    else
+        for (int level = 0; level < WHEEL_LEVELS; level++) {
+            struct wheel_level *wl = &wheel[level];
+            int cur, start, slot;
+            uint64_t rotated;
+            struct list_elem *e;
+
+            if (wl->bitmap == 0)
+                continue;
+
+            /* Within a level, slots after the current one hold
+               strictly later timers, so only the first nonempty
+               slot in wheel order needs to be scanned.  The
+               current slot of level 0 is due now; the current
+               slot of higher levels has already been cascaded and
+               can only hold timers a full revolution away. */
+            cur = (wheel_clock >> (WHEEL_BITS * level)) & WHEEL_MASK;
+            start = level == 0 ? cur : (cur + 1) & WHEEL_MASK;
+            rotated = start == 0 ? wl->bitmap
+                                 : (wl->bitmap >> start) | (wl->bitmap << (WHEEL_SIZE - start));
+            slot = (start + __builtin_ctzll(rotated)) & WHEEL_MASK;
+
+            for (e = list_begin(&wl->slots[slot]); e != list_end(&wl->slots[slot]);
+                 e = list_next(e)) {
+                struct timer *t = list_entry(e, struct timer, elem);
+                if (t->expires < next)
+                    next = t->expires;
+            }
+        }
+    intr_set_level(old_level);
+
+    return next;
+}
+
 /* Prints timer statistics. */
 void timer_print_stats(void) {
     printf("Timer: %" PRId64 " ticks\n", timer_ticks());
 }
 
-/* Timer interrupt handler. */
+/* PIT interrupt handler. */
 static void
 timer_interrupt(struct intr_frame *args UNUSED) {
-    ticks++;
+    if (oneshot_active) {
+        oneshot_credit(oneshot_count);
+        oneshot_phase += oneshot_count - oneshot_credited * PIT_COUNTS_PER_TICK;
+    } else
+        ticks++;
+    tick();
+
+    if (oneshot_active) {
+        int64_t deadline = timer_next_expiry();
+        int64_t preempt = thread_next_tick(ticks);
+
+        oneshot_program(deadline < preempt ? deadline : preempt);
+    }
+}
+
+/* Does the work of the ticks up to TICKS that have not been
+   handled yet.  Called from the timer interrupt, whichever timer
+   raises it. */
+static void
+tick(void) {
+    int64_t elapsed = ticks - last_tick_handled;
+
+    last_tick_handled = ticks;
+
+    if (elapsed > 1)
+        thread_skip_ticks(elapsed - 1);
     thread_tick();
-    thread_wakeup(ticks);
+    wheel_advance(ticks);
 
+    /* A multiple of N was reached since the last interrupt iff
+       TICKS % N < ELAPSED, even when ticks were skipped. */
     if (thread_mlfqs) {
         increase_recent_cpu();
 
         // 1초 마다 load_avg 계산 & 모든 thread의 recent_cpu, priority 재계산
-        if (timer_ticks() % TIMER_FREQ == 0) {
+        if (ticks % TIMER_FREQ < elapsed) {
             calculate_load_avg();
             recalculate_all();
         }
 
         // 4 tick 마다 thread의 현재 priority 계산
-        if (timer_ticks() % 4 == 0) {
+        if (ticks % 4 < elapsed) {
             calculate_priority_mlfqs(thread_current(), NULL);
         }
     }
 }
 
+/* APIC timer interrupt handler.  Wakes every hr_sleep() whose
+   deadline has passed, runs the tick if this was one, and re-arms
+   the timer. */
+static void
+apic_timer_interrupt(struct intr_frame *args UNUSED) {
+    int64_t now = timer_now_ns();
+    bool preempt = hr_wake(now);
+
+    if (apic_tick) {
+        bool at_tick;
+
+        if (apic_periodic) {
+            ticks++;
+            apic_next_tick_ns = now + NS_PER_TICK;
+        } else
+            apic_tick_credit(now);
+        at_tick = ticks != last_tick_handled;
+        if (at_tick)
+            tick();
+        apic_tick_program(at_tick);
+    } else if (!pheap_empty(&hr_sleepers))
+        apic_timer_program(pheap_entry(pheap_top(&hr_sleepers),
+                                       struct hr_sleeper, elem)->deadline);
+
+    /* The point of a precise deadline is lost if the sleeper then
+       waits out the rest of someone else's time slice. */
+    if (preempt)
+        intr_yield_on_return();
+}
+
+/* Wakes every hr_sleep() whose deadline is at or before NOW.
+   Returns true if one of them outranks the running thread.
+   Interrupts must be off. */
+static bool
+hr_wake(int64_t now) {
+    struct pheap_elem *e;
+    bool preempt = false;
+
+    while ((e = pheap_top(&hr_sleepers)) != NULL) {
+        struct hr_sleeper *s = pheap_entry(e, struct hr_sleeper, elem);
+
+        if (s->deadline > now)
+            break;
+        pheap_pop(&hr_sleepers);
+        thread_unblock(s->thread);
+        if (s->thread->priority > thread_current()->priority)
+            preempt = true;
+    }
+    return preempt;
+}
+
+/* Returns the number of PIT counts elapsed in the current
+   one-shot period.  Interrupts must be off. */
+static uint32_t
+oneshot_elapsed(void) {
+    uint32_t remaining;
+
+    outb(0x43, 0x00); /* CW: latch counter 0. */
+    remaining = inb(0x40);
+    remaining |= inb(0x40) << 8;
+
+    /* Past terminal count the counter wraps around below zero;
+       the interrupt is pending. */
+    if (remaining == 0 || remaining > oneshot_count)
+        return oneshot_count;
+    return oneshot_count - remaining;
+}
+
+/* Credits to TICKS the whole ticks that have passed once ELAPSED
+   counts of the current one-shot period are over.  Interrupts
+   must be off. */
+static void
+oneshot_credit(uint32_t elapsed) {
+    int64_t whole = (oneshot_phase + elapsed) / PIT_COUNTS_PER_TICK;
+
+    if (whole > oneshot_credited) {
+        ticks += whole - oneshot_credited;
+        oneshot_credited = whole;
+    }
+}
+
+/* Starts a one-shot period that ends at tick DEADLINE, or as
+   close to it as the counter allows.  Interrupts must be off and
+   ONESHOT_PHASE must give the counts already past the current
+   tick boundary. */
+static void
+oneshot_program(int64_t deadline) {
+    int64_t delta = deadline - ticks;
+    uint32_t count;
+
+    if (delta < 1)
+        delta = 1;
+    if (delta > ONESHOT_MAX_TICKS)
+        delta = ONESHOT_MAX_TICKS;
+
+    count = delta * PIT_COUNTS_PER_TICK - oneshot_phase;
+    oneshot_count = count;
+    oneshot_credited = 0;
+    oneshot_deadline = ticks + delta;
+
+    outb(0x43, 0x30); /* CW: counter 0, LSB then MSB, mode 0, binary. */
+    outb(0x40, count & 0xff);
+    outb(0x40, count >> 8);
+}
+
+/* Files armed timer T into the wheel slot for its expiry time,
+   relative to wheel_clock.  Interrupts must be off. */
+static void
+wheel_insert(struct timer *t) {
+    int64_t expires = t->expires;
+    int64_t delta = expires - wheel_clock;
+    int level, slot;
+
+    if (delta < 0) {
+        /* Already due: run it on the next tick processed. */
+        expires = wheel_clock;
+        delta = 0;
+    } else if (delta >= WHEEL_SPAN) {
+        /* Too far away: park it as late as the wheel reaches. */
+        expires = wheel_clock + WHEEL_SPAN - 1;
+        delta = WHEEL_SPAN - 1;
+    }
+
+    for (level = 0; level < WHEEL_LEVELS - 1; level++)
+        if (delta < (int64_t)1 << (WHEEL_BITS * (level + 1)))
+            break;
+    slot = (expires >> (WHEEL_BITS * level)) & WHEEL_MASK;
+
+    list_push_back(&wheel[level].slots[slot], &t->elem);
+    wheel[level].bitmap |= 1ULL << slot;
+    t->level = level;
+    t->slot = slot;
+}
+
+/* Moves every timer in SLOT of LEVEL down to the level that now
+   matches its remaining time.  Interrupts must be off. */
+static void
+wheel_cascade(int level, int slot) {
+    struct wheel_level *wl = &wheel[level];
+    struct list pending;
+
+    if (!(wl->bitmap & (1ULL << slot)))
+        return;
+
+    list_init(&pending);
+    list_splice(list_end(&pending), list_begin(&wl->slots[slot]),
+                list_end(&wl->slots[slot]));
+    wl->bitmap &= ~(1ULL << slot);
+
+    while (!list_empty(&pending))
+        wheel_insert(list_entry(list_pop_front(&pending), struct timer, elem));
+}
+
+/* Advances the wheel up to tick NOW, then runs at most
+   TIMER_EXPIRE_BATCH of the timers that have come due.  Called
+   from the timer interrupt. */
+static void
+wheel_advance(int64_t now) {
+    int budget = TIMER_EXPIRE_BATCH;
+
+    for (; wheel_clock <= now; wheel_clock++) {
+        int slot = wheel_clock & WHEEL_MASK;
+        struct list *due = &wheel[0].slots[slot];
+        struct list_elem *e;
+
+        /* Level 0 wrapped: pull down the next slot of each level
+           above, stopping at the first level that did not wrap. */
+        if (slot == 0)
+            for (int level = 1; level < WHEEL_LEVELS; level++) {
+                int upper = (wheel_clock >> (WHEEL_BITS * level)) & WHEEL_MASK;
+                wheel_cascade(level, upper);
+                if (upper != 0)
+                    break;
+            }
+
+        if (!(wheel[0].bitmap & (1ULL << slot)))
+            continue;
+        for (e = list_begin(due); e != list_end(due); e = list_next(e))
+            list_entry(e, struct timer, elem)->level = -1;
+        list_splice(list_end(&expired_timers), list_begin(due), list_end(due));
+        wheel[0].bitmap &= ~(1ULL << slot);
+    }
+
+    while (!list_empty(&expired_timers) && budget-- > 0) {
+        struct timer *t = list_entry(list_pop_front(&expired_timers),
+                                     struct timer, elem);
+
+        /* Never run a timer early. */
+        if (t->expires > now) {
+            wheel_insert(t);
+            continue;
+        }
+        t->armed = false;
+        t->func(t->aux);
+    }
+}
+
+/* Measures the TSC frequency over TSC_CALIBRATE_TICKS timer
+   ticks, starting on a tick boundary, and switches timer_now_ns()
+   over to the TSC. */
+static void
+tsc_calibrate(void) {
+    enum intr_level old_level;
+    uint64_t start_tsc, cycles, hz;
+    int64_t start;
+
+    /* Wait for a timer tick. */
+    start = ticks;
+    while (ticks == start)
+        barrier();
+
+    start_tsc = rdtsc();
+    start = ticks;
+    while (ticks - start < TSC_CALIBRATE_TICKS)
+        barrier();
+    cycles = rdtsc() - start_tsc;
+    hz = cycles * TIMER_FREQ / TSC_CALIBRATE_TICKS;
+
+    /* Line tick 0 up with TSC_BASE so that timer_now_ns() does not
+       jump when it stops counting ticks. */
+    old_level = intr_disable();
+    tsc_mult = ((uint64_t)NS_PER_SEC << 32) / hz;
+    tsc_base = start_tsc - start * cycles / TSC_CALIBRATE_TICKS;
+    tsc_hz = hz;
+    intr_set_level(old_level);
+
+    printf("TSC: %'" PRIu64 " Hz%s.\n", hz,
+           tsc_invariant() ? "" : ", not invariant");
+}
+
+/* Returns true if the CPU reports an invariant TSC, one that
+   ticks at a constant rate across P-, C- and T-state changes.
+   See [IA32-v3b] 17.17.1 "Invariant TSC".  Without it, the TSC
+   is still used, but timestamps may drift if the clock speed
+   changes. */
+static bool
+tsc_invariant(void) {
+    uint32_t eax = 0x80000000, ebx, ecx = 0, edx;
+
+    asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+    if (eax < 0x80000007)
+        return false;
+
+    eax = 0x80000007;
+    ecx = 0;
+    asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+    return (edx & (1 << 8)) != 0;
+}
+
+/* Measures the local APIC timer against the TSC for a
+   millisecond and registers its interrupt, enabling hr_sleep().
+   Leaves apic_timer_hz at 0 if there is no local APIC. */
+static void
+apic_timer_calibrate(void) {
+    enum intr_level old_level;
+    uint64_t start_tsc, cycles;
+    uint32_t counted;
+
+    if (!lapic_init()) {
+        printf("No local APIC: sub-tick sleeps will spin.\n");
+        return;
+    }
+    lapic_timer_setup(LAPIC_TIMER_VEC);
+
+    old_level = intr_disable();
+    start_tsc = rdtsc();
+    lapic_timer_start(UINT32_MAX, true);
+    while (rdtsc() - start_tsc < tsc_hz / 1000)
+        barrier();
+    counted = UINT32_MAX - lapic_timer_count();
+    cycles = rdtsc() - start_tsc;
+    lapic_timer_start(0, false);
+    intr_set_level(old_level);
+
+    if (counted == 0)
+        return;
+    apic_timer_hz = counted * tsc_hz / cycles;
+    intr_register_ext(LAPIC_TIMER_VEC, apic_timer_interrupt, "APIC Timer");
+    printf("APIC timer: %'" PRIu64 " Hz.\n", apic_timer_hz);
+}
+
+/* Starts an APIC timer countdown that ends at DEADLINE, as
+   returned by timer_now_ns(), rounding up so that it never fires
+   early.  Interrupts must be off. */
+static void
+apic_timer_program(int64_t deadline) {
+    int64_t delta = deadline - timer_now_ns();
+    uint64_t count;
+
+    if (delta < 1)
+        delta = 1;
+    if (delta > NS_PER_SEC)
+        delta = NS_PER_SEC;
+
+    count = DIV_ROUND_UP((uint64_t)delta * apic_timer_hz, NS_PER_SEC);
+    if (count > UINT32_MAX)
+        count = UINT32_MAX;
+    lapic_timer_start(count, false);
+}
+
+/* Moves timer ticks from the PIT to the APIC timer. */
+static void
+apic_tick_start(void) {
+    enum intr_level old_level = intr_disable();
+
+    intr_mask_ext(0x20);
+    apic_tick = true;
+    apic_next_tick_ns = timer_now_ns() + NS_PER_TICK;
+    apic_tick_program(true);
+    intr_set_level(old_level);
+
+    printf("Timer ticks from the APIC timer.\n");
+}
+
+/* Credits to TICKS the tick boundaries that NOW has passed.
+   Interrupts must be off. */
+static void
+apic_tick_credit(int64_t now) {
+    if (now >= apic_next_tick_ns) {
+        int64_t n = (now - apic_next_tick_ns) / NS_PER_TICK + 1;
+
+        ticks += n;
+        apic_next_tick_ns += n * NS_PER_TICK;
+    }
+}
+
+/* Re-arms the APIC timer after an interrupt or a change to the
+   sleepers.  AT_TICK says whether we are on a tick boundary,
+   which is where periodic mode has to start to keep ticks evenly
+   spaced.  Interrupts must be off. */
+static void
+apic_tick_program(bool at_tick) {
+    int64_t target;
+
+    if (!timer_tickless && pheap_empty(&hr_sleepers)) {
+        if (apic_periodic)
+            return;
+        if (at_tick) {
+            lapic_timer_periodic(apic_timer_hz / TIMER_FREQ);
+            apic_periodic = true;
+            apic_next_tick_ns = timer_now_ns() + NS_PER_TICK;
+            apic_event_tick = ticks + 1;
+            return;
+        }
+    }
+
+    target = ticks + 1;
+    if (timer_tickless) {
+        int64_t expiry = timer_next_expiry();
+        int64_t preempt = thread_next_tick(ticks);
+
+        target = expiry < preempt ? expiry : preempt;
+        if (target <= ticks)
+            target = ticks + 1;
+    }
+    apic_tick_arm(target);
+}
+
+/* Sets the APIC timer in one-shot mode for tick TARGET, which
+   must be in the future, or the first sleeper's deadline if that
+   comes sooner.  Interrupts must be off. */
+static void
+apic_tick_arm(int64_t target) {
+    int64_t deadline;
+
+    ASSERT(target > ticks);
+
+    /* apic_timer_program() cannot wait longer than a second. */
+    if (target - ticks > TIMER_FREQ)
+        target = ticks + TIMER_FREQ;
+    deadline = apic_next_tick_ns + (target - ticks - 1) * NS_PER_TICK;
+    if (!pheap_empty(&hr_sleepers)) {
+        int64_t hr = pheap_entry(pheap_top(&hr_sleepers),
+                                 struct hr_sleeper, elem)->deadline;
+        if (hr < deadline)
+            deadline = hr;
+    }
+
+    apic_periodic = false;
+    apic_event_tick = target;
+    apic_timer_program(deadline);
+}
+
+/* Orders hr_sleepers by deadline. */
+static bool
+hr_sleeper_less(const struct pheap_elem *a_, const struct pheap_elem *b_,
+                void *aux UNUSED) {
+    const struct hr_sleeper *a = pheap_entry(a_, struct hr_sleeper, elem);
+    const struct hr_sleeper *b = pheap_entry(b_, struct hr_sleeper, elem);
+
+    return a->deadline < b->deadline;
+}
+
+/* Blocks the running thread until timer_now_ns() reaches
+   DEADLINE.  Requires a calibrated APIC timer.
+
+   Only the bootstrap processor schedules threads, so its APIC
+   timer serves every sleeper. */
+static void
+hr_sleep(int64_t deadline) {
+    struct hr_sleeper s;
+    enum intr_level old_level;
+
+    ASSERT(!intr_context());
+
+    s.deadline = deadline;
+    s.thread = thread_current();
+
+    old_level = intr_disable();
+    pheap_push(&hr_sleepers, &s.elem);
+    if (pheap_top(&hr_sleepers) == &s.elem) {
+        if (apic_tick)
+            apic_tick_program(false);
+        else
+            apic_timer_program(deadline);
+    }
+    trace_event(TRACE_SLEEP, s.thread, NULL);
+
+    /* If the deadline passes before we are off the CPU, the
+       interrupt stays pending until the next thread turns
+       interrupts back on, and then wakes us. */
+    thread_block();
+    intr_set_level(old_level);
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool
@@ -186,6 +952,18 @@ real_time_sleep(int64_t num, int32_t denom) {
            timer_sleep() because it will yield the CPU to other
            processes. */
         timer_sleep(ticks);
+    } else if (tsc_hz != 0) {
+        /* Sub-tick sleep: block until a precise deadline if the
+           APIC timer can deliver it, otherwise spin on the TSC. */
+        int64_t deadline;
+
+        ASSERT(NS_PER_SEC % denom == 0);
+        deadline = timer_now_ns() + num * (NS_PER_SEC / denom);
+        if (apic_timer_hz != 0 && deadline - timer_now_ns() >= HR_SLEEP_MIN_NS)
+            hr_sleep(deadline);
+        else
+            while (timer_now_ns() < deadline)
+                asm volatile("pause");
     } else {
         /* Otherwise, use a busy-wait loop for more accurate
            sub-tick timing.  We scale the numerator and denominator
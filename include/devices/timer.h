@@ -1,23 +1,54 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* Dynamic-tick mode, "-tickless" on the kernel command line. */
+extern bool timer_tickless;
+
+/* Function run when a timer expires.  It is called from the
+   timer interrupt handler, so it must not sleep. */
+typedef void timer_func (void *aux);
+
+/* A one-shot timer kept in the timer wheel (see timer.c).
+   Embed it in the structure that owns it; nothing is allocated. */
+struct timer {
+	struct list_elem elem;      /* Wheel slot or expired list element. */
+	int64_t expires;            /* Tick at which FUNC runs. */
+	timer_func *func;           /* Function to run. */
+	void *aux;                  /* Argument to FUNC. */
+	bool armed;                 /* In the wheel and not yet run? */
+	int8_t level;               /* Wheel level, or -1 if already due. */
+	uint8_t slot;               /* Slot within LEVEL. */
+};
+
 void timer_init (void);
 void timer_calibrate (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
 
+int64_t timer_now_ns (void);
+int64_t timer_cycles_to_ns (uint64_t cycles);
+uint64_t timer_tsc_hz (void);
+
 void timer_sleep (int64_t ticks);
 void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
 
+void timer_setup (struct timer *, timer_func *, void *aux);
+void timer_arm (struct timer *, int64_t expires);
+bool timer_cancel (struct timer *);
+int64_t timer_next_expiry (void);
+void timer_kick (int64_t deadline);
+
 void timer_print_stats (void);
 
 #endif /* devices/timer.h */
@@ -6,13 +6,27 @@
  * This data structure is thoroughly documented in the Tour of
  * Pintos for Project 3.
  *
- * This is a standard hash table with chaining.  To locate an
- * element in the table, we compute a hash function over the
- * element's data and use that as an index into an array of
- * doubly linked lists, then linearly search the list.
+ * This is an open-addressing hash table.  Each element's hash
+ * value picks a home slot in an array; the element goes in the
+ * first free slot from there on.  Insertion uses Robin Hood
+ * hashing: an element that is further from its home slot takes
+ * the place of one that is nearer, so that no element ends up
+ * far from home and a search can stop as soon as it reaches an
+ * element nearer to its home than the one sought would be.
+ * Deletion shifts the following elements back a slot instead of
+ * leaving a tombstone.
  *
- * The chain lists do not use dynamic allocation.  Instead, each
- * structure that can potentially be in a hash must embed a
+ * A slot holds a pointer to the element and its hash value, so a
+ * search compares hash values in one array and only calls the
+ * comparison function, and touches the element, on a match.
+ *
+ * When the table needs more or fewer slots, it allocates a new
+ * array and moves the elements over a few at a time, during
+ * later insertions and deletions, instead of all at once.  Until
+ * the move is done, searches look in both arrays.
+ *
+ * The table does not allocate memory for its elements.  Instead,
+ * each structure that can potentially be in a hash must embed a
  * struct hash_elem member.  All of the hash functions operate on
  * these `struct hash_elem's.  The hash_entry macro allows
  * conversion from a struct hash_elem back to a structure object
@@ -23,11 +37,12 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
-#include "list.h"
 
-/* Hash element. */
+/* Hash element.  The table keeps pointers to elements, so it
+ * needs nothing inside them; the byte only gives each hash_elem
+ * a size and an address of its own, as C requires. */
 struct hash_elem {
-	struct list_elem list_elem;
+	uint8_t unused;
 };
 
 /* Converts pointer to hash element HASH_ELEM into a pointer to
@@ -36,8 +51,8 @@ struct hash_elem {
  * of the hash element.  See the big comment at the top of the
  * file for an example. */
 #define hash_entry(HASH_ELEM, STRUCT, MEMBER)                   \
-	((STRUCT *) ((uint8_t *) &(HASH_ELEM)->list_elem        \
-		- offsetof (STRUCT, MEMBER.list_elem)))
+	((STRUCT *) ((uint8_t *) (HASH_ELEM)                    \
+		- offsetof (STRUCT, MEMBER)))
 
 /* Computes and returns the hash value for hash element E, given
  * auxiliary data AUX. */
@@ -54,11 +69,28 @@ typedef bool hash_less_func (const struct hash_elem *a,
  * data AUX. */
 typedef void hash_action_func (struct hash_elem *e, void *aux);
 
+/* A slot. */
+struct hash_slot {
+	uint64_t hash;              /* Hash value of ELEM. */
+	struct hash_elem *elem;     /* Element. */
+};
+
+/* An array of slots. */
+struct hash_table {
+	size_t slot_cnt;            /* Number of slots, a power of 2, or 0. */
+	size_t elem_cnt;            /* Number of occupied slots. */
+	int shift;                  /* 64 - log2 (slot_cnt). */
+	struct hash_slot *slots;    /* Array of `slot_cnt' slots. */
+	uint8_t *dist;              /* Per slot, 0 if free, otherwise 1 +
+	                               the distance from its home slot. */
+};
+
 /* Hash table. */
 struct hash {
 	size_t elem_cnt;            /* Number of elements in table. */
-	size_t bucket_cnt;          /* Number of buckets, a power of 2. */
-	struct list *buckets;       /* Array of `bucket_cnt' lists. */
+	struct hash_table cur;      /* Slots that take insertions. */
+	struct hash_table old;      /* Slots being moved into CUR, if any. */
+	size_t move_idx;            /* Next slot of OLD to move. */
 	hash_hash_func *hash;       /* Hash function. */
 	hash_less_func *less;       /* Comparison function. */
 	void *aux;                  /* Auxiliary data for `hash' and `less'. */
@@ -67,8 +99,9 @@ struct hash {
 /* A hash table iterator. */
 struct hash_iterator {
 	struct hash *hash;          /* The hash table. */
-	struct list *bucket;        /* Current bucket. */
-	struct hash_elem *elem;     /* Current hash element in current bucket. */
+	struct hash_table *table;   /* Current slot array. */
+	size_t idx;                 /* Next slot in TABLE. */
+	struct hash_elem *elem;     /* Current hash element. */
 };
 
 /* Basic life cycle. */
@@ -77,8 +110,10 @@ void hash_clear (struct hash *, hash_action_func *);
 void hash_destroy (struct hash *, hash_action_func *);
 
 /* Search, insertion, deletion. */
-struct hash_elem *hash_insert (struct hash *, struct hash_elem *);
-struct hash_elem *hash_replace (struct hash *, struct hash_elem *);
+bool hash_insert (struct hash *, struct hash_elem *new,
+		struct hash_elem **old);
+bool hash_replace (struct hash *, struct hash_elem *new,
+		struct hash_elem **old);
 struct hash_elem *hash_find (struct hash *, struct hash_elem *);
 struct hash_elem *hash_delete (struct hash *, struct hash_elem *);
 
@@ -96,5 +131,6 @@ bool hash_empty (struct hash *);
 uint64_t hash_bytes (const void *, size_t);
 uint64_t hash_string (const char *);
 uint64_t hash_int (int);
+uint64_t hash_u64 (uint64_t);
 
 #endif /* lib/kernel/hash.h */
@@ -0,0 +1,67 @@
+#ifndef __LIB_KERNEL_PHEAP_H
+#define __LIB_KERNEL_PHEAP_H
+
+/* Intrusive pairing heap.
+
+   Like the lists in list.h, a heap never allocates: embed a
+   struct pheap_elem in the structure that goes into the heap and
+   use pheap_entry() to get back from the element to it.
+
+   The element at the top is the one that LESS orders first, so a
+   comparison function written for list_insert_ordered() gives the
+   same order here.  Elements that compare equal come out in the
+   order they were pushed.
+
+   Costs: push, top, and meld are O(1); pop, remove, and update are
+   O(log n) amortized. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct pheap_elem {
+    struct pheap_elem *child;   /* Leftmost child. */
+    struct pheap_elem *next;    /* Next sibling. */
+    struct pheap_elem *prev;    /* Previous sibling, or parent if leftmost. */
+    uint64_t seq;               /* Push order, breaks ties. */
+};
+
+/* Returns true if A should come out of the heap before B, given
+   auxiliary data AUX. */
+typedef bool pheap_less_func(const struct pheap_elem *a,
+                              const struct pheap_elem *b,
+                              void *aux);
+
+/* Performs some operation on heap element E, given auxiliary
+   data AUX. */
+typedef void pheap_action_func(struct pheap_elem *e, void *aux);
+
+/* Heap. */
+struct pheap {
+    struct pheap_elem *root;    /* Top element, or null if empty. */
+    size_t size;                /* Number of elements. */
+    uint64_t seq;               /* Next push order number. */
+    pheap_less_func *less;      /* Ordering function. */
+    void *aux;                  /* Auxiliary data for LESS. */
+};
+
+/* Converts pointer to heap element PHEAP_ELEM into a pointer to
+   the structure that PHEAP_ELEM is embedded inside. */
+#define pheap_entry(PHEAP_ELEM, STRUCT, MEMBER)           \
+    ((STRUCT *) ((uint8_t *) &(PHEAP_ELEM)->child     \
+        - offsetof(STRUCT, MEMBER.child)))
+
+void pheap_init(struct pheap *, pheap_less_func *, void *aux);
+
+void pheap_push(struct pheap *, struct pheap_elem *);
+struct pheap_elem *pheap_top(struct pheap *);
+struct pheap_elem *pheap_pop(struct pheap *);
+void pheap_remove(struct pheap *, struct pheap_elem *);
+void pheap_update(struct pheap *, struct pheap_elem *);
+
+size_t pheap_size(struct pheap *);
+bool pheap_empty(struct pheap *);
+void pheap_apply(struct pheap *, pheap_action_func *, void *aux);
+
+#endif /* lib/kernel/pheap.h */
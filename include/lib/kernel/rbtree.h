@@ -0,0 +1,60 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Intrusive red-black tree.
+
+   Like the lists in list.h, a tree never allocates: embed a
+   struct rb_elem in the structure that goes into the tree and use
+   rb_entry() to get back from the element to it.
+
+   Elements are kept in the order given by LESS.  Elements that
+   compare equal are kept in the order they were inserted, so the
+   tree also works as a priority queue that is FIFO among equals.
+
+   Costs: insert and remove are O(log n); rb_min() is O(1), since
+   the tree caches its leftmost element; rb_next() is O(1)
+   amortized over a full walk. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Tree element. */
+struct rb_elem {
+    struct rb_elem *parent;     /* Parent, or null at the root. */
+    struct rb_elem *left;       /* Left child. */
+    struct rb_elem *right;      /* Right child. */
+    bool red;                   /* Red or black node? */
+};
+
+/* Returns true if A orders before B, given auxiliary data AUX. */
+typedef bool rb_less_func(const struct rb_elem *a, const struct rb_elem *b,
+                          void *aux);
+
+/* Tree. */
+struct rbtree {
+    struct rb_elem *root;       /* Root, or null if empty. */
+    struct rb_elem *leftmost;   /* First element, or null if empty. */
+    size_t size;                /* Number of elements. */
+    rb_less_func *less;         /* Ordering function. */
+    void *aux;                  /* Auxiliary data for LESS. */
+};
+
+/* Converts pointer to tree element RB_ELEM into a pointer to the
+   structure that RB_ELEM is embedded inside. */
+#define rb_entry(RB_ELEM, STRUCT, MEMBER)                 \
+    ((STRUCT *) ((uint8_t *) &(RB_ELEM)->parent       \
+        - offsetof(STRUCT, MEMBER.parent)))
+
+void rb_init(struct rbtree *, rb_less_func *, void *aux);
+
+void rb_insert(struct rbtree *, struct rb_elem *);
+void rb_remove(struct rbtree *, struct rb_elem *);
+
+struct rb_elem *rb_min(struct rbtree *);
+struct rb_elem *rb_next(struct rb_elem *);
+
+size_t rb_size(struct rbtree *);
+bool rb_empty(struct rbtree *);
+
+#endif /* lib/kernel/rbtree.h */
@@ -24,6 +24,18 @@ size_t strlcpy (char *, const char *, size_t);
 size_t strlcat (char *, const char *, size_t);
 char *strtok_r (char *, const char *, char **);
 size_t strnlen (const char *, size_t);
+void memzero_page (void *);
+void copy_page (void *, const void *);
+
+/* Copies and fills of a small constant size compile to a few
+   moves instead of a call. */
+#define STRING_INLINE_MAX 16
+#define memcpy(DST, SRC, SIZE)                                  \
+	(__builtin_constant_p (SIZE) && (SIZE) <= STRING_INLINE_MAX   \
+	 ? __builtin_memcpy (DST, SRC, SIZE) : memcpy (DST, SRC, SIZE))
+#define memset(DST, VALUE, SIZE)                                \
+	(__builtin_constant_p (SIZE) && (SIZE) <= STRING_INLINE_MAX   \
+	 ? __builtin_memset (DST, VALUE, SIZE) : memset (DST, VALUE, SIZE))
 
 /* Try to be helpful. */
 #define strcpy dont_use_strcpy_use_strlcpy
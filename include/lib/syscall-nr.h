@@ -36,6 +36,14 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* User threads. */
+	SYS_CLONE,                  /* Start a thread in this process. */
+	SYS_THREAD_EXIT,            /* Terminate the calling thread. */
+	SYS_THREAD_JOIN,            /* Wait for a thread to terminate. */
+	SYS_FUTEX_WAIT,             /* Sleep while a word holds a value. */
+	SYS_FUTEX_WAKE,             /* Wake threads sleeping on a word. */
+	SYS_SET_TLS,                /* Set the thread's FS base. */
 };
 
 #endif /* lib/syscall-nr.h */
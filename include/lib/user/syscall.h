@@ -9,6 +9,10 @@
 typedef int pid_t;
 #define PID_ERROR ((pid_t) -1)
 
+/* Thread identifier. */
+typedef int tid_t;
+#define TID_ERROR ((tid_t) -1)
+
 /* Map region identifier. */
 typedef int off_t;
 #define MAP_FAILED ((void *) NULL)
@@ -50,6 +54,14 @@ bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char* target, const char* linkpath);
 
+/* User threads.  See <uthread.h> for the library built on these. */
+tid_t clone (void (*entry) (void *), void *arg, void *stack, void *tls);
+void thread_exit (int status) NO_RETURN;
+int thread_join (tid_t);
+int futex_wait (int *addr, int expected);
+int futex_wake (int *addr, int cnt);
+void set_tls (void *tls);
+
 static inline void* get_phys_addr (void *user_addr) {
 	void* pa;
 	asm volatile ("movq %0, %%rax" ::"r"(user_addr));
@@ -0,0 +1,41 @@
+#ifndef __LIB_USER_UTHREAD_H
+#define __LIB_USER_UTHREAD_H
+
+#include <debug.h>
+#include <syscall.h>
+
+/* Threads that share the process's address space and open files.
+
+   Each thread gets one of UTHREAD_MAX statically allocated stacks
+   of UTHREAD_STACK_SIZE bytes, and a thread-local block that its
+   FS base points to.  A stack is reused only once its thread has
+   been joined, so every thread should be joined.
+
+   Returning from the thread function is the same as calling
+   uthread_exit(0).  exit() ends the whole process, from any
+   thread. */
+#define UTHREAD_MAX 8
+#define UTHREAD_STACK_SIZE (8 * 1024)
+
+typedef void uthread_func (void *aux);
+
+tid_t uthread_create (uthread_func *, void *aux);
+int uthread_join (tid_t);
+void uthread_exit (int status) NO_RETURN;
+int uthread_id (void);
+
+/* A mutex that only enters the kernel when contended.  Initialize
+   with umutex_init() or UMUTEX_INITIALIZER. */
+struct umutex
+  {
+    int state;          /* 0: unlocked, 1: locked, 2: locked, maybe waiters. */
+  };
+
+#define UMUTEX_INITIALIZER { 0 }
+
+void umutex_init (struct umutex *);
+void umutex_lock (struct umutex *);
+bool umutex_trylock (struct umutex *);
+void umutex_unlock (struct umutex *);
+
+#endif /* lib/user/uthread.h */
@@ -0,0 +1,44 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "threads/thread.h"
+
+/* Maximum number of CPUs. */
+#define CPU_MAX 16
+
+/* Per-CPU state.  Each CPU only touches its own entry.  Only the
+   bootstrap processor schedules threads, so there is one run queue,
+   in thread.c, rather than one per CPU. */
+struct cpu {
+    int id;                     /* Index into cpus[]. */
+    uint32_t lapic_id;          /* Local APIC ID. */
+    volatile bool online;       /* Finished cpu bring-up. */
+    struct thread *curr;        /* Running thread. */
+    struct thread *idle_thread; /* Runs when nothing is ready. */
+    struct thread *fpu_owner;   /* Thread whose state is in the FPU. */
+    bool fpu_ts;                /* CR0.TS is set. */
+
+    /* Scheduling. */
+    unsigned thread_ticks;      /* Timer ticks since last yield. */
+
+    /* Statistics. */
+    long long idle_ticks;       /* Timer ticks spent idle. */
+    long long kernel_ticks;     /* Timer ticks in kernel threads. */
+    long long user_ticks;       /* Timer ticks in user programs. */
+    long long skipped_ticks;    /* Ticks passed without an interrupt. */
+};
+
+extern struct cpu cpus[CPU_MAX];
+
+/* Number of CPUs to bring up, set by the "-smp=N" kernel
+   command-line option. */
+extern int cpu_cnt;
+
+struct cpu *this_cpu (void);
+void cpu_init (void);
+void cpu_start_aps (void);
+
+#endif /* threads/cpu.h */
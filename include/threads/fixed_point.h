@@ -1,65 +1,66 @@
-#include "stdint.h"
+#ifndef THREADS_FIXED_POINT_H
+#define THREADS_FIXED_POINT_H
 
-#define INT_MAX ((1 << 31) - 1)
-#define INT_MIN (-(1 << 31))
+#include <stdint.h>
+
+/* 17.14 고정소수점 연산. MLFQS의 recent_cpu, load_avg 계산에 쓰입니다.
+ * 타이머 인터럽트 안에서 매 틱 불리므로 모두 inline이며, 곱셈과 나눗셈은
+ * 64비트 중간값으로 계산해 넘침을 막습니다. */
 #define FP_F (1 << 14)
 
-int int_to_fp(int);       /* Convert n to fixed point */
-int fp_to_int(int);       /* Convert x to integer (rounding to nearest) */
-int fp_to_int_round(int); /* Convert x to integer (rounding toward zero) */
-int add_fp(int, int);     /* Add x and y */
-int add_mixed(int, int);  /* Add x and n */
-int sub_fp(int, int);     /* Subtract y from x */
-int sub_mixed(int, int);  /* Subtract n from x */
-int mult_fp(int, int);    /* Multiply x by y */
-int mult_mixed(int, int); /* Multiply x by n */
-int div_fp(int, int);     /* Divide x by y */
-int div_mixed(int, int);  /* Divide x by n */
+/* Convert n to fixed point */
+static inline int int_to_fp(int n) {
+    return n * FP_F;
+}
 
-int fp_to_int(int x) {
+/* Convert x to integer (rounding toward zero) */
+static inline int fp_to_int(int x) {
     return x / FP_F;
 }
 
-int fp_to_int_round(int x) {
-    if (x >= 0) {
-        return (x + FP_F / 2) / FP_F;
-    } else {
-        return (x - FP_F / 2) / FP_F;
-    }
+/* Convert x to integer (rounding to nearest) */
+static inline int fp_to_int_round(int x) {
+    return x >= 0 ? (x + FP_F / 2) / FP_F : (x - FP_F / 2) / FP_F;
 }
 
-int add_fp(int x, int y) {
+/* Add x and y */
+static inline int add_fp(int x, int y) {
     return x + y;
 }
 
-int add_mixed(int x, int n) {
-    return x + int_to_fp(n);
+/* Add x and n */
+static inline int add_mixed(int x, int n) {
+    return x + n * FP_F;
 }
 
-int sub_fp(int x, int y) {
+/* Subtract y from x */
+static inline int sub_fp(int x, int y) {
     return x - y;
 }
 
-int sub_mixed(int x, int n) {
-    return x - int_to_fp(n);
+/* Subtract n from x */
+static inline int sub_mixed(int x, int n) {
+    return x - n * FP_F;
 }
 
-int mult_fp(int x, int y) {
-    return ((int64_t)x) * y / FP_F;
+/* Multiply x by y */
+static inline int mult_fp(int x, int y) {
+    return (int)((int64_t)x * y / FP_F);
 }
 
-int mult_mixed(int x, int n) {
-    return x * n;
+/* Multiply x by n */
+static inline int mult_mixed(int x, int n) {
+    return (int)((int64_t)x * n);
 }
 
-int div_fp(int x, int y) {
-    return ((int64_t)x) * FP_F / y;
+/* Divide x by y */
+static inline int div_fp(int x, int y) {
+    return (int)((int64_t)x * FP_F / y);
 }
 
-int div_mixed(int x, int n) {
+/* Divide x by n */
+static inline int div_mixed(int x, int n) {
     return x / n;
 }
 
-int int_to_fp(int n) {
-    return n * FP_F;
-}
+#endif /* threads/fixed_point.h */
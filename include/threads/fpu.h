@@ -0,0 +1,28 @@
+#ifndef THREADS_FPU_H
+#define THREADS_FPU_H
+
+#include "threads/interrupt.h"
+
+struct thread;
+
+/* Lazy FPU/SSE/AVX context switching.
+
+   Each CPU remembers which thread's state is loaded in its FPU
+   registers.  Switching to any other thread only sets CR0.TS; the
+   first FPU instruction that thread executes traps with #NM, and
+   only then is the old owner's state saved and the new one's
+   restored.  Threads that never touch the FPU never get a save
+   area and never pay for one. */
+
+void fpu_init (void);
+void fpu_init_cpu (void);
+void fpu_switch (struct thread *next);
+void fpu_copy (struct thread *dst, struct thread *src);
+void fpu_exit (void);
+
+/* Kernel code that wants to use vector instructions brackets them
+   with these.  Interrupts stay off in between. */
+enum intr_level fpu_kernel_begin (void);
+void fpu_kernel_end (enum intr_level);
+
+#endif /* threads/fpu.h */
@@ -66,13 +66,23 @@ struct intr_frame {
 typedef void intr_handler_func (struct intr_frame *);
 
 void intr_init (void);
+void intr_init_ap (void);
 void intr_register_ext (uint8_t vec, intr_handler_func *, const char *name);
 void intr_register_int (uint8_t vec, int dpl, enum intr_level,
                         intr_handler_func *, const char *name);
 bool intr_context (void);
 void intr_yield_on_return (void);
 
+/* Interrupt controller; see interrupt.c. */
+extern bool intr_force_pic;
+bool intr_apic_mode (void);
+void intr_mask_ext (uint8_t vec);
+
 void intr_dump_frame (const struct intr_frame *);
 const char *intr_name (uint8_t vec);
 
+/* Per-vector accounting and irqsoff tracing; see interrupt.c. */
+extern bool intr_stats;
+void intr_print_stats (void);
+
 #endif /* threads/interrupt.h */
@@ -0,0 +1,16 @@
+#ifndef THREADS_IOAPIC_H
+#define THREADS_IOAPIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* I/O APIC.  Delivers the 16 ISA interrupt lines to the local
+   APIC in place of the 8259A PICs.  Lines start out masked;
+   ioapic_route() unmasks one. */
+
+bool ioapic_init (void);
+int ioapic_pin_cnt (void);
+void ioapic_route (int irq, uint8_t vec, uint32_t apic_id);
+void ioapic_mask (int irq);
+
+#endif /* threads/ioapic.h */
@@ -0,0 +1,33 @@
+#ifndef THREADS_LAPIC_H
+#define THREADS_LAPIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Local APIC, in x2APIC mode (registers are MSRs) if the CPU
+   supports it and in xAPIC mode (memory-mapped registers)
+   otherwise.  Used to identify the running CPU, to send the INIT
+   and startup IPIs that bring up the application processors, to
+   acknowledge interrupts routed through the I/O APIC, and as the
+   event source for timer ticks and high-resolution sleeps. */
+
+/* Interrupt vectors raised by the local APIC itself.  intr_handler()
+   treats LAPIC_VEC_FIRST...LAPIC_VEC_LAST as external interrupts
+   and acknowledges them with lapic_eoi(). */
+#define LAPIC_VEC_FIRST 0xf0
+#define LAPIC_VEC_LAST  0xfe
+#define LAPIC_TIMER_VEC 0xf0    /* APIC timer. */
+
+bool lapic_init (void);
+bool lapic_is_x2apic (void);
+uint32_t lapic_id (void);
+void lapic_send_init (uint32_t apic_id);
+void lapic_send_sipi (uint32_t apic_id, uint64_t entry);
+void lapic_eoi (void);
+
+void lapic_timer_setup (uint8_t vec);
+void lapic_timer_start (uint32_t count, bool masked);
+void lapic_timer_periodic (uint32_t count);
+uint32_t lapic_timer_count (void);
+
+#endif /* threads/lapic.h */
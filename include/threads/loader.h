@@ -5,6 +5,11 @@
 #define LOADER_BASE 0x7c00      /* Physical address of loader's base. */
 #define LOADER_END  0x7e00      /* Physical address of end of loader. */
 
+/* Physical address at which application processors start
+   executing after a startup IPI.  Must be page-aligned and below
+   1 MB; see cpu_start_aps(). */
+#define LOADER_AP_TRAMPOLINE 0x8000
+
 /* Physical address of kernel base. */
 #define LOADER_KERN_BASE 0x8004000000
 
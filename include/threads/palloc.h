@@ -4,6 +4,10 @@
 #include <stdint.h>
 #include <stddef.h>
 
+/* Free memory is kept in blocks of 2**ORDER pages, for ORDER
+   from 0 to PALLOC_ORDERS - 1. */
+#define PALLOC_ORDERS 20
+
 /* How to allocate pages. */
 enum palloc_flags {
 	PAL_ASSERT = 001,           /* Panic on failure. */
@@ -19,5 +23,7 @@ void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+size_t palloc_free_blocks (enum palloc_flags, unsigned order);
+void palloc_print_stats (void);
 
 #endif /* threads/palloc.h */
@@ -0,0 +1,37 @@
+#ifndef THREADS_PCACHE_H
+#define THREADS_PCACHE_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/palloc.h"
+
+/* A cache of zeroed pages for one kind of object, drawn from one
+   palloc pool.
+
+   pcache_get() hands out a page that is already zero.  pcache_put()
+   only queues the page; background work zeroes returned pages,
+   refills the cache when it runs low and gives surplus pages back
+   to palloc.  Both calls are O(1) and never sleep, so they can be
+   used with interrupts off. */
+struct pcache {
+	const char *name;           /* For statistics. */
+	enum palloc_flags flags;    /* Pool to refill from (PAL_USER or 0). */
+	struct list clean;          /* Zeroed pages, ready to hand out. */
+	struct list dirty;          /* Returned pages, not yet zeroed. */
+	size_t clean_cnt;           /* Pages in CLEAN. */
+	size_t dirty_cnt;           /* Pages in DIRTY. */
+	size_t low;                 /* Refill CLEAN up to this many pages. */
+	size_t high;                /* Never hold more than this many pages. */
+	long long hits;             /* pcache_get() served from CLEAN. */
+	long long misses;           /* pcache_get() fell back to palloc. */
+	struct list_elem elem;      /* Element in the list of all caches. */
+};
+
+void pcache_init (struct pcache *, const char *name, enum palloc_flags,
+		size_t low, size_t high);
+void *pcache_get (struct pcache *);
+void pcache_put (struct pcache *, void *page);
+void pcache_start (void);
+void pcache_print_stats (void);
+
+#endif /* threads/pcache.h */
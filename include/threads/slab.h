@@ -0,0 +1,72 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Object caches.
+
+   A kmem_cache hands out objects of one type.  It carves whole
+   pages ("slabs") into slots of exactly the object's size, so a
+   72-byte object costs 72 bytes of a page instead of malloc()'s
+   128-byte block.
+
+   An optional constructor runs once per slot, when its slab is
+   created, not on every allocation: freed objects must be left
+   in their constructed state and come back that way.
+
+   Each cache keeps a small stack ("magazine") of free objects.
+   Allocation and freeing pop and push it with interrupts off and
+   move objects between the magazine and the slabs in batches, so
+   the common case touches no lock and no slab.  kmem_cache_free()
+   may be called from an interrupt handler.  kmem_cache_alloc()
+   sleeps when the cache has to grow, so it may not. */
+
+/* Objects a magazine holds, and how many move between the
+   magazine and the slabs at a time. */
+#define KMEM_MAG_SIZE 32
+#define KMEM_MAG_BATCH (KMEM_MAG_SIZE / 2)
+
+/* Largest object a cache holds. */
+#define KMEM_MAX_SIZE 1024
+
+/* Constructor, run on each slot of a new slab. */
+typedef void kmem_ctor_func (void *obj);
+
+/* A cache of objects of one size. */
+struct kmem_cache {
+	const char *name;           /* Name, for statistics. */
+	size_t size;                /* Object size, as given. */
+	size_t slot_size;           /* Bytes per slot. */
+	size_t link_ofs;            /* Offset of a free slot's link. */
+	size_t objs_per_slab;       /* Slots per slab. */
+	kmem_ctor_func *ctor;       /* Constructor, or a null pointer. */
+
+	struct list partial;        /* Slabs with free and used slots. */
+	struct list full;           /* Slabs with no free slot. */
+	struct list empty;          /* Slabs with no used slot. */
+	size_t empty_cnt;           /* Length of EMPTY. */
+	size_t slab_cnt;            /* Slabs in all three lists. */
+
+	void *mag[KMEM_MAG_SIZE];   /* Magazine of free objects. */
+	size_t mag_cnt;             /* Objects in MAG. */
+
+	long long allocs;           /* Successful kmem_cache_alloc() calls. */
+	long long frees;            /* kmem_cache_free() calls. */
+	long long refills;          /* Magazine refills from slabs. */
+	long long drains;           /* Magazine drains to slabs. */
+	size_t active;              /* Objects allocated and not freed. */
+	size_t peak;                /* Highest ACTIVE so far. */
+	struct list_elem elem;      /* Element in the list of all caches. */
+};
+
+void kmem_cache_init (struct kmem_cache *, const char *name, size_t size,
+		kmem_ctor_func *);
+void *kmem_cache_alloc (struct kmem_cache *);
+void *kmem_cache_zalloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+size_t kmem_cache_footprint (const struct kmem_cache *);
+void kmem_print_stats (void);
+
+#endif /* threads/slab.h */
@@ -0,0 +1,18 @@
+#ifndef THREADS_SWITCH_H
+#define THREADS_SWITCH_H
+
+#ifndef __ASSEMBLER__
+#include <stdint.h>
+
+/* Saves the callee-saved registers on the current stack, stores
+   the stack pointer in *CUR_SP, then loads NEXT_SP and pops the
+   registers saved there.  Returns in the context of the thread
+   that owns NEXT_SP. */
+void switch_threads (uint64_t *cur_sp, uint64_t next_sp);
+#endif
+
+/* Number of registers switch_threads() keeps on the stack, below
+   its return address. */
+#define SWITCH_SAVED_REGS 6
+
+#endif /* threads/switch.h */
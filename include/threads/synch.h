@@ -2,12 +2,13 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <pheap.h>
 #include <stdbool.h>
 
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct pheap waiters;       /* Waiting threads, highest priority on top. */
 };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -15,11 +16,14 @@ void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
-bool cmp_sem_priority (const struct list_elem *, const struct list_elem *, void *);
+
 /* Lock. */
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	struct pheap_elem elem;     /* Element in holder's held_locks. */
+	int max_priority;           /* Highest priority donated through this
+	                               lock, or PRI_MIN - 1 if none. */
 };
 
 void lock_init (struct lock *);
@@ -28,9 +32,70 @@ bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+/* Priority-ceiling lock.  Whoever holds it runs at no less than
+   its CEILING, which must be at least the priority of any thread
+   that takes it.  The holder then cannot be preempted by another
+   thread that wants the lock, so nothing is donated and release
+   does not rescan donations.  Ceiling locks must be released in
+   the reverse order they were acquired. */
+struct ceiling_lock {
+	struct thread *holder;      /* Thread holding lock. */
+	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	int ceiling;                /* Priority of the holder while held. */
+	int held_ceiling;           /* Max of CEILING and OUTER's. */
+	struct ceiling_lock *outer; /* Ceiling lock the holder took before. */
+};
+
+void ceiling_lock_init (struct ceiling_lock *, int ceiling);
+void ceiling_lock_acquire (struct ceiling_lock *);
+void ceiling_lock_release (struct ceiling_lock *);
+bool ceiling_lock_held_by_current_thread (const struct ceiling_lock *);
+
+/* Readers-writer lock.  A writer holds LOCK for as long as it
+   writes, so readers and writers that arrive meanwhile queue on
+   LOCK in priority order and donate to the writer.  Readers hold
+   LOCK only long enough to register themselves.
+
+   A writer that still has to wait for active readers donates to
+   each of them through MAX_PRIORITY, as a lock's waiters donate to
+   its holder.
+
+   The writer holds LOCK while it waits on DRAINED, so readers
+   cannot take LOCK to leave.  READERS, HOLDS, MAX_PRIORITY and
+   WRITER_WAITING are therefore guarded by turning interrupts off
+   instead, which suffices because only one CPU schedules threads
+   (see threads/cpu.c). */
+struct rwlock {
+	struct lock lock;           /* Held by the writer. */
+	struct semaphore drained;   /* Upped when the last reader leaves. */
+	int readers;                /* Number of active readers. */
+	struct list holds;          /* Active readers' rwlock_holds. */
+	int max_priority;           /* Priority donated to the readers by
+	                               the waiting writer, or PRI_MIN - 1. */
+	bool writer_waiting;        /* Writer waits for READERS to reach 0. */
+};
+
+/* Maximum number of readers-writer locks one thread may hold for
+   reading at once. */
+#define RWLOCK_HOLD_MAX 4
+
+/* One thread's read hold on a readers-writer lock.  Each thread
+   has RWLOCK_HOLD_MAX of these. */
+struct rwlock_hold {
+	struct rwlock *rwlock;      /* Lock held for reading, or NULL. */
+	struct thread *thread;      /* Reader. */
+	struct list_elem elem;      /* Element in RWLOCK's holds. */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+
 /* Condition variable. */
 struct condition {
-	struct list waiters;        /* List of waiting threads. */
+	struct pheap waiters;       /* Waiting threads, highest priority on top. */
 };
 
 void cond_init (struct condition *);
@@ -40,7 +105,9 @@ void cond_broadcast (struct condition *, struct lock *);
 void print_waiters_in_lock(struct lock *);
 
 void print_waiters_in_sema(struct semaphore *);
-void donate_priority(void);
+void restore_priority(void);
+void synch_thread_init(struct thread *);
+void synch_priority_changed(struct thread *);
 
 /* Optimization barrier.
  *
@@ -3,8 +3,10 @@
 
 #include <debug.h>
 #include <list.h>
+#include <rbtree.h>
 #include <stdint.h>
 
+#include "devices/timer.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #ifdef VM
@@ -12,6 +14,8 @@
 #include "vm/vm.h"
 #endif
 
+struct cpu;
+
 /* States in a thread's life cycle. */
 enum thread_status {
     THREAD_RUNNING, /* Running thread. */
@@ -30,6 +34,38 @@ typedef int tid_t;
 #define PRI_DEFAULT 31 /* Default priority. */
 #define PRI_MAX 63     /* Highest priority. */
 
+/* Per-thread scheduling statistics.  Times are in TSC cycles and
+ * are charged to the state the thread was in whenever it changes
+ * state: by schedule() for RUNNING and READY, and by
+ * thread_unblock() for BLOCKED. */
+struct sched_stats {
+    uint64_t run;         /* Time spent RUNNING. */
+    uint64_t ready;       /* Time spent READY, waiting for a CPU. */
+    uint64_t blocked;     /* Time spent BLOCKED. */
+    uint64_t since;       /* TSC of the last state change. */
+    unsigned voluntary;   /* Switched out while blocking or exiting. */
+    unsigned involuntary; /* Switched out while still runnable. */
+    unsigned donations;   /* Priority donations received. */
+    bool woken;           /* READY because of thread_unblock(). */
+};
+
+/* Parameters and state of a deadline (EDF) thread, set by
+ * thread_set_deadline().  Times are in ns; absolute times are on
+ * the timer_now_ns() clock.  PERIOD is 0 for threads in the
+ * normal classes. */
+struct sched_deadline {
+    int64_t runtime;      /* Budget per period. */
+    int64_t deadline;     /* Deadline, relative to the period start. */
+    int64_t period;       /* Period, or 0 if not a deadline thread. */
+    int64_t bw;           /* RUNTIME / PERIOD, see thread.c. */
+    int64_t abs_deadline; /* Deadline of the current period. */
+    int64_t budget;       /* Budget left in the current period. */
+    bool throttled;       /* Out of budget until the next period. */
+    bool missed;          /* Ran past ABS_DEADLINE, already counted. */
+    unsigned misses;      /* Deadline misses. */
+    struct timer timer;   /* Ends throttling at the next period. */
+};
+
 /* A kernel thread or user process.
  *
  * Each thread structure is stored in its own 4 kB page.  The
@@ -81,33 +117,53 @@ typedef int tid_t;
  * the `magic' member of the running thread's `struct thread' is
  * set to THREAD_MAGIC.  Stack overflow will normally change this
  * value, triggering the assertion. */
-/* The `elem' member has a dual purpose.  It can be an element in
- * the run queue (thread.c), or it can be an element in a
- * semaphore wait list (synch.c).  It can be used these two ways
- * only because they are mutually exclusive: only a thread in the
- * ready state is on the run queue, whereas only a thread in the
- * blocked state is on a semaphore wait list. */
+/* The `elem' member is the thread's element in the run queue
+ * (thread.c).  A blocked thread waits in a semaphore's heap
+ * through `wait_elem' instead (synch.c). */
 struct thread {
     /* Owned by thread.c. */
     tid_t tid;                 /* Thread identifier. */
     enum thread_status status; /* Thread state. */
     char name[16];             /* Name (for debugging purposes). */
     int priority;              /* Priority. */
-    int64_t wake_up_time;
+    struct cpu *cpu;           /* CPU running or queueing the thread. */
+    struct timer sleep_timer;  /* Wakes the thread from thread_sleep(). */
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;     /* List element. */
+    struct pheap_elem wait_elem;     /* Element in waiting_sema's waiters. */
+    struct semaphore *waiting_sema;  /* Semaphore being waited on, if any. */
+    struct pheap *cond_waiters;      /* Condition heap holding cond_elem. */
+    struct pheap_elem *cond_elem;    /* Element in cond_waiters, if any. */
     struct lock *waiting_lock; /* Lock that the thread is waiting on. */
-    struct list donation_list; /* List of threads that donated priority to this
-                                  thread. */
-    struct list_elem donation_elem;
+    struct pheap held_locks;   /* Held locks, highest donation on top. */
+    struct ceiling_lock *ceiling_locks; /* Innermost held ceiling lock. */
+    struct rwlock *waiting_rwlock;  /* Lock whose readers it waits for. */
+    struct rwlock_hold read_holds[RWLOCK_HOLD_MAX]; /* Read holds. */
     int original_priority; /* Original priority of the thread. */
     int nice;              /* Nice value of the thread. */
     int recent_cpu;        /* Recent cpu value of the thread. */
+    int load_epoch;        /* Last load_avg epoch applied to recent_cpu. */
+    int64_t vruntime;      /* CFS: weighted run time, in ns. */
+    uint64_t exec_start;   /* CFS: TSC when vruntime was last charged. */
+    struct rb_elem rb_elem; /* CFS or EDF: element in a run queue tree. */
+    struct sched_deadline dl; /* EDF parameters and state. */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint64_t *pml4; /* Page map level 4 */
-
+    struct thread *leader;   /* Process's first thread, which owns the
+                                address space, fd table and SPT that
+                                this thread uses.  Null for kernel
+                                threads. */
+    uint64_t fs_base;        /* User FS base, for thread-local storage. */
+    bool killed;             /* Leader: process is exiting, every thread
+                                must die before returning to user mode. */
+    struct list uthreads;    /* Leader: struct uthread of every other
+                                thread, until joined. */
+    int live_uthreads;       /* Leader: other threads not yet exited. */
+    struct semaphore uthreads_done; /* Leader: upped when the last other
+                                       thread exits after KILLED is set. */
+    struct uthread *uthread; /* Other threads: own struct uthread. */
 #endif
 #ifdef VM
     /* Table for whole virtual memory owned by thread. */
@@ -116,6 +172,9 @@ struct thread {
 
     /* Owned by thread.c. */
     struct intr_frame tf; /* Information for switching */
+    uint64_t ksp;         /* Saved kernel stack pointer, see switch.S. */
+    void *fpu_state;      /* FPU save area, allocated on first use. */
+    struct sched_stats stats; /* Scheduling statistics. */
     unsigned magic;       /* Detects stack overflow. */
 
     /*for hierarchical*/
@@ -143,10 +202,30 @@ struct thread {
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler, which shares the CPU
+   in proportion to a weight derived from each thread's nice value
+   and ignores priorities when picking the next thread.
+   Controlled by kernel command-line option "-cfs". */
+extern bool thread_cfs;
+
+/* If true, switch threads by saving and restoring a full intr_frame
+   through iretq, as older kernels did, instead of switch_threads().
+   Only useful for comparing the two.
+   Controlled by kernel command-line option "-iret-switch". */
+extern bool thread_iret_switch;
+
+/* If true, print each thread's scheduling statistics when it exits
+   and a wakeup latency histogram at power off.
+   Controlled by kernel command-line option "-sched-stats". */
+extern bool thread_sched_stats;
+
 void thread_init(void);
+void thread_init_ap(struct cpu *);
 void thread_start(void);
 
 void thread_tick(void);
+void thread_skip_ticks(int64_t n);
+int64_t thread_next_tick(int64_t now);
 void thread_print_stats(void);
 
 typedef void thread_func(void *aux);
@@ -167,17 +246,18 @@ void thread_set_priority(int);
 
 int thread_get_nice(void);
 void thread_set_nice(int);
+bool thread_set_deadline(int64_t runtime, int64_t deadline, int64_t period);
 int thread_get_recent_cpu(void);
 int thread_get_load_avg(void);
 
 void do_iret(struct intr_frame *tf);
 bool cmp_priority(const struct list_elem *, const struct list_elem *, void *);
-bool cmp_wake_up_time(const struct list_elem *, const struct list_elem *,
-                      void *);
+void thread_sleep(int64_t ticks);
+bool thread_wake_sleeper(struct thread *);
 void thread_switching(void);
+void thread_update_priority(struct thread *t, int priority);
 void print_ready_list(void);
 void print_sleep_list(void);
-void donate_priority(void);
 
 void calculate_load_avg(void);
 void calculate_recent_cpu(struct thread *t);
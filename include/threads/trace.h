@@ -0,0 +1,46 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include "threads/thread.h"
+
+/* Scheduler event trace.
+
+   Events go into a fixed-size ring in memory, stamped with the
+   TSC, so recording one costs a few dozen cycles and never
+   sleeps or prints.  trace_dump() writes the ring to the console
+   at power-off, or whenever it is called.  utils/trace2json turns
+   the dump into Chrome trace JSON for about:tracing or Perfetto.
+
+   When tracing is off, each call site costs one load and one
+   branch that is predicted not taken. */
+
+/* Kinds of events.  A is the thread the event is about; B is the
+   other party, if any. */
+enum trace_type {
+	TRACE_SWITCH,               /* CPU switches from A to B. */
+	TRACE_WAKE,                 /* A is made ready by B. */
+	TRACE_BLOCK,                /* A blocks. */
+	TRACE_DONATE,               /* A donates its priority to B. */
+	TRACE_SLEEP,                /* A goes to sleep on the timer. */
+	TRACE_EXIT,                 /* A exits. */
+	TRACE_TYPE_CNT
+};
+
+extern bool trace_enabled;
+
+void trace_set_enabled (bool);
+void trace_record (enum trace_type, const struct thread *a,
+		const struct thread *b);
+void trace_dump (void);
+
+/* Records an event of TYPE about A, with B as the other party,
+   if tracing is on. */
+static inline void
+trace_event (enum trace_type type, const struct thread *a,
+		const struct thread *b) {
+	if (__builtin_expect (trace_enabled, 0))
+		trace_record (type, a, b);
+}
+
+#endif /* threads/trace.h */
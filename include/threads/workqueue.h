@@ -0,0 +1,67 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Deferred work.
+
+   work_queue() hands a callback to a pool of kernel threads.  It
+   is O(1), never sleeps and never allocates, so interrupt
+   handlers and code that runs with interrupts off can use it to
+   push heavier work out to thread context, where the callback
+   may block, take locks and allocate memory.
+
+   Each queue has its own worker threads, running at the queue's
+   priority.  A worker takes up to the queue's batch size of
+   items per wake-up and runs them back to back.  Queueing an
+   item that is already pending does nothing, so a burst of
+   requests for the same work collapses into a single run. */
+
+/* Maximum batch size. */
+#define WQ_BATCH_MAX 16
+
+/* Function run by a work item, in a worker thread. */
+typedef void work_func (void *aux);
+
+/* A work item.  Embed it in the structure that owns it; nothing
+   is allocated. */
+struct work {
+	struct list_elem elem;      /* Element in the queue's pending list. */
+	work_func *func;            /* Function to run. */
+	void *aux;                  /* Argument to FUNC. */
+	struct workqueue *wq;       /* Queue it is pending on, if any. */
+	bool pending;               /* Queued and not yet taken by a worker? */
+};
+
+/* A queue of work items and the threads that run them. */
+struct workqueue {
+	const char *name;           /* Also the worker threads' name. */
+	int priority;               /* Priority of the worker threads. */
+	size_t batch;               /* Items a worker takes per wake-up. */
+	struct list pending;        /* Queued work, oldest first. */
+	struct list idle;           /* Workers blocked waiting for work. */
+	struct list flushers;       /* Threads in workqueue_flush(). */
+	int workers;                /* Worker threads started. */
+	int in_flight;              /* Items pending or running. */
+	long long queued;           /* Successful work_queue() calls. */
+	long long batches;          /* Batches taken by workers. */
+	struct list_elem elem;      /* Element in the list of all queues. */
+};
+
+/* General-purpose queue, started by thread_start(). */
+extern struct workqueue system_wq;
+
+void workqueue_init (struct workqueue *, const char *name, int priority,
+		size_t batch);
+void workqueue_start (struct workqueue *, int workers);
+void workqueue_flush (struct workqueue *);
+void workqueue_start_system (void);
+void workqueue_print_stats (void);
+
+void work_init (struct work *, work_func *, void *aux);
+bool work_queue (struct workqueue *, struct work *);
+bool work_cancel (struct work *);
+
+#endif /* threads/workqueue.h */
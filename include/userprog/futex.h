@@ -0,0 +1,11 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+#include "threads/thread.h"
+
+void futex_init(void);
+int futex_wait(const int *uaddr, int expected);
+int futex_wake(const int *uaddr, int cnt);
+void futex_wake_process(struct thread *leader);
+
+#endif /* userprog/futex.h */
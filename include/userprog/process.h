@@ -4,9 +4,7 @@
 #include "threads/synch.h"
 #include "threads/thread.h"
 
-/* File descriptor. */
-struct lock filesys_lock;
-
+void process_cache_init(void);
 tid_t process_create_initd(const char *file_name);
 tid_t process_fork(const char *name, struct intr_frame *if_);
 int process_exec(void *f_name);
@@ -15,4 +13,9 @@ void process_exit(void);
 void process_activate(struct thread *next);
 void argument_stack(char **parse, int count, void **esp);
 struct thread *get_child_process(int pid);
+struct thread *process_current(void);
+tid_t process_clone(uint64_t entry, uint64_t arg, uint64_t stack, uint64_t tls);
+int process_thread_join(tid_t);
+void process_set_tls(uint64_t tls);
+void process_exit_if_killed(void);
 #endif /* userprog/process.h */
@@ -3,6 +3,4 @@
 
 void syscall_init(void);
 
-struct lock filesys_lock;
-
 #endif /* userprog/syscall.h */
@@ -3,8 +3,10 @@
 #include <stdbool.h>
 
 #include "include/lib/kernel/hash.h"
+#include "include/lib/kernel/list.h"
 #include "include/threads/vaddr.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
 struct list frame_table;
 
 enum vm_type {
@@ -95,6 +97,9 @@ struct page_operations {
 struct supplemental_page_table {
     // spt의 자료구조 자체를 먼저 정해보아요 ~~
     struct hash hash_table;
+    // 같은 프로세스의 스레드들이 spt를 함께 쓰므로, 찾기, 넣기, 페이지
+    // 채우기(fault 처리)를 이 락으로 직렬화함.
+    struct lock lock;
 };
 
 #include "threads/thread.h"
@@ -15,7 +15,11 @@
    Each bit represents one bit in the bitmap.
    If bit 0 in an element represents bit K in the bitmap,
    then bit 1 in the element represents bit K+1 in the bitmap,
-   and so on. */
+   and so on.
+
+   Operations on ranges of bits work a whole element at a time,
+   finding bits with __builtin_ctzl() and counting them with
+   __builtin_popcountl(). */
 typedef unsigned long elem_type;
 
 /* Number of bits in an element. */
@@ -27,6 +31,8 @@ typedef unsigned long elem_type;
 struct bitmap {
 	size_t bit_cnt;     /* Number of bits. */
 	elem_type *bits;    /* Elements that represent bits. */
+	elem_type *full;    /* Summary: bit I is set if element I of BITS
+	                       has all its bits set.  Null if disabled. */
 };
 
 /* Returns the index of the element that contains the bit
@@ -63,6 +69,45 @@ last_mask (const struct bitmap *b) {
 	return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
 
+/* Returns a bit mask with the CNT bits starting at bit OFS of
+   an element set to 1.  OFS + CNT must not exceed ELEM_BITS. */
+static inline elem_type
+range_mask (size_t ofs, size_t cnt) {
+	elem_type mask = cnt < ELEM_BITS ? ((elem_type) 1 << cnt) - 1 : (elem_type) -1;
+	return mask << ofs;
+}
+
+/* Returns the number of bits, at most CNT, from bit START to the
+   end of the element that contains it, and stores in *MASK the
+   mask of those bits within the element. */
+static inline size_t
+elem_span (size_t start, size_t cnt, elem_type *mask) {
+	size_t ofs = start % ELEM_BITS;
+	size_t n = ELEM_BITS - ofs < cnt ? ELEM_BITS - ofs : cnt;
+
+	*mask = range_mask (ofs, n);
+	return n;
+}
+
+/* Returns the mask of the bits actually used in element IDX of B. */
+static inline elem_type
+used_mask (const struct bitmap *b, size_t idx) {
+	return idx == elem_cnt (b->bit_cnt) - 1 ? last_mask (b) : (elem_type) -1;
+}
+
+/* Brings the summary bit for element IDX of B up to date. */
+static inline void
+update_summary (struct bitmap *b, size_t idx) {
+	if (b->full != NULL) {
+		elem_type mask = used_mask (b, idx);
+
+		if ((b->bits[idx] & mask) == mask)
+			b->full[elem_idx (idx)] |= bit_mask (idx);
+		else
+			b->full[elem_idx (idx)] &= ~bit_mask (idx);
+	}
+}
+
 /* Creation and destruction. */
 
 /* Initializes B to be a bitmap of BIT_CNT bits
@@ -74,6 +119,7 @@ bitmap_create (size_t bit_cnt) {
 	struct bitmap *b = malloc (sizeof *b);
 	if (b != NULL) {
 		b->bit_cnt = bit_cnt;
+		b->full = NULL;
 		b->bits = malloc (byte_cnt (bit_cnt));
 		if (b->bits != NULL || bit_cnt == 0) {
 			bitmap_set_all (b, false);
@@ -95,6 +141,7 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED) {
 
 	b->bit_cnt = bit_cnt;
 	b->bits = (elem_type *) (b + 1);
+	b->full = NULL;
 	bitmap_set_all (b, false);
 	return b;
 }
@@ -112,10 +159,33 @@ bitmap_buf_size (size_t bit_cnt) {
 void
 bitmap_destroy (struct bitmap *b) {
 	if (b != NULL) {
+		free (b->full);
 		free (b->bits);
 		free (b);
 	}
 }
+
+/* Adds to B a summary with one bit per element of B, set when
+   that element is full, so that scans for false bits skip full
+   elements 64 at a time.  Worth it for large bitmaps that are
+   mostly true.  Updates to B then also update the summary, so
+   changes to B must not race with each other.  Returns true if
+   successful, false if memory allocation failed, in which case B
+   works as before. */
+bool
+bitmap_enable_summary (struct bitmap *b) {
+	size_t cnt = elem_cnt (b->bit_cnt);
+	size_t i;
+
+	if (b->full != NULL)
+		return true;
+	b->full = calloc (elem_cnt (cnt), sizeof *b->full);
+	if (b->full == NULL)
+		return false;
+	for (i = 0; i < cnt; i++)
+		update_summary (b, i);
+	return true;
+}
 
 /* Bitmap size. */
 
@@ -148,6 +218,7 @@ bitmap_mark (struct bitmap *b, size_t bit_idx) {
 	   is guaranteed to be atomic on a uniprocessor machine.  See
 	   the description of the OR instruction in [IA32-v2b]. */
 	asm ("lock orq %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+	update_summary (b, idx);
 }
 
 /* Atomically sets the bit numbered BIT_IDX in B to false. */
@@ -160,6 +231,7 @@ bitmap_reset (struct bitmap *b, size_t bit_idx) {
 	   is guaranteed to be atomic on a uniprocessor machine.  See
 	   the description of the AND instruction in [IA32-v2a]. */
 	asm ("lock andq %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+	update_summary (b, idx);
 }
 
 /* Atomically toggles the bit numbered IDX in B;
@@ -174,6 +246,7 @@ bitmap_flip (struct bitmap *b, size_t bit_idx) {
 	   is guaranteed to be atomic on a uniprocessor machine.  See
 	   the description of the XOR instruction in [IA32-v2b]. */
 	asm ("lock xorq %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+	update_summary (b, idx);
 }
 
 /* Returns the value of the bit numbered IDX in B. */
@@ -194,49 +267,72 @@ bitmap_set_all (struct bitmap *b, bool value) {
 	bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.
+   Whole elements are stored at once; the partial elements at
+   either end are updated atomically, as by bitmap_mark() and
+   bitmap_reset(). */
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
-
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		bitmap_set (b, start + i, value);
+	while (cnt > 0) {
+		size_t idx = elem_idx (start);
+		elem_type mask;
+		size_t n = elem_span (start, cnt, &mask);
+
+		if (mask == (elem_type) -1)
+			b->bits[idx] = value ? (elem_type) -1 : 0;
+		else if (value)
+			asm ("lock orq %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+		else
+			asm ("lock andq %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+		update_summary (b, idx);
+		start += n;
+		cnt -= n;
+	}
 }
 
 /* Returns the number of bits in B between START and START + CNT,
    exclusive, that are set to VALUE. */
 size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i, value_cnt;
+	size_t total = cnt, true_cnt = 0;
 
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	value_cnt = 0;
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			value_cnt++;
-	return value_cnt;
+	while (cnt > 0) {
+		elem_type mask;
+		size_t n = elem_span (start, cnt, &mask);
+
+		true_cnt += __builtin_popcountl (b->bits[elem_idx (start)] & mask);
+		start += n;
+		cnt -= n;
+	}
+	return value ? true_cnt : total - true_cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
    exclusive, are set to VALUE, and false otherwise. */
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
-
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
+	while (cnt > 0) {
+		elem_type e = b->bits[elem_idx (start)];
+		elem_type mask;
+		size_t n = elem_span (start, cnt, &mask);
+
+		if ((value ? e : ~e) & mask)
 			return true;
+		start += n;
+		cnt -= n;
+	}
 	return false;
 }
 
@@ -263,21 +359,75 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt) {
 
 /* Finding set or unset bits. */
 
+/* Returns the index of the first element at or after IDX in B
+   that is not full, according to B's summary. */
+static size_t
+next_nonfull (const struct bitmap *b, size_t idx) {
+	size_t cnt = elem_cnt (b->bit_cnt);
+
+	while (idx < cnt) {
+		elem_type s = ~b->full[elem_idx (idx)] & ((elem_type) -1 << (idx % ELEM_BITS));
+
+		if (s != 0)
+			return (idx & ~(ELEM_BITS - 1)) + __builtin_ctzl (s);
+		idx = (idx | (ELEM_BITS - 1)) + 1;
+	}
+	return cnt;
+}
+
+/* Returns the index of the first bit in B at or after START and
+   before END that is set to VALUE, or END if there is none. */
+static size_t
+find_next (const struct bitmap *b, size_t start, size_t end, bool value) {
+	size_t idx, last;
+	elem_type e;
+
+	if (start >= end)
+		return end;
+	idx = elem_idx (start);
+	last = elem_idx (end - 1);
+	e = (value ? b->bits[idx] : ~b->bits[idx]) & ((elem_type) -1 << (start % ELEM_BITS));
+	while (e == 0) {
+		if (++idx > last)
+			return end;
+		if (!value && b->full != NULL) {
+			idx = next_nonfull (b, idx);
+			if (idx > last)
+				return end;
+		}
+		e = value ? b->bits[idx] : ~b->bits[idx];
+	}
+	start = idx * ELEM_BITS + __builtin_ctzl (e);
+	return start < end ? start : end;
+}
+
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
-   If there is no such group, returns BITMAP_ERROR. */
+   If there is no such group, returns BITMAP_ERROR.
+
+   Looks for the first bit set to VALUE, then for the first bit
+   after it that is not, skipping whole elements either way, and
+   starts again after that bit if the run is too short.  Each
+   element is thus looked at about once, and runs of 64 bits or
+   more are checked 64 bits at a time. */
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 
-	if (cnt <= b->bit_cnt) {
-		size_t last = b->bit_cnt - cnt;
-		size_t i;
-		for (i = start; i <= last; i++)
-			if (!bitmap_contains (b, i, cnt, !value))
-				return i;
+	if (cnt == 0)
+		return start;
+	while (cnt <= b->bit_cnt - start) {
+		size_t end;
+
+		start = find_next (b, start, b->bit_cnt, value);
+		if (cnt > b->bit_cnt - start)
+			break;
+		end = find_next (b, start, start + cnt, !value);
+		if (end == start + cnt)
+			return start;
+		start = end;
 	}
 	return BITMAP_ERROR;
 }
@@ -315,6 +465,12 @@ bitmap_read (struct bitmap *b, struct file *file) {
 		off_t size = byte_cnt (b->bit_cnt);
 		success = file_read_at (file, b->bits, size, 0) == size;
 		b->bits[elem_cnt (b->bit_cnt) - 1] &= last_mask (b);
+		if (b->full != NULL) {
+			size_t i;
+
+			for (i = 0; i < elem_cnt (b->bit_cnt); i++)
+				update_summary (b, i);
+		}
 	}
 	return success;
 }
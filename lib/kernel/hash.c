@@ -7,17 +7,38 @@
 
 #include "hash.h"
 #include "../debug.h"
+#include "../string.h"
 #include "threads/malloc.h"
 
-#define list_elem_to_hash_elem(LIST_ELEM)                       \
-	list_entry(LIST_ELEM, struct hash_elem, list_elem)
+/* Smallest number of slots. */
+#define MIN_SLOTS 8
 
-static struct list *find_bucket (struct hash *, struct hash_elem *);
-static struct hash_elem *find_elem (struct hash *, struct list *,
-		struct hash_elem *);
-static void insert_elem (struct hash *, struct list *, struct hash_elem *);
-static void remove_elem (struct hash *, struct hash_elem *);
-static void rehash (struct hash *);
+/* Largest distance, plus 1, that a slot's DIST byte holds.  A
+   slot further from home holds MAX_DIST and its distance is
+   worked out from its hash value. */
+#define MAX_DIST UINT8_MAX
+
+/* Slots of the old array looked at per insertion or deletion
+   while the table is being resized.  Growing starts at 3/4 load
+   into twice the slots, which then reach 3/4 load after half as
+   many insertions as there were old slots; looking at 8 slots
+   per operation finishes well before that. */
+#define MOVE_STEP 8
+
+/* Returned by table_find() when there is no such element. */
+#define NO_SLOT ((size_t) -1)
+
+static struct hash_elem *find_elem (struct hash *, uint64_t,
+		struct hash_elem *, struct hash_table **, size_t *);
+static bool insert_elem (struct hash *, uint64_t, struct hash_elem *);
+static void remove_elem (struct hash *, struct hash_table *, size_t);
+static void start_resize (struct hash *, size_t slot_cnt);
+static void resize_step (struct hash *);
+
+static bool table_init (struct hash_table *, size_t slot_cnt);
+static void table_free (struct hash_table *);
+static void table_put (struct hash_table *, uint64_t, struct hash_elem *);
+static void table_erase (struct hash_table *, size_t idx);
 
 /* Initializes hash table H to compute hash values using HASH and
    compare hash elements using LESS, given auxiliary data AUX. */
@@ -25,17 +46,13 @@ bool
 hash_init (struct hash *h,
 		hash_hash_func *hash, hash_less_func *less, void *aux) {
 	h->elem_cnt = 0;
-	h->bucket_cnt = 4;
-	h->buckets = malloc (sizeof *h->buckets * h->bucket_cnt);
+	h->old.slot_cnt = 0;
+	h->move_idx = 0;
 	h->hash = hash;
 	h->less = less;
 	h->aux = aux;
 
-	if (h->buckets != NULL) {
-		hash_clear (h, NULL);
-		return true;
-	} else
-		return false;
+	return table_init (&h->cur, MIN_SLOTS);
 }
 
 /* Removes all the elements from H.
@@ -49,21 +66,12 @@ hash_init (struct hash *h,
    whether done in DESTRUCTOR or elsewhere. */
 void
 hash_clear (struct hash *h, hash_action_func *destructor) {
-	size_t i;
-
-	for (i = 0; i < h->bucket_cnt; i++) {
-		struct list *bucket = &h->buckets[i];
-
-		if (destructor != NULL)
-			while (!list_empty (bucket)) {
-				struct list_elem *list_elem = list_pop_front (bucket);
-				struct hash_elem *hash_elem = list_elem_to_hash_elem (list_elem);
-				destructor (hash_elem, h->aux);
-			}
-
-		list_init (bucket);
-	}
+	if (destructor != NULL)
+		hash_apply (h, destructor);
 
+	table_free (&h->old);
+	memset (h->cur.dist, 0, h->cur.slot_cnt);
+	h->cur.elem_cnt = 0;
 	h->elem_cnt = 0;
 }
 
@@ -81,47 +89,66 @@ void
 hash_destroy (struct hash *h, hash_action_func *destructor) {
 	if (destructor != NULL)
 		hash_clear (h, destructor);
-	free (h->buckets);
+	table_free (&h->cur);
+	table_free (&h->old);
 }
 
-/* Inserts NEW into hash table H and returns a null pointer, if
-   no equal element is already in the table.
-   If an equal element is already in the table, returns it
-   without inserting NEW. */
-struct hash_elem *
-hash_insert (struct hash *h, struct hash_elem *new) {
-	struct list *bucket = find_bucket (h, new);
-	struct hash_elem *old = find_elem (h, bucket, new);
+/* Inserts NEW into hash table H and returns true, if no equal
+   element is already in the table.  Otherwise returns false
+   without inserting NEW.
 
-	if (old == NULL)
-		insert_elem (h, bucket, new);
+   If OLD is non-null, stores in *OLD the equal element already in
+   the table, or a null pointer if there is none.  So when this
+   returns false, *OLD is null only if the table was full and
+   could not grow because memory is exhausted. */
+bool
+hash_insert (struct hash *h, struct hash_elem *new, struct hash_elem **old) {
+	uint64_t hash = h->hash (new, h->aux);
+	struct hash_elem *found = find_elem (h, hash, new, NULL, NULL);
+	bool inserted = found == NULL && insert_elem (h, hash, new);
 
-	rehash (h);
+	resize_step (h);
 
-	return old;
+	if (old != NULL)
+		*old = found;
+	return inserted;
 }
 
 /* Inserts NEW into hash table H, replacing any equal element
-   already in the table, which is returned. */
-struct hash_elem *
-hash_replace (struct hash *h, struct hash_elem *new) {
-	struct list *bucket = find_bucket (h, new);
-	struct hash_elem *old = find_elem (h, bucket, new);
+   already in the table, and returns true.  If OLD is non-null,
+   stores in *OLD the element replaced, or a null pointer if there
+   was none.
 
-	if (old != NULL)
-		remove_elem (h, old);
-	insert_elem (h, bucket, new);
-
-	rehash (h);
+   Returns false without inserting NEW, and with *OLD null, if
+   there was no equal element and the table was full and could
+   not grow because memory is exhausted. */
+bool
+hash_replace (struct hash *h, struct hash_elem *new, struct hash_elem **old) {
+	uint64_t hash = h->hash (new, h->aux);
+	struct hash_table *t;
+	size_t idx;
+	struct hash_elem *found = find_elem (h, hash, new, &t, &idx);
+	bool inserted = true;
+
+	/* An equal element has the same hash value, so NEW can take
+	   its slot. */
+	if (found != NULL)
+		t->slots[idx].elem = new;
+	else
+		inserted = insert_elem (h, hash, new);
+
+	resize_step (h);
 
-	return old;
+	if (old != NULL)
+		*old = found;
+	return inserted;
 }
 
 /* Finds and returns an element equal to E in hash table H, or a
    null pointer if no equal element exists in the table. */
 struct hash_elem *
 hash_find (struct hash *h, struct hash_elem *e) {
-	return find_elem (h, find_bucket (h, e), e);
+	return find_elem (h, h->hash (e, h->aux), e, NULL, NULL);
 }
 
 /* Finds, removes, and returns an element equal to E in hash
@@ -133,10 +160,13 @@ hash_find (struct hash *h, struct hash_elem *e) {
    responsibility to deallocate them. */
 struct hash_elem *
 hash_delete (struct hash *h, struct hash_elem *e) {
-	struct hash_elem *found = find_elem (h, find_bucket (h, e), e);
+	struct hash_table *t;
+	size_t idx;
+	struct hash_elem *found = find_elem (h, h->hash (e, h->aux), e, &t, &idx);
+
 	if (found != NULL) {
-		remove_elem (h, found);
-		rehash (h);
+		remove_elem (h, t, idx);
+		resize_step (h);
 	}
 	return found;
 }
@@ -149,19 +179,13 @@ hash_delete (struct hash *h, struct hash_elem *e) {
    undefined behavior, whether done from ACTION or elsewhere. */
 void
 hash_apply (struct hash *h, hash_action_func *action) {
-	size_t i;
+	struct hash_iterator i;
 
 	ASSERT (action != NULL);
 
-	for (i = 0; i < h->bucket_cnt; i++) {
-		struct list *bucket = &h->buckets[i];
-		struct list_elem *elem, *next;
-
-		for (elem = list_begin (bucket); elem != list_end (bucket); elem = next) {
-			next = list_next (elem);
-			action (list_elem_to_hash_elem (elem), h->aux);
-		}
-	}
+	hash_first (&i, h);
+	while (hash_next (&i))
+		action (hash_cur (&i), h->aux);
 }
 
 /* Initializes I for iterating hash table H.
@@ -187,8 +211,9 @@ hash_first (struct hash_iterator *i, struct hash *h) {
 	ASSERT (h != NULL);
 
 	i->hash = h;
-	i->bucket = i->hash->buckets;
-	i->elem = list_elem_to_hash_elem (list_head (i->bucket));
+	i->table = &h->cur;
+	i->idx = 0;
+	i->elem = NULL;
 }
 
 /* Advances I to the next element in the hash table and returns
@@ -203,13 +228,19 @@ struct hash_elem *
 hash_next (struct hash_iterator *i) {
 	ASSERT (i != NULL);
 
-	i->elem = list_elem_to_hash_elem (list_next (&i->elem->list_elem));
-	while (i->elem == list_elem_to_hash_elem (list_end (i->bucket))) {
-		if (++i->bucket >= i->hash->buckets + i->hash->bucket_cnt) {
-			i->elem = NULL;
-			break;
-		}
-		i->elem = list_elem_to_hash_elem (list_begin (i->bucket));
+	i->elem = NULL;
+	while (i->table != NULL) {
+		struct hash_table *t = i->table;
+
+		while (i->idx < t->slot_cnt)
+			if (t->dist[i->idx++] != 0) {
+				i->elem = t->slots[i->idx - 1].elem;
+				return i->elem;
+			}
+
+		/* Walk CUR, then OLD. */
+		i->table = t == &i->hash->cur ? &i->hash->old : NULL;
+		i->idx = 0;
 	}
 
 	return i->elem;
@@ -273,122 +304,315 @@ hash_string (const char *s_) {
 /* Returns a hash of integer I. */
 uint64_t
 hash_int (int i) {
-	return hash_bytes (&i, sizeof i);
+	return hash_u64 ((unsigned) i);
+}
+
+/* Returns a hash of 64-bit integer X, such as an address.  Much
+   cheaper than hash_bytes(), but every bit of X still affects
+   every bit of the result.  This is MurmurHash3's finalizer. */
+uint64_t
+hash_u64 (uint64_t x) {
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return x;
 }
 
-/* Returns the bucket in H that E belongs in. */
-static struct list *
-find_bucket (struct hash *h, struct hash_elem *e) {
-	size_t bucket_idx = h->hash (e, h->aux) & (h->bucket_cnt - 1);
-	return &h->buckets[bucket_idx];
+/* Returns true if CNT elements fill SLOT_CNT slots past 3/4. */
+static inline bool
+too_full (size_t cnt, size_t slot_cnt) {
+	return cnt * 4 > slot_cnt * 3;
+}
+
+/* Returns true if CNT elements fill SLOT_CNT slots below 1/16,
+   and the slots could shrink. */
+static inline bool
+too_empty (size_t cnt, size_t slot_cnt) {
+	return cnt * 16 < slot_cnt && slot_cnt > MIN_SLOTS;
+}
+
+/* Returns the home slot in T of an element with hash value HASH.
+   Multiplying by 2**64 / phi and keeping the top bits spreads
+   even a poor hash value over the whole table. */
+static inline size_t
+home_slot (const struct hash_table *t, uint64_t hash) {
+	return (hash * 0x9e3779b97f4a7c15ULL) >> t->shift;
+}
+
+/* Returns 1 + the distance of the element in slot IDX of T from
+   its home slot, or 0 if the slot is free. */
+static inline unsigned
+slot_dist (const struct hash_table *t, size_t idx) {
+	unsigned dist = t->dist[idx];
+
+	if (dist == MAX_DIST)
+		dist = ((idx - home_slot (t, t->slots[idx].hash)) & (t->slot_cnt - 1)) + 1;
+	return dist;
+}
+
+/* Sets the distance of slot IDX of T to DIST. */
+static inline void
+set_dist (struct hash_table *t, size_t idx, unsigned dist) {
+	t->dist[idx] = dist < MAX_DIST ? dist : MAX_DIST;
 }
 
-/* Searches BUCKET in H for a hash element equal to E.  Returns
-   it if found or a null pointer otherwise. */
+/* Searches T for an element with hash value HASH equal to E in
+   H.  Returns its slot index, or NO_SLOT if there is none. */
+static size_t
+table_find (struct hash *h, struct hash_table *t, uint64_t hash,
+		struct hash_elem *e) {
+	size_t mask = t->slot_cnt - 1;
+	size_t idx;
+	unsigned dist;
+
+	if (t->slot_cnt == 0)
+		return NO_SLOT;
+
+	/* Stop at the first slot whose element is nearer to its home
+	   than E would be: by the Robin Hood rule, E would have taken
+	   that slot.  A free slot has distance 0, so this also stops
+	   there. */
+	idx = home_slot (t, hash);
+	for (dist = 1; slot_dist (t, idx) >= dist; dist++) {
+		struct hash_slot *s = &t->slots[idx];
+
+		if (s->hash == hash
+				&& !h->less (s->elem, e, h->aux) && !h->less (e, s->elem, h->aux))
+			return idx;
+		idx = (idx + 1) & mask;
+	}
+	return NO_SLOT;
+}
+
+/* Searches H for an element with hash value HASH equal to E.
+   Returns it if found or a null pointer otherwise.  If found and
+   TABLE and IDX are non-null, stores its slot array in *TABLE and
+   its slot index in *IDX. */
 static struct hash_elem *
-find_elem (struct hash *h, struct list *bucket, struct hash_elem *e) {
-	struct list_elem *i;
+find_elem (struct hash *h, uint64_t hash, struct hash_elem *e,
+		struct hash_table **table, size_t *idx) {
+	struct hash_table *t = &h->cur;
+	size_t i = table_find (h, t, hash, e);
+
+	if (i == NO_SLOT && h->old.slot_cnt != 0) {
+		t = &h->old;
+		i = table_find (h, t, hash, e);
+	}
+	if (i == NO_SLOT)
+		return NULL;
 
-	for (i = list_begin (bucket); i != list_end (bucket); i = list_next (i)) {
-		struct hash_elem *hi = list_elem_to_hash_elem (i);
-		if (!h->less (hi, e, h->aux) && !h->less (e, hi, h->aux))
-			return hi;
+	if (table != NULL) {
+		*table = t;
+		*idx = i;
 	}
-	return NULL;
+	return t->slots[i].elem;
 }
 
-/* Returns X with its lowest-order bit set to 1 turned off. */
-static inline size_t
-turn_off_least_1bit (size_t x) {
-	return x & (x - 1);
+/* Makes T an array of SLOT_CNT free slots, a power of 2.
+   Returns false if memory is exhausted. */
+static bool
+table_init (struct hash_table *t, size_t slot_cnt) {
+	int log2 = 0;
+
+	ASSERT (slot_cnt != 0 && (slot_cnt & (slot_cnt - 1)) == 0);
+
+	/* Slots and distances in one block. */
+	t->slots = malloc ((sizeof *t->slots + sizeof *t->dist) * slot_cnt);
+	if (t->slots == NULL) {
+		t->slot_cnt = 0;
+		return false;
+	}
+	t->dist = (uint8_t *) (t->slots + slot_cnt);
+	memset (t->dist, 0, slot_cnt);
+
+	while (((size_t) 1 << log2) < slot_cnt)
+		log2++;
+	t->slot_cnt = slot_cnt;
+	t->elem_cnt = 0;
+	t->shift = 64 - log2;
+	return true;
 }
 
-/* Returns true if X is a power of 2, otherwise false. */
-static inline size_t
-is_power_of_2 (size_t x) {
-	return x != 0 && turn_off_least_1bit (x) == 0;
+/* Frees the slots of T, if it has any. */
+static void
+table_free (struct hash_table *t) {
+	if (t->slot_cnt != 0) {
+		free (t->slots);
+		t->slot_cnt = 0;
+		t->elem_cnt = 0;
+	}
 }
 
-/* Element per bucket ratios. */
-#define MIN_ELEMS_PER_BUCKET  1 /* Elems/bucket < 1: reduce # of buckets. */
-#define BEST_ELEMS_PER_BUCKET 2 /* Ideal elems/bucket. */
-#define MAX_ELEMS_PER_BUCKET  4 /* Elems/bucket > 4: increase # of buckets. */
+/* Puts E, with hash value HASH, into T, which must have a free
+   slot. */
+static void
+table_put (struct hash_table *t, uint64_t hash, struct hash_elem *e) {
+	size_t mask = t->slot_cnt - 1;
+	size_t idx, pos;
+	unsigned dist;
+
+	ASSERT (t->elem_cnt < t->slot_cnt);
+
+	/* E goes in the first slot whose element is nearer to its
+	   home than E would be, or is free. */
+	idx = home_slot (t, hash);
+	for (dist = 1; slot_dist (t, idx) >= dist; dist++)
+		idx = (idx + 1) & mask;
+	pos = idx;
+
+	/* The elements from there to the next free slot each move one
+	   slot further from home. */
+	while (t->dist[idx] != 0)
+		idx = (idx + 1) & mask;
+	for (; idx != pos; idx = (idx - 1) & mask) {
+		size_t prev = (idx - 1) & mask;
+
+		t->slots[idx] = t->slots[prev];
+		set_dist (t, idx, slot_dist (t, prev) + 1);
+	}
+
+	t->slots[pos].hash = hash;
+	t->slots[pos].elem = e;
+	set_dist (t, pos, dist);
+	t->elem_cnt++;
+}
 
-/* Changes the number of buckets in hash table H to match the
-   ideal.  This function can fail because of an out-of-memory
-   condition, but that'll just make hash accesses less efficient;
-   we can still continue. */
+/* Frees slot IDX of T by moving the elements after it, up to the
+   next free slot or element in its home slot, back one slot. */
 static void
-rehash (struct hash *h) {
-	size_t old_bucket_cnt, new_bucket_cnt;
-	struct list *new_buckets, *old_buckets;
-	size_t i;
+table_erase (struct hash_table *t, size_t idx) {
+	size_t mask = t->slot_cnt - 1;
+	size_t next;
+
+	for (next = (idx + 1) & mask; t->dist[next] > 1;
+			idx = next, next = (next + 1) & mask) {
+		t->slots[idx] = t->slots[next];
+		set_dist (t, idx, slot_dist (t, next) - 1);
+	}
+	t->dist[idx] = 0;
+	t->elem_cnt--;
+}
 
-	ASSERT (h != NULL);
+/* Moves every element of H into a new array of at least SLOT_CNT
+   slots at once, finishing any resize in progress.  Returns
+   false, leaving H unchanged, if memory is exhausted. */
+static bool
+rehash (struct hash *h, size_t slot_cnt) {
+	struct hash_table new;
+	struct hash_iterator i;
+
+	if (slot_cnt < MIN_SLOTS)
+		slot_cnt = MIN_SLOTS;
+	while (too_full (h->elem_cnt + 1, slot_cnt))
+		slot_cnt *= 2;
+	if (!table_init (&new, slot_cnt))
+		return false;
 
-	/* Save old bucket info for later use. */
-	old_buckets = h->buckets;
-	old_bucket_cnt = h->bucket_cnt;
-
-	/* Calculate the number of buckets to use now.
-	   We want one bucket for about every BEST_ELEMS_PER_BUCKET.
-	   We must have at least four buckets, and the number of
-	   buckets must be a power of 2. */
-	new_bucket_cnt = h->elem_cnt / BEST_ELEMS_PER_BUCKET;
-	if (new_bucket_cnt < 4)
-		new_bucket_cnt = 4;
-	while (!is_power_of_2 (new_bucket_cnt))
-		new_bucket_cnt = turn_off_least_1bit (new_bucket_cnt);
-
-	/* Don't do anything if the bucket count wouldn't change. */
-	if (new_bucket_cnt == old_bucket_cnt)
-		return;
+	hash_first (&i, h);
+	while (hash_next (&i)) {
+		struct hash_slot *s = &i.table->slots[i.idx - 1];
 
-	/* Allocate new buckets and initialize them as empty. */
-	new_buckets = malloc (sizeof *new_buckets * new_bucket_cnt);
-	if (new_buckets == NULL) {
-		/* Allocation failed.  This means that use of the hash table will
-		   be less efficient.  However, it is still usable, so
-		   there's no reason for it to be an error. */
-		return;
-	}
-	for (i = 0; i < new_bucket_cnt; i++)
-		list_init (&new_buckets[i]);
-
-	/* Install new bucket info. */
-	h->buckets = new_buckets;
-	h->bucket_cnt = new_bucket_cnt;
-
-	/* Move each old element into the appropriate new bucket. */
-	for (i = 0; i < old_bucket_cnt; i++) {
-		struct list *old_bucket;
-		struct list_elem *elem, *next;
-
-		old_bucket = &old_buckets[i];
-		for (elem = list_begin (old_bucket);
-				elem != list_end (old_bucket); elem = next) {
-			struct list *new_bucket
-				= find_bucket (h, list_elem_to_hash_elem (elem));
-			next = list_next (elem);
-			list_remove (elem);
-			list_push_front (new_bucket, elem);
-		}
+		table_put (&new, s->hash, s->elem);
 	}
 
-	free (old_buckets);
+	table_free (&h->cur);
+	table_free (&h->old);
+	h->cur = new;
+	return true;
 }
 
-/* Inserts E into BUCKET (in hash table H). */
-static void
-insert_elem (struct hash *h, struct list *bucket, struct hash_elem *e) {
+/* Inserts E, with hash value HASH, into hash table H.  Returns
+   false, leaving H unchanged, if the table is full and memory is
+   exhausted.
+
+   Growing starts at 3/4 load, so the current array only fills up
+   when earlier attempts to grow ran out of memory.  Even then the
+   last free slot is never used, so that every search ends: the
+   table tries once more to grow and otherwise refuses E. */
+static bool
+insert_elem (struct hash *h, uint64_t hash, struct hash_elem *e) {
+	if (too_full (h->cur.elem_cnt + 1, h->cur.slot_cnt)
+			&& h->old.slot_cnt == 0)
+		start_resize (h, h->cur.slot_cnt * 2);
+	if (h->cur.elem_cnt + 1 >= h->cur.slot_cnt
+			&& !rehash (h, h->cur.slot_cnt * 2))
+		return false;
+	table_put (&h->cur, hash, e);
 	h->elem_cnt++;
-	list_push_front (bucket, &e->list_elem);
+	return true;
 }
 
-/* Removes E from hash table H. */
+/* Removes the element in slot IDX of T from hash table H. */
 static void
-remove_elem (struct hash *h, struct hash_elem *e) {
+remove_elem (struct hash *h, struct hash_table *t, size_t idx) {
+	table_erase (t, idx);
 	h->elem_cnt--;
-	list_remove (&e->list_elem);
 }
 
+/* Moves up to MOVE_STEP slots' worth of elements of H's old
+   array into its current one, freeing the old array once it is
+   empty.  Moving the slots in order and closing each gap behind
+   the element moved leaves every slot before MOVE_IDX free, so
+   the elements still in the old array stay where a search will
+   find them. */
+static void
+move_step (struct hash *h) {
+	struct hash_table *old = &h->old;
+	int step;
+
+	for (step = 0; step < MOVE_STEP && old->elem_cnt > 0; step++) {
+		struct hash_slot *s = &old->slots[h->move_idx];
+
+		ASSERT (h->move_idx < old->slot_cnt);
+		if (old->dist[h->move_idx] == 0)
+			h->move_idx++;
+		else if (h->cur.elem_cnt + 1 < h->cur.slot_cnt) {
+			table_put (&h->cur, s->hash, s->elem);
+			table_erase (old, h->move_idx);
+		} else {
+			/* No room: move everything now. */
+			rehash (h, h->cur.slot_cnt * 2);
+			return;
+		}
+	}
+	if (old->elem_cnt == 0)
+		table_free (old);
+}
+
+/* Starts moving the elements of H into a new array of SLOT_CNT
+   slots.  If memory is exhausted, H just stays as it is. */
+static void
+start_resize (struct hash *h, size_t slot_cnt) {
+	struct hash_table new;
+
+	ASSERT (h->old.slot_cnt == 0);
+
+	if (!table_init (&new, slot_cnt))
+		return;
+	h->old = h->cur;
+	h->cur = new;
+	h->move_idx = 0;
+	move_step (h);
+}
+
+/* Does a step of resizing H: moves some elements if a resize is
+   in progress, otherwise starts one if H is too full or too
+   empty. */
+static void
+resize_step (struct hash *h) {
+	size_t slot_cnt = h->cur.slot_cnt;
+
+	if (h->old.slot_cnt != 0) {
+		if (too_full (h->cur.elem_cnt, slot_cnt))
+			rehash (h, slot_cnt * 2);
+		else
+			move_step (h);
+	} else if (too_full (h->elem_cnt, slot_cnt))
+		start_resize (h, slot_cnt * 2);
+	else if (too_empty (h->elem_cnt, slot_cnt)) {
+		slot_cnt /= 4;
+		start_resize (h, slot_cnt < MIN_SLOTS ? MIN_SLOTS : slot_cnt);
+	}
+}
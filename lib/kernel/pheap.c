@@ -0,0 +1,230 @@
+#include "pheap.h"
+
+#include "../debug.h"
+
+/* A pairing heap is a heap-ordered multiway tree.  Each node keeps
+   only a pointer to its leftmost child and a doubly linked list of
+   siblings, so an element costs three pointers plus the tie-break
+   counter.  The `prev' link of a leftmost child points to its
+   parent; that is the only way to tell the two cases apart, by
+   checking whether prev->child is the element itself.
+
+   Melding two trees links the one that loses the comparison as the
+   new leftmost child of the winner.  Popping the top melds its
+   children pairwise from left to right, then melds the pairs into
+   one tree from right to left ("two-pass" pairing), which is what
+   gives the O(log n) amortized bound. */
+
+/* Returns true if A comes out of heap H before B. */
+static inline bool
+before(const struct pheap *h, const struct pheap_elem *a,
+        const struct pheap_elem *b) {
+    if (h->less(a, b, h->aux))
+        return true;
+    if (h->less(b, a, h->aux))
+        return false;
+    return a->seq < b->seq;
+}
+
+/* Melds the trees rooted at A and B, neither of which may have
+   siblings, and returns the root of the result. */
+static struct pheap_elem *
+meld(const struct pheap *h, struct pheap_elem *a, struct pheap_elem *b) {
+    if (a == NULL)
+        return b;
+    if (b == NULL)
+        return a;
+    if (before(h, b, a)) {
+        struct pheap_elem *t = a;
+        a = b;
+        b = t;
+    }
+
+    b->prev = a;
+    b->next = a->child;
+    if (a->child != NULL)
+        a->child->prev = b;
+    a->child = b;
+    return a;
+}
+
+/* Melds the sibling list starting at FIRST into one tree by
+   two-pass pairing and returns its root. */
+static struct pheap_elem *
+merge_pairs(const struct pheap *h, struct pheap_elem *first) {
+    struct pheap_elem *pairs = NULL;
+    struct pheap_elem *root = NULL;
+
+    /* First pass, left to right: meld adjacent pairs, and chain the
+       results in reverse through their(now unused) `next' links. */
+    while (first != NULL) {
+        struct pheap_elem *a = first;
+        struct pheap_elem *b = a->next;
+
+        first = b != NULL ? b->next : NULL;
+        a->next = a->prev = NULL;
+        if (b != NULL) {
+            b->next = b->prev = NULL;
+            a = meld(h, a, b);
+        }
+        a->next = pairs;
+        pairs = a;
+    }
+
+    /* Second pass, right to left: meld the pairs into one tree. */
+    while (pairs != NULL) {
+        struct pheap_elem *a = pairs;
+
+        pairs = a->next;
+        a->next = NULL;
+        root = meld(h, root, a);
+    }
+    return root;
+}
+
+/* Unlinks E, which is in heap H but is not its root, from its
+   parent and siblings.  E keeps its children. */
+static void
+cut(struct pheap_elem *e) {
+    if (e->prev->child == e)
+        e->prev->child = e->next;
+    else
+        e->prev->next = e->next;
+    if (e->next != NULL)
+        e->next->prev = e->prev;
+    e->next = e->prev = NULL;
+}
+
+/* Removes E from H without changing the element count. */
+static void
+detach(struct pheap *h, struct pheap_elem *e) {
+    struct pheap_elem *children = e->child;
+
+    e->child = NULL;
+    if (e == h->root)
+        h->root = merge_pairs(h, children);
+    else {
+        cut(e);
+        h->root = meld(h, h->root, merge_pairs(h, children));
+    }
+}
+
+/* Initializes H as an empty heap ordered by LESS with auxiliary
+   data AUX. */
+void
+pheap_init(struct pheap *h, pheap_less_func *less, void *aux) {
+    ASSERT(h != NULL);
+    ASSERT(less != NULL);
+
+    h->root = NULL;
+    h->size = 0;
+    h->seq = 0;
+    h->less = less;
+    h->aux = aux;
+}
+
+/* Inserts E into H. */
+void
+pheap_push(struct pheap *h, struct pheap_elem *e) {
+    ASSERT(h != NULL);
+    ASSERT(e != NULL);
+
+    e->child = e->next = e->prev = NULL;
+    e->seq = h->seq++;
+    h->root = meld(h, h->root, e);
+    h->size++;
+}
+
+/* Returns the top element of H, or a null pointer if H is empty. */
+struct pheap_elem *
+pheap_top(struct pheap *h) {
+    ASSERT(h != NULL);
+
+    return h->root;
+}
+
+/* Removes and returns the top element of H, which must not be
+   empty. */
+struct pheap_elem *
+pheap_pop(struct pheap *h) {
+    struct pheap_elem *top;
+
+    ASSERT(h != NULL);
+    ASSERT(h->root != NULL);
+
+    top = h->root;
+    detach(h, top);
+    h->size--;
+    return top;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+pheap_remove(struct pheap *h, struct pheap_elem *e) {
+    ASSERT(h != NULL);
+    ASSERT(e != NULL);
+    ASSERT(h->size > 0);
+
+    detach(h, e);
+    h->size--;
+}
+
+/* Restores heap order after the key of E, which must be in H, has
+   changed.  E keeps its place among elements that compare equal
+   to it. */
+void
+pheap_update(struct pheap *h, struct pheap_elem *e) {
+    ASSERT(h != NULL);
+    ASSERT(e != NULL);
+
+    detach(h, e);
+    h->root = meld(h, h->root, e);
+}
+
+/* Returns the number of elements in H. */
+size_t
+pheap_size(struct pheap *h) {
+    ASSERT(h != NULL);
+
+    return h->size;
+}
+
+/* Returns true if H is empty, false otherwise. */
+bool
+pheap_empty(struct pheap *h) {
+    ASSERT(h != NULL);
+
+    return h->root == NULL;
+}
+
+/* Returns the parent of E, or a null pointer if E is the root. */
+static struct pheap_elem *
+parent(struct pheap_elem *e) {
+    while (e->prev != NULL && e->prev->child != e)
+        e = e->prev;
+    return e->prev;
+}
+
+/* Calls ACTION for each element in H in no particular order,
+   passing AUX.  ACTION must not modify H.  Meant for debugging:
+   the walk takes O(n^2) time in the worst case, but no stack. */
+void
+pheap_apply(struct pheap *h, pheap_action_func *action, void *aux) {
+    struct pheap_elem *e;
+
+    ASSERT(h != NULL);
+    ASSERT(action != NULL);
+
+    e = h->root;
+    while (e != NULL) {
+        action(e, aux);
+        if (e->child != NULL)
+            e = e->child;
+        else {
+            while (e != NULL && e->next == NULL)
+                e = parent(e);
+            if (e != NULL)
+                e = e->next;
+        }
+    }
+}
@@ -0,0 +1,298 @@
+#include "rbtree.h"
+
+#include "../debug.h"
+
+/* A red-black tree is a binary search tree whose nodes are
+   colored so that no red node has a red child and every path
+   from the root down to a missing child crosses the same number
+   of black nodes.  That keeps the longest path within twice the
+   shortest, so the height is O(log n).  Missing children are
+   null pointers and count as black.
+
+   Insertion and removal follow [CLRS] 13.3 and 13.4, with the
+   sentinel replaced by null checks; removal therefore tracks the
+   parent of the node that moved up, which may be null. */
+
+/* Makes NEW take OLD's place as a child of OLD's parent, or as
+   the root of T.  NEW may be null. */
+static void
+replace(struct rbtree *t, struct rb_elem *old, struct rb_elem *new) {
+    struct rb_elem *parent = old->parent;
+
+    if (parent == NULL)
+        t->root = new;
+    else if (parent->left == old)
+        parent->left = new;
+    else
+        parent->right = new;
+    if (new != NULL)
+        new->parent = parent;
+}
+
+/* Rotates X down to the left, bringing up its right child. */
+static void
+rotate_left(struct rbtree *t, struct rb_elem *x) {
+    struct rb_elem *y = x->right;
+
+    x->right = y->left;
+    if (y->left != NULL)
+        y->left->parent = x;
+    replace(t, x, y);
+    y->left = x;
+    x->parent = y;
+}
+
+/* Rotates X down to the right, bringing up its left child. */
+static void
+rotate_right(struct rbtree *t, struct rb_elem *x) {
+    struct rb_elem *y = x->left;
+
+    x->left = y->right;
+    if (y->right != NULL)
+        y->right->parent = x;
+    replace(t, x, y);
+    y->right = x;
+    x->parent = y;
+}
+
+static inline bool
+is_red(const struct rb_elem *e) {
+    return e != NULL && e->red;
+}
+
+/* Initializes T as an empty tree ordered by LESS, which is passed
+   AUX. */
+void
+rb_init(struct rbtree *t, rb_less_func *less, void *aux) {
+    ASSERT(t != NULL);
+    ASSERT(less != NULL);
+
+    t->root = t->leftmost = NULL;
+    t->size = 0;
+    t->less = less;
+    t->aux = aux;
+}
+
+/* Inserts E into T, after any elements equal to it. */
+void
+rb_insert(struct rbtree *t, struct rb_elem *e) {
+    struct rb_elem **link = &t->root, *parent = NULL;
+    bool leftmost = true;
+
+    ASSERT(t != NULL);
+    ASSERT(e != NULL);
+
+    while (*link != NULL) {
+        parent = *link;
+        if (t->less(e, parent, t->aux))
+            link = &parent->left;
+        else {
+            link = &parent->right;
+            leftmost = false;
+        }
+    }
+    e->parent = parent;
+    e->left = e->right = NULL;
+    e->red = true;
+    *link = e;
+    if (leftmost)
+        t->leftmost = e;
+    t->size++;
+
+    /* Only a red E under a red parent breaks the rules.  Recolor
+       while the uncle is red, then fix the rest with at most two
+       rotations. */
+    while (is_red(parent = e->parent)) {
+        struct rb_elem *grand = parent->parent;
+
+        if (parent == grand->left) {
+            struct rb_elem *uncle = grand->right;
+
+            if (is_red(uncle)) {
+                parent->red = uncle->red = false;
+                grand->red = true;
+                e = grand;
+                continue;
+            }
+            if (e == parent->right) {
+                rotate_left(t, parent);
+                e = parent;
+                parent = e->parent;
+            }
+            parent->red = false;
+            grand->red = true;
+            rotate_right(t, grand);
+        } else {
+            struct rb_elem *uncle = grand->left;
+
+            if (is_red(uncle)) {
+                parent->red = uncle->red = false;
+                grand->red = true;
+                e = grand;
+                continue;
+            }
+            if (e == parent->left) {
+                rotate_right(t, parent);
+                e = parent;
+                parent = e->parent;
+            }
+            parent->red = false;
+            grand->red = true;
+            rotate_left(t, grand);
+        }
+    }
+    t->root->red = false;
+}
+
+/* Restores the black heights after a black node was removed from
+   above X, a child of PARENT.  X may be null. */
+static void
+remove_fixup(struct rbtree *t, struct rb_elem *x, struct rb_elem *parent) {
+    while (x != t->root && !is_red(x)) {
+        if (x == parent->left) {
+            struct rb_elem *w = parent->right;
+
+            if (w->red) {
+                w->red = false;
+                parent->red = true;
+                rotate_left(t, parent);
+                w = parent->right;
+            }
+            if (!is_red(w->left) && !is_red(w->right)) {
+                w->red = true;
+                x = parent;
+                parent = x->parent;
+            } else {
+                if (!is_red(w->right)) {
+                    w->left->red = false;
+                    w->red = true;
+                    rotate_right(t, w);
+                    w = parent->right;
+                }
+                w->red = parent->red;
+                parent->red = false;
+                w->right->red = false;
+                rotate_left(t, parent);
+                x = t->root;
+            }
+        } else {
+            struct rb_elem *w = parent->left;
+
+            if (w->red) {
+                w->red = false;
+                parent->red = true;
+                rotate_right(t, parent);
+                w = parent->left;
+            }
+            if (!is_red(w->left) && !is_red(w->right)) {
+                w->red = true;
+                x = parent;
+                parent = x->parent;
+            } else {
+                if (!is_red(w->left)) {
+                    w->right->red = false;
+                    w->red = true;
+                    rotate_left(t, w);
+                    w = parent->left;
+                }
+                w->red = parent->red;
+                parent->red = false;
+                w->left->red = false;
+                rotate_right(t, parent);
+                x = t->root;
+            }
+        }
+    }
+    if (x != NULL)
+        x->red = false;
+}
+
+/* Removes E, which must be in T. */
+void
+rb_remove(struct rbtree *t, struct rb_elem *e) {
+    struct rb_elem *x, *parent;
+    bool removed_red;
+
+    ASSERT(t != NULL);
+    ASSERT(e != NULL);
+    ASSERT(t->size > 0);
+
+    if (t->leftmost == e)
+        t->leftmost = rb_next(e);
+
+    if (e->left == NULL || e->right == NULL) {
+        /* E has at most one child, which takes its place. */
+        x = e->left != NULL ? e->left : e->right;
+        parent = e->parent;
+        removed_red = e->red;
+        replace(t, e, x);
+    } else {
+        /* E's successor Y, which has no left child, leaves its
+           own spot to its right child and takes E's place and
+           color. */
+        struct rb_elem *y = e->right;
+
+        while (y->left != NULL)
+            y = y->left;
+        removed_red = y->red;
+        x = y->right;
+        if (y->parent == e)
+            parent = y;
+        else {
+            parent = y->parent;
+            replace(t, y, x);
+            y->right = e->right;
+            y->right->parent = y;
+        }
+        replace(t, e, y);
+        y->left = e->left;
+        y->left->parent = y;
+        y->red = e->red;
+    }
+    t->size--;
+
+    if (!removed_red)
+        remove_fixup(t, x, parent);
+}
+
+/* Returns the first element of T, or a null pointer if T is
+   empty. */
+struct rb_elem *
+rb_min(struct rbtree *t) {
+    ASSERT(t != NULL);
+
+    return t->leftmost;
+}
+
+/* Returns the element after E in its tree, or a null pointer if E
+   is the last. */
+struct rb_elem *
+rb_next(struct rb_elem *e) {
+    ASSERT(e != NULL);
+
+    if (e->right != NULL) {
+        e = e->right;
+        while (e->left != NULL)
+            e = e->left;
+        return e;
+    }
+    while (e->parent != NULL && e == e->parent->right)
+        e = e->parent;
+    return e->parent;
+}
+
+/* Returns the number of elements in T. */
+size_t
+rb_size(struct rbtree *t) {
+    ASSERT(t != NULL);
+
+    return t->size;
+}
+
+/* Returns true if T is empty, false otherwise. */
+bool
+rb_empty(struct rbtree *t) {
+    ASSERT(t != NULL);
+
+    return t->size == 0;
+}
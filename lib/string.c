@@ -1,5 +1,82 @@
 #include <string.h>
 #include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* string.h expands small constant-size calls inline with these
+   macros.  Define the real functions. */
+#undef memcpy
+#undef memset
+
+/* Block copies and fills.
+
+   Blocks of fewer than REP_THRESHOLD bytes are handled 8 bytes at
+   a time, then a byte at a time for the tail.  Larger blocks use
+   one string instruction: REP MOVSB or REP STOSB when the CPU has
+   Enhanced REP MOVSB/STOSB (ERMS), which makes them the fastest
+   way to move a large block, and REP MOVSQ or REP STOSQ
+   otherwise. */
+
+/* Blocks of at least this many bytes use string instructions. */
+#define REP_THRESHOLD 256
+
+/* CPUID.(EAX=7,ECX=0):EBX, Enhanced REP MOVSB/STOSB. */
+#define CPUID7_EBX_ERMS (1 << 9)
+
+/* Bytes in a page, for memzero_page() and copy_page(). */
+#define PAGE_BYTES 4096
+
+/* An 8-byte word that may alias anything and need not be
+   aligned. */
+typedef uint64_t word_t __attribute__ ((may_alias, aligned (1)));
+
+/* A word with every byte set to 1, and one with the top bit of
+   every byte set. */
+#define ONES 0x0101010101010101ULL
+#define HIGHS 0x8080808080808080ULL
+
+/* Returns true if the CPU has ERMS.  Asks CPUID on the first call
+   and remembers the answer. */
+static bool
+has_erms (void) {
+	static int erms = -1;
+
+	if (erms < 0) {
+		uint32_t eax = 0, ebx, ecx = 0, edx;
+
+		asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+		if (eax >= 7) {
+			eax = 7;
+			ecx = 0;
+			asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+		} else
+			ebx = 0;
+		erms = (ebx & CPUID7_EBX_ERMS) != 0;
+	}
+	return erms;
+}
+
+/* Copies SIZE bytes from SRC to DST, front to back. */
+static void
+copy_forward (unsigned char *dst, const unsigned char *src, size_t size) {
+	if (size >= REP_THRESHOLD) {
+		size_t words;
+
+		if (has_erms ()) {
+			asm volatile ("rep movsb"
+					: "+D" (dst), "+S" (src), "+c" (size) : : "memory");
+			return;
+		}
+		words = size / 8;
+		asm volatile ("rep movsq"
+				: "+D" (dst), "+S" (src), "+c" (words) : : "memory");
+		size %= 8;
+	}
+	for (; size >= 8; size -= 8, dst += 8, src += 8)
+		*(word_t *) dst = *(const word_t *) src;
+	while (size-- > 0)
+		*dst++ = *src++;
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -11,9 +88,7 @@ memcpy (void *dst_, const void *src_, size_t size) {
 	ASSERT (dst != NULL || size == 0);
 	ASSERT (src != NULL || size == 0);
 
-	while (size-- > 0)
-		*dst++ = *src++;
-
+	copy_forward (dst, src, size);
 	return dst_;
 }
 
@@ -27,17 +102,23 @@ memmove (void *dst_, const void *src_, size_t size) {
 	ASSERT (dst != NULL || size == 0);
 	ASSERT (src != NULL || size == 0);
 
-	if (dst < src) {
-		while (size-- > 0)
-			*dst++ = *src++;
-	} else {
+	/* Copying front to back is safe unless DST starts inside
+	   SRC. */
+	if (dst <= src || dst >= src + size)
+		copy_forward (dst, src, size);
+	else {
 		dst += size;
 		src += size;
+		for (; size >= 8; size -= 8) {
+			dst -= 8;
+			src -= 8;
+			*(word_t *) dst = *(const word_t *) src;
+		}
 		while (size-- > 0)
 			*--dst = *--src;
 	}
 
-	return dst;
+	return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -52,6 +133,10 @@ memcmp (const void *a_, const void *b_, size_t size) {
 	ASSERT (a != NULL || size == 0);
 	ASSERT (b != NULL || size == 0);
 
+	/* Skip equal words, then find the differing byte. */
+	for (; size >= 8; size -= 8, a += 8, b += 8)
+		if (*(const word_t *) a != *(const word_t *) b)
+			break;
 	for (; size-- > 0; a++, b++)
 		if (*a != *b)
 			return *a > *b ? +1 : -1;
@@ -257,9 +342,25 @@ strtok_r (char *s, const char *delimiters, char **save_ptr) {
 void *
 memset (void *dst_, int value, size_t size) {
 	unsigned char *dst = dst_;
+	uint64_t word = (unsigned char) value * ONES;
 
 	ASSERT (dst != NULL || size == 0);
 
+	if (size >= REP_THRESHOLD) {
+		size_t words;
+
+		if (has_erms ()) {
+			asm volatile ("rep stosb"
+					: "+D" (dst), "+c" (size) : "a" (value) : "memory");
+			return dst_;
+		}
+		words = size / 8;
+		asm volatile ("rep stosq"
+				: "+D" (dst), "+c" (words) : "a" (word) : "memory");
+		size %= 8;
+	}
+	for (; size >= 8; size -= 8, dst += 8)
+		*(word_t *) dst = word;
 	while (size-- > 0)
 		*dst++ = value;
 
@@ -273,8 +374,23 @@ strlen (const char *string) {
 
 	ASSERT (string);
 
-	for (p = string; *p != '\0'; p++)
-		continue;
+	/* Go a byte at a time up to a word boundary.  Aligned word
+	   reads then never cross into a page past the terminator. */
+	for (p = string; (uintptr_t) p % 8 != 0; p++)
+		if (*p == '\0')
+			return p - string;
+
+	/* A word has a zero byte if subtracting 1 from each byte
+	   borrows into a top bit that was clear. */
+	for (;;) {
+		uint64_t word = *(const word_t *) p;
+
+		if ((word - ONES) & ~word & HIGHS)
+			break;
+		p += 8;
+	}
+	while (*p != '\0')
+		p++;
 	return p - string;
 }
 
@@ -345,3 +461,27 @@ strlcat (char *dst, const char *src, size_t size) {
 	return src_len + dst_len;
 }
 
+/* Fills the page at PAGE, which must be page-aligned, with
+   zeros. */
+void
+memzero_page (void *page) {
+	size_t words = PAGE_BYTES / 8;
+
+	ASSERT ((uintptr_t) page % PAGE_BYTES == 0);
+
+	asm volatile ("rep stosq"
+			: "+D" (page), "+c" (words) : "a" (0ULL) : "memory");
+}
+
+/* Copies the page at SRC to the page at DST.  Both must be
+   page-aligned. */
+void
+copy_page (void *dst, const void *src) {
+	size_t words = PAGE_BYTES / 8;
+
+	ASSERT ((uintptr_t) dst % PAGE_BYTES == 0);
+	ASSERT ((uintptr_t) src % PAGE_BYTES == 0);
+
+	asm volatile ("rep movsq"
+			: "+D" (dst), "+S" (src), "+c" (words) : : "memory");
+}
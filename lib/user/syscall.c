@@ -49,7 +49,7 @@ __attribute__((always_inline)) static __inline int64_t syscall(
              ((uint64_t)ARG2), 0, 0, 0))
 
 #define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                       \
-    (syscall(((uint64_t *)NUMBER), ((uint64_t)ARG0), ((uint64_t)ARG1), \
+    (syscall(((uint64_t)NUMBER), ((uint64_t)ARG0), ((uint64_t)ARG1),   \
              ((uint64_t)ARG2), ((uint64_t)ARG3), 0, 0))
 
 #define syscall5(NUMBER, ARG0, ARG1, ARG2, ARG3, ARG4)               \
@@ -127,3 +127,25 @@ int mount(const char *path, int chan_no, int dev_no) {
 }
 
 int umount(const char *path) { return syscall1(SYS_UMOUNT, path); }
+
+tid_t clone(void (*entry)(void *), void *arg, void *stack, void *tls) {
+    return (tid_t)syscall4(SYS_CLONE, (uint64_t)entry, (uint64_t)arg,
+                           (uint64_t)stack, (uint64_t)tls);
+}
+
+void thread_exit(int status) {
+    syscall1(SYS_THREAD_EXIT, status);
+    NOT_REACHED();
+}
+
+int thread_join(tid_t tid) { return syscall1(SYS_THREAD_JOIN, tid); }
+
+int futex_wait(int *addr, int expected) {
+    return syscall2(SYS_FUTEX_WAIT, addr, expected);
+}
+
+int futex_wake(int *addr, int cnt) {
+    return syscall2(SYS_FUTEX_WAKE, addr, cnt);
+}
+
+void set_tls(void *tls) { syscall1(SYS_SET_TLS, tls); }
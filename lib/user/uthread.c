@@ -0,0 +1,182 @@
+#include <uthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+
+/* A thread's slot: its thread-local block and its stack.  The FS
+   base points to the slot, so %fs:0 finds it again. */
+struct uthread
+  {
+    struct uthread *self;       /* Must be first: read as %fs:0. */
+    int id;                     /* Slot number; 0 for the main thread. */
+    tid_t tid;                  /* Kernel thread identifier. */
+    bool in_use;                /* Allocated to a thread not yet joined? */
+    uthread_func *func;         /* Thread function. */
+    void *aux;                  /* Argument to FUNC. */
+    uint8_t stack[UTHREAD_STACK_SIZE] __attribute__ ((aligned (16)));
+  };
+
+/* Slot 0 is the main thread, which runs on the process stack. */
+static struct uthread slots[UTHREAD_MAX + 1];
+static struct umutex slots_lock = UMUTEX_INITIALIZER;
+
+static void uthread_start (void *) NO_RETURN;
+
+/* Returns the running thread's slot. */
+static struct uthread *
+uthread_current (void)
+{
+  struct uthread *t;
+
+  asm ("movq %%fs:0, %0" : "=r" (t));
+  return t;
+}
+
+/* Starts a thread running FUNC(AUX).  Returns its tid, or
+   TID_ERROR if all UTHREAD_MAX threads are in use or the kernel
+   refuses. */
+tid_t
+uthread_create (uthread_func *func, void *aux)
+{
+  struct uthread *t = NULL;
+  uint64_t *sp;
+  int i;
+
+  umutex_lock (&slots_lock);
+
+  /* The main thread's block is installed by the first call, so
+     that programs that never create a thread never pay for it. */
+  if (!slots[0].in_use)
+    {
+      slots[0].self = &slots[0];
+      slots[0].id = 0;
+      slots[0].in_use = true;
+      set_tls (&slots[0]);
+    }
+
+  for (i = 1; i <= UTHREAD_MAX; i++)
+    if (!slots[i].in_use)
+      {
+        t = &slots[i];
+        t->in_use = true;
+        break;
+      }
+  umutex_unlock (&slots_lock);
+  if (t == NULL)
+    return TID_ERROR;
+
+  t->self = t;
+  t->id = i;
+  t->func = func;
+  t->aux = aux;
+
+  /* A null return address on top, as if uthread_start() had been
+     called, keeps the stack aligned the way the ABI expects. */
+  sp = (uint64_t *) (t->stack + sizeof t->stack) - 1;
+  *sp = 0;
+
+  t->tid = clone (uthread_start, t, sp, t);
+  if (t->tid == TID_ERROR)
+    t->in_use = false;
+  return t->tid;
+}
+
+/* Waits for thread TID to exit and returns the status it passed
+   to uthread_exit(), then frees its slot.  Returns -1 if TID is
+   not a thread of this process or has already been joined. */
+int
+uthread_join (tid_t tid)
+{
+  int status = thread_join (tid);
+  int i;
+
+  umutex_lock (&slots_lock);
+  for (i = 1; i <= UTHREAD_MAX; i++)
+    if (slots[i].in_use && slots[i].tid == tid)
+      {
+        slots[i].in_use = false;
+        break;
+      }
+  umutex_unlock (&slots_lock);
+
+  return status;
+}
+
+/* Ends the running thread with STATUS.  In the main thread, ends
+   the process. */
+void
+uthread_exit (int status)
+{
+  thread_exit (status);
+}
+
+/* Returns the running thread's slot number: 0 for the main
+   thread, 1...UTHREAD_MAX for the others. */
+int
+uthread_id (void)
+{
+  return slots[0].in_use ? uthread_current ()->id : 0;
+}
+
+/* Entry point of every thread, on its own stack. */
+static void
+uthread_start (void *t_)
+{
+  struct uthread *t = t_;
+
+  t->func (t->aux);
+  uthread_exit (0);
+}
+
+/* Mutexes, after "Futexes Are Tricky" by Ulrich Drepper. */
+
+void
+umutex_init (struct umutex *m)
+{
+  m->state = 0;
+}
+
+/* Acquires M, sleeping in the kernel only if another thread
+   holds it. */
+void
+umutex_lock (struct umutex *m)
+{
+  int c = 0;
+
+  if (__atomic_compare_exchange_n (&m->state, &c, 1, false,
+                                   __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    return;
+
+  /* Contended: mark M as having waiters before sleeping, so that
+     the holder knows to wake someone up. */
+  if (c != 2)
+    c = __atomic_exchange_n (&m->state, 2, __ATOMIC_ACQUIRE);
+  while (c != 0)
+    {
+      futex_wait (&m->state, 2);
+      c = __atomic_exchange_n (&m->state, 2, __ATOMIC_ACQUIRE);
+    }
+}
+
+/* Acquires M if no thread holds it.  Returns true if
+   successful. */
+bool
+umutex_trylock (struct umutex *m)
+{
+  int c = 0;
+
+  return __atomic_compare_exchange_n (&m->state, &c, 1, false,
+                                      __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+/* Releases M, entering the kernel only if a thread may be
+   waiting for it. */
+void
+umutex_unlock (struct umutex *m)
+{
+  if (__atomic_fetch_sub (&m->state, 1, __ATOMIC_RELEASE) != 1)
+    {
+      __atomic_store_n (&m->state, 0, __ATOMIC_RELEASE);
+      futex_wake (&m->state, 1);
+    }
+}
@@ -0,0 +1,213 @@
+/* Test program and microbenchmarks for lib/kernel/bitmap.c.
+
+   Fills bitmaps of many sizes with random runs of bits and checks
+   bitmap_count(), bitmap_contains() and bitmap_scan() against the
+   bit-at-a-time loops they replaced, with and without a summary.
+   Then times the word-at-a-time versions against those loops on
+   a large, mostly full bitmap, like a disk's free map.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <bitmap.h>
+#include <debug.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+#include "devices/timer.h"
+
+/* Largest bitmap we will check. */
+#define MAX_BITS 300
+
+/* Size of the bitmap we time, and how full it is, in percent. */
+#define BENCH_BITS 32768
+#define BENCH_FULL 95
+
+static size_t ref_count (const struct bitmap *, size_t start, size_t cnt,
+                         bool);
+static bool ref_contains (const struct bitmap *, size_t start, size_t cnt,
+                          bool);
+static size_t ref_scan (const struct bitmap *, size_t start, size_t cnt,
+                        bool);
+static void randomize (struct bitmap *, bool shadow[], int density);
+static void verify_bitmap (const struct bitmap *, const bool shadow[]);
+static void bench (struct bitmap *, size_t cnt);
+
+/* Test the bitmap implementation. */
+void
+test (void)
+{
+  static bool shadow[MAX_BITS];
+  struct bitmap *b;
+  size_t size;
+
+  printf ("testing various size bitmaps:");
+  for (size = 0; size <= MAX_BITS; size += 7)
+    {
+      int repeat;
+
+      printf (" %zu", size);
+      for (repeat = 0; repeat < 20; repeat++)
+        {
+          b = bitmap_create (size);
+          ASSERT (b != NULL);
+          if (repeat % 2)
+            bitmap_enable_summary (b);
+          memset (shadow, 0, sizeof shadow);
+          randomize (b, shadow, repeat * 5);
+          verify_bitmap (b, shadow);
+          bitmap_destroy (b);
+        }
+    }
+  printf (" done\n");
+
+  /* Microbenchmarks. */
+  b = bitmap_create (BENCH_BITS);
+  ASSERT (b != NULL);
+  for (size = 0; size < BENCH_BITS; size++)
+    if (random_ulong () % 100 < BENCH_FULL)
+      bitmap_mark (b, size);
+  bench (b, 1);
+  bench (b, 8);
+  bench (b, 64);
+  bench (b, 200);
+  bitmap_enable_summary (b);
+  printf ("with summary:\n");
+  bench (b, 1);
+  bitmap_destroy (b);
+
+  printf ("bitmap: PASS\n");
+}
+
+/* Sets random runs of bits in B to random values, as well as the
+   same bits in SHADOW, with roughly DENSITY percent of the runs
+   set to true.  Flips, marks and resets some single bits too. */
+static void
+randomize (struct bitmap *b, bool shadow[], int density)
+{
+  size_t size = bitmap_size (b);
+  int i;
+
+  if (size == 0)
+    return;
+  for (i = 0; i < 40; i++)
+    {
+      size_t start = random_ulong () % size;
+      size_t cnt = random_ulong () % (size - start + 1);
+      bool value = (int) (random_ulong () % 100) < density;
+      size_t j;
+
+      switch (random_ulong () % 4)
+        {
+        case 0:
+          bitmap_set_multiple (b, start, cnt, value);
+          for (j = 0; j < cnt; j++)
+            shadow[start + j] = value;
+          break;
+        case 1:
+          bitmap_flip (b, start);
+          shadow[start] = !shadow[start];
+          break;
+        case 2:
+          bitmap_mark (b, start);
+          shadow[start] = true;
+          break;
+        case 3:
+          bitmap_reset (b, start);
+          shadow[start] = false;
+          break;
+        }
+    }
+}
+
+/* Checks that B holds the bits in SHADOW and that every range
+   query agrees with the reference loops. */
+static void
+verify_bitmap (const struct bitmap *b, const bool shadow[])
+{
+  size_t size = bitmap_size (b);
+  size_t start, i;
+
+  for (i = 0; i < size; i++)
+    ASSERT (bitmap_test (b, i) == shadow[i]);
+
+  for (start = 0; start <= size; start++)
+    for (i = 0; i < 8; i++)
+      {
+        size_t cnt = random_ulong () % (size - start + 1);
+        bool value = random_ulong () % 2;
+
+        ASSERT (bitmap_count (b, start, cnt, value)
+                == ref_count (b, start, cnt, value));
+        ASSERT (bitmap_contains (b, start, cnt, value)
+                == ref_contains (b, start, cnt, value));
+        ASSERT (bitmap_scan (b, start, cnt, value)
+                == ref_scan (b, start, cnt, value));
+        ASSERT (bitmap_scan (b, start, cnt + 3, value)
+                == ref_scan (b, start, cnt + 3, value));
+      }
+}
+
+/* Prints the time bitmap_scan() and the reference loop take to
+   find CNT false bits in B. */
+static void
+bench (struct bitmap *b, size_t cnt)
+{
+  int64_t start;
+  int64_t new_ns, ref_ns;
+  size_t idx;
+
+  start = timer_now_ns ();
+  idx = bitmap_scan (b, 0, cnt, false);
+  new_ns = timer_now_ns () - start;
+
+  start = timer_now_ns ();
+  ASSERT (ref_scan (b, 0, cnt, false) == idx);
+  ref_ns = timer_now_ns () - start;
+
+  printf ("scan for %zu false bits: found at %lld, %lld ns, "
+          "bit loop %lld ns\n", cnt,
+          idx != BITMAP_ERROR ? (long long) idx : -1LL, new_ns, ref_ns);
+}
+
+/* The bit-at-a-time loops that lib/kernel/bitmap.c used to run. */
+
+static size_t
+ref_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
+{
+  size_t i, value_cnt = 0;
+
+  for (i = 0; i < cnt; i++)
+    if (bitmap_test (b, start + i) == value)
+      value_cnt++;
+  return value_cnt;
+}
+
+static bool
+ref_contains (const struct bitmap *b, size_t start, size_t cnt, bool value)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    if (bitmap_test (b, start + i) == value)
+      return true;
+  return false;
+}
+
+static size_t
+ref_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
+{
+  if (cnt <= bitmap_size (b))
+    {
+      size_t last = bitmap_size (b) - cnt;
+      size_t i;
+
+      for (i = start; i <= last; i++)
+        if (!ref_contains (b, i, cnt, !value))
+          return i;
+    }
+  return BITMAP_ERROR;
+}
@@ -0,0 +1,159 @@
+/* Test program for lib/kernel/pheap.c.
+
+   Pushes values in random order, removes and re-keys some of
+   them, and checks that everything comes back out in order.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <pheap.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Maximum number of elements in a heap that we will test. */
+#define MAX_SIZE 64
+
+/* A heap element. */
+struct value
+  {
+    struct pheap_elem elem;     /* Heap element. */
+    int key;                    /* Ordering key. */
+    int value;                  /* Item value. */
+    bool in_heap;               /* Still in the heap? */
+  };
+
+static void shuffle (struct value[], size_t);
+static bool key_less (const struct pheap_elem *, const struct pheap_elem *,
+                      void *);
+static void count_value (struct pheap_elem *, void *);
+static void verify_heap (struct pheap *, struct value[], int size);
+
+/* Test the pairing heap implementation. */
+void
+test (void)
+{
+  int size;
+
+  printf ("testing various size heaps:");
+  for (size = 0; size < MAX_SIZE; size++)
+    {
+      int repeat;
+
+      printf (" %d", size);
+      for (repeat = 0; repeat < 10; repeat++)
+        {
+          static struct value values[MAX_SIZE];
+          struct pheap heap;
+          int i, cnt;
+
+          /* Put values 0...SIZE in random order in VALUES, with
+             keys in 0...SIZE/2 so that some of them compare
+             equal. */
+          for (i = 0; i < size; i++)
+            {
+              values[i].value = i;
+              values[i].key = i / 2;
+              values[i].in_heap = true;
+            }
+          shuffle (values, size);
+
+          /* Assemble heap. */
+          pheap_init (&heap, key_less, NULL);
+          for (i = 0; i < size; i++)
+            pheap_push (&heap, &values[i].elem);
+          ASSERT (pheap_size (&heap) == (size_t) size);
+
+          /* Every element is reachable. */
+          cnt = 0;
+          pheap_apply (&heap, count_value, &cnt);
+          ASSERT (cnt == size);
+
+          /* Remove about a quarter of the elements and change the
+             keys of another quarter. */
+          for (i = 0; i < size; i++)
+            switch (random_ulong () % 4)
+              {
+              case 0:
+                pheap_remove (&heap, &values[i].elem);
+                values[i].in_heap = false;
+                break;
+              case 1:
+                values[i].key = random_ulong () % (size + 1);
+                pheap_update (&heap, &values[i].elem);
+                break;
+              }
+
+          verify_heap (&heap, values, size);
+        }
+    }
+
+  printf (" done\n");
+  printf ("pheap: PASS\n");
+}
+
+/* Shuffles the CNT elements in ARRAY into random order. */
+static void
+shuffle (struct value *array, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      size_t j = i + random_ulong () % (cnt - i);
+      struct value t = array[j];
+      array[j] = array[i];
+      array[i] = t;
+    }
+}
+
+/* Returns true if the key of A is less than the key of B, false
+   otherwise. */
+static bool
+key_less (const struct pheap_elem *a_, const struct pheap_elem *b_,
+          void *aux UNUSED)
+{
+  const struct value *a = pheap_entry (a_, struct value, elem);
+  const struct value *b = pheap_entry (b_, struct value, elem);
+
+  return a->key < b->key;
+}
+
+/* Counts E into the int that CNT points to. */
+static void
+count_value (struct pheap_elem *e UNUSED, void *cnt)
+{
+  (*(int *) cnt)++;
+}
+
+/* Pops everything from HEAP, which must hold exactly the
+   elements of VALUES[0...SIZE] marked in_heap, and verifies that
+   keys come out in nondecreasing order. */
+static void
+verify_heap (struct pheap *heap, struct value values[], int size)
+{
+  int expected = 0;
+  int last_key = -1;
+  int i;
+
+  for (i = 0; i < size; i++)
+    if (values[i].in_heap)
+      expected++;
+  ASSERT (pheap_size (heap) == (size_t) expected);
+
+  while (!pheap_empty (heap))
+    {
+      struct value *v = pheap_entry (pheap_pop (heap), struct value, elem);
+
+      ASSERT (v->in_heap);
+      ASSERT (v->key >= last_key);
+      v->in_heap = false;
+      last_key = v->key;
+      expected--;
+    }
+  ASSERT (expected == 0);
+  ASSERT (pheap_top (heap) == NULL);
+}
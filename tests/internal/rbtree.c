@@ -0,0 +1,180 @@
+/* Test program for lib/kernel/rbtree.c.
+
+   Inserts values in random order, removes some of them, and
+   checks the red-black invariants and that an in-order walk
+   visits everything in order, equal keys in insertion order.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <rbtree.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Maximum number of elements in a tree that we will test. */
+#define MAX_SIZE 64
+
+/* A tree element. */
+struct value
+  {
+    struct rb_elem elem;        /* Tree element. */
+    int key;                    /* Ordering key. */
+    int seq;                    /* Insertion order. */
+    bool in_tree;               /* Still in the tree? */
+  };
+
+static void shuffle (struct value[], size_t);
+static bool key_less (const struct rb_elem *, const struct rb_elem *,
+                      void *);
+static int check_subtree (const struct rb_elem *);
+static void verify_tree (struct rbtree *, struct value[], int size);
+
+/* Test the red-black tree implementation. */
+void
+test (void)
+{
+  int size;
+
+  printf ("testing various size trees:");
+  for (size = 0; size < MAX_SIZE; size++)
+    {
+      int repeat;
+
+      printf (" %d", size);
+      for (repeat = 0; repeat < 10; repeat++)
+        {
+          static struct value values[MAX_SIZE];
+          struct rbtree tree;
+          int i;
+
+          /* Put keys in 0...SIZE/2 in random order in VALUES, so
+             that some of them compare equal. */
+          for (i = 0; i < size; i++)
+            {
+              values[i].key = i / 2;
+              values[i].in_tree = true;
+            }
+          shuffle (values, size);
+
+          /* Assemble tree. */
+          rb_init (&tree, key_less, NULL);
+          for (i = 0; i < size; i++)
+            {
+              values[i].seq = i;
+              rb_insert (&tree, &values[i].elem);
+            }
+          ASSERT (rb_size (&tree) == (size_t) size);
+          verify_tree (&tree, values, size);
+
+          /* Remove about half of the elements, in random order.
+             VALUES itself must not move while it is in the tree. */
+          for (i = 0; i < size; i++)
+            {
+              struct value *v = &values[random_ulong () % size];
+
+              if (v->in_tree)
+                {
+                  rb_remove (&tree, &v->elem);
+                  v->in_tree = false;
+                  verify_tree (&tree, values, size);
+                }
+            }
+
+          /* Empty the tree from the front. */
+          while (!rb_empty (&tree))
+            rb_remove (&tree, rb_min (&tree));
+          ASSERT (tree.root == NULL);
+          ASSERT (rb_min (&tree) == NULL);
+        }
+    }
+
+  printf (" done\n");
+  printf ("rbtree: PASS\n");
+}
+
+/* Shuffles the CNT elements in ARRAY into random order. */
+static void
+shuffle (struct value *array, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      size_t j = i + random_ulong () % (cnt - i);
+      struct value t = array[j];
+      array[j] = array[i];
+      array[i] = t;
+    }
+}
+
+/* Returns true if the key of A is less than the key of B, false
+   otherwise. */
+static bool
+key_less (const struct rb_elem *a_, const struct rb_elem *b_,
+          void *aux UNUSED)
+{
+  const struct value *a = rb_entry (a_, struct value, elem);
+  const struct value *b = rb_entry (b_, struct value, elem);
+
+  return a->key < b->key;
+}
+
+/* Checks the parent links and coloring of the subtree rooted at E
+   and returns its black height. */
+static int
+check_subtree (const struct rb_elem *e)
+{
+  int left, right;
+
+  if (e == NULL)
+    return 1;
+  if (e->left != NULL)
+    ASSERT (e->left->parent == e);
+  if (e->right != NULL)
+    ASSERT (e->right->parent == e);
+  if (e->red)
+    ASSERT ((e->left == NULL || !e->left->red)
+            && (e->right == NULL || !e->right->red));
+
+  left = check_subtree (e->left);
+  right = check_subtree (e->right);
+  ASSERT (left == right);
+  return left + !e->red;
+}
+
+/* Checks that TREE holds exactly the elements of VALUES[0...SIZE]
+   marked in_tree, in order. */
+static void
+verify_tree (struct rbtree *tree, struct value values[], int size)
+{
+  const struct value *prev = NULL;
+  struct rb_elem *e;
+  int expected = 0;
+  int i;
+
+  for (i = 0; i < size; i++)
+    if (values[i].in_tree)
+      expected++;
+  ASSERT (rb_size (tree) == (size_t) expected);
+
+  ASSERT (tree->root == NULL || !tree->root->red);
+  ASSERT (tree->root == NULL || tree->root->parent == NULL);
+  check_subtree (tree->root);
+
+  for (e = rb_min (tree); e != NULL; e = rb_next (e))
+    {
+      const struct value *v = rb_entry (e, struct value, elem);
+
+      ASSERT (v->in_tree);
+      if (prev != NULL)
+        ASSERT (prev->key < v->key
+                || (prev->key == v->key && prev->seq < v->seq));
+      prev = v;
+      expected--;
+    }
+  ASSERT (expected == 0);
+}
@@ -33,6 +33,23 @@ sub check_expected {
     compare_output ("run", @options, \@output, $expected);
 }
 
+# Checks that the run's output has every line in @$LINES and, for
+# every regex in @$RATES, a line that matches it, in any order.
+# For tests that print rates or times, which vary from run to run.
+sub check_lines_and_rates {
+    my ($lines, $rates) = @_;
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+    @output = get_core_output ("run", @output);
+
+    foreach my $line (@$lines) {
+	fail "missing \"$line\"\n" unless grep ($_ eq $line, @output);
+    }
+    foreach my $rate (@$rates) {
+	fail "no line matches $rate\n" unless grep (/$rate/, @output);
+    }
+}
+
 sub common_checks {
     my ($run, @output) = @_;
 
@@ -0,0 +1,101 @@
+/* Checks that the completely fair scheduler divides the CPU in
+   proportion to the threads' nice weights.
+
+   Four threads with nice values 0, 0, 5 and -5 spin counting
+   loop iterations for 5 seconds while the main thread sleeps.
+   Each thread's share of the iterations must come within 20% of
+   its share of the total weight, which is about 18%, 18%, 6% and
+   57% of the CPU.  Must be run with -cfs. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 4
+
+struct worker
+  {
+    int nice;                   /* Nice value to run at. */
+    int weight;                 /* CFS weight of NICE. */
+    long long iterations;       /* Iterations counted. */
+    struct semaphore done;      /* Upped when the thread exits. */
+  };
+
+/* Nice values and their weights in the scheduler's table. */
+static const int nices[THREAD_CNT] = {0, 0, 5, -5};
+static const int weights[THREAD_CNT] = {1024, 1024, 335, 3121};
+
+static volatile bool counting;
+static volatile bool stop;
+
+static thread_func spin_thread;
+
+void
+test_cfs_fair (void)
+{
+  struct worker workers[THREAD_CNT];
+  long long total_iterations = 0;
+  int total_weight = 0;
+  int i;
+
+  ASSERT (thread_cfs);
+
+  counting = stop = false;
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      char name[16];
+
+      workers[i].nice = nices[i];
+      workers[i].weight = weights[i];
+      workers[i].iterations = 0;
+      sema_init (&workers[i].done, 0);
+      total_weight += weights[i];
+      snprintf (name, sizeof name, "nice %d", nices[i]);
+      thread_create (name, PRI_DEFAULT, spin_thread, &workers[i]);
+    }
+
+  /* Give every thread time to set its nice value. */
+  timer_sleep (TIMER_FREQ);
+  msg ("Counting for 5 seconds...");
+  counting = true;
+  timer_sleep (5 * TIMER_FREQ);
+  counting = false;
+  stop = true;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      sema_down (&workers[i].done);
+      total_iterations += workers[i].iterations;
+    }
+  if (total_iterations == 0)
+    fail ("no iterations counted");
+
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      /* Compare shares in units of 1/1000. */
+      long long expected = 1000LL * workers[i].weight / total_weight;
+      long long actual = 1000 * workers[i].iterations / total_iterations;
+
+      if (actual * 5 < expected * 4 || actual * 5 > expected * 6)
+        fail ("thread with nice %d got %lld/1000 of the CPU, "
+              "expected %lld/1000", workers[i].nice, actual, expected);
+      msg ("Thread with nice %d got its fair share.", workers[i].nice);
+    }
+}
+
+static void
+spin_thread (void *w_)
+{
+  struct worker *w = w_;
+  long long iterations = 0;
+
+  thread_set_nice (w->nice);
+  while (!stop)
+    if (counting)
+      iterations++;
+  w->iterations = iterations;
+  sema_up (&w->done);
+}
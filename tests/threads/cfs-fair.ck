@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(cfs-fair) begin
+(cfs-fair) Counting for 5 seconds...
+(cfs-fair) Thread with nice 0 got its fair share.
+(cfs-fair) Thread with nice 0 got its fair share.
+(cfs-fair) Thread with nice 5 got its fair share.
+(cfs-fair) Thread with nice -5 got its fair share.
+(cfs-fair) end
+EOF
+pass;
@@ -0,0 +1,101 @@
+/* Exercises the deadline (EDF) scheduling class.
+
+   Admission control must accept 60% of the CPU, then refuse
+   96% and parameters that make no sense.
+
+   Two deadline threads that wake up in the same timer tick must
+   preempt the main thread, even though it has the highest
+   priority, and must run earliest deadline first.
+
+   A deadline thread that spins must be throttled once it has
+   used its runtime for the period, so that the main thread still
+   gets to run. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* One millisecond in nanoseconds. */
+#define MS 1000000LL
+
+struct dl_thread
+  {
+    const char *name;
+    int64_t deadline;           /* Relative deadline, in ns. */
+  };
+
+static int64_t wake_tick;
+static volatile int finished;
+static volatile bool stop;
+static struct semaphore done;
+
+static thread_func wake_thread, spin_thread;
+
+void
+test_deadline_edf (void)
+{
+  static struct dl_thread threads[2] = {
+    {"dl-late", 50 * MS},
+    {"dl-early", 20 * MS},
+  };
+  int i;
+
+  /* Admission control. */
+  if (!thread_set_deadline (60 * MS, 100 * MS, 100 * MS))
+    fail ("60% was refused");
+  msg ("60% admitted.");
+  if (thread_set_deadline (96 * MS, 100 * MS, 100 * MS))
+    fail ("96% was admitted");
+  msg ("96% refused.");
+  if (thread_set_deadline (20 * MS, 10 * MS, 100 * MS))
+    fail ("runtime longer than deadline was admitted");
+  msg ("Runtime longer than deadline refused.");
+  thread_set_deadline (0, 0, 0);
+
+  /* EDF order, ahead of the normal classes. */
+  sema_init (&done, 0);
+  finished = 0;
+  wake_tick = timer_ticks () + TIMER_FREQ / 2;
+  for (i = 0; i < 2; i++)
+    thread_create (threads[i].name, PRI_MAX - 1, wake_thread, &threads[i]);
+  thread_set_priority (PRI_MAX);
+  while (finished < 2 && timer_ticks () < wake_tick + TIMER_FREQ)
+    continue;
+  if (finished < 2)
+    fail ("deadline threads did not preempt main");
+  msg ("Main sees both deadline threads finished.");
+
+  /* Throttling. */
+  thread_set_priority (PRI_DEFAULT);
+  stop = false;
+  thread_create ("dl-spin", PRI_MAX, spin_thread, NULL);
+  msg ("Main runs while dl-spin spins.");
+  stop = true;
+  sema_down (&done);
+}
+
+static void
+wake_thread (void *dl_)
+{
+  struct dl_thread *dl = dl_;
+
+  if (!thread_set_deadline (10 * MS, dl->deadline, 100 * MS))
+    fail ("%s was refused", dl->name);
+  thread_sleep (wake_tick);
+  msg ("%s runs.", dl->name);
+  finished++;
+}
+
+static void
+spin_thread (void *aux UNUSED)
+{
+  if (!thread_set_deadline (20 * MS, 100 * MS, 100 * MS))
+    fail ("dl-spin was refused");
+  while (!stop)
+    continue;
+  msg ("dl-spin stops.");
+  sema_up (&done);
+}
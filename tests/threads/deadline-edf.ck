@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(deadline-edf) begin
+(deadline-edf) 60% admitted.
+(deadline-edf) 96% refused.
+(deadline-edf) Runtime longer than deadline refused.
+(deadline-edf) dl-early runs.
+(deadline-edf) dl-late runs.
+(deadline-edf) Main sees both deadline threads finished.
+(deadline-edf) Main runs while dl-spin spins.
+(deadline-edf) dl-spin stops.
+(deadline-edf) end
+EOF
+pass;
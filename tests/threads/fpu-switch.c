@@ -0,0 +1,146 @@
+/* Checks that every thread keeps its own FPU registers.  The
+   kernel switches them lazily: a thread switch only sets CR0.TS,
+   and the first FPU instruction of the next thread traps (#NM) so
+   the old owner's registers are saved and the new one's loaded.
+
+   The main thread and THREAD_CNT others, all of equal priority,
+   each load their own values into two SSE registers, the x87
+   stack and MXCSR.  They then yield to each other ROUNDS times,
+   checking after every switch that the values are still theirs.
+
+   The kernel is compiled with -mno-sse, so the registers are only
+   reached through asm. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define THREAD_CNT 3
+#define ROUNDS 50
+
+/* The FPU registers this test uses. */
+struct fpu_regs
+  {
+    uint64_t xmm0;              /* Low half of %xmm0. */
+    uint64_t xmm15;             /* Low half of %xmm15. */
+    int64_t st0;                /* Top of the x87 stack. */
+    uint32_t mxcsr;             /* SSE control and status. */
+  };
+
+struct fpu_thread
+  {
+    int id;                     /* 1...THREAD_CNT. */
+    const char *lost;           /* First register found changed. */
+    struct semaphore done;      /* Up'd when the thread is done. */
+  };
+
+static thread_func fpu_thread;
+static const char *check_regs (int id);
+
+void
+test_fpu_switch (void)
+{
+  struct fpu_thread threads[THREAD_CNT];
+  const char *lost;
+  int i;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      struct fpu_thread *ft = &threads[i];
+      char name[16];
+
+      ft->id = i + 1;
+      ft->lost = NULL;
+      sema_init (&ft->done, 0);
+      snprintf (name, sizeof name, "fpu %d", ft->id);
+      thread_create (name, thread_get_priority (), fpu_thread, ft);
+    }
+
+  lost = check_regs (0);
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&threads[i].done);
+
+  if (lost != NULL)
+    fail ("main thread lost its %s", lost);
+  msg ("Main thread kept its FPU registers across %d yields.", ROUNDS);
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      if (threads[i].lost != NULL)
+        fail ("thread %d lost its %s", threads[i].id, threads[i].lost);
+      msg ("Thread %d kept its FPU registers across %d yields.",
+           threads[i].id, ROUNDS);
+    }
+}
+
+static void
+fpu_thread (void *ft_)
+{
+  struct fpu_thread *ft = ft_;
+
+  ft->lost = check_regs (ft->id);
+  sema_up (&ft->done);
+}
+
+/* Fills REGS with values that differ for each ID. */
+static void
+make_regs (int id, struct fpu_regs *regs)
+{
+  regs->xmm0 = 0x0101010101010101ULL * (id + 1);
+  regs->xmm15 = ~regs->xmm0;
+  regs->st0 = -1000003LL * (id + 1);
+
+  /* Default MXCSR, all exceptions masked, with a rounding mode
+     of its own. */
+  regs->mxcsr = 0x1f80 | (id % 4) << 13;
+}
+
+/* Loads REGS into the FPU, on a fresh x87 stack. */
+static void
+load_regs (const struct fpu_regs *regs)
+{
+  asm volatile ("movq %0, %%xmm0" : : "r" (regs->xmm0));
+  asm volatile ("movq %0, %%xmm15" : : "r" (regs->xmm15));
+  asm volatile ("fninit; fildq %0" : : "m" (regs->st0));
+  asm volatile ("ldmxcsr %0" : : "m" (regs->mxcsr));
+}
+
+/* Reads the FPU into REGS without popping the x87 stack. */
+static void
+save_regs (struct fpu_regs *regs)
+{
+  asm volatile ("movq %%xmm0, %0" : "=r" (regs->xmm0));
+  asm volatile ("movq %%xmm15, %0" : "=r" (regs->xmm15));
+  asm volatile ("fld %%st(0); fistpq %0" : "=m" (regs->st0));
+  asm volatile ("stmxcsr %0" : "=m" (regs->mxcsr));
+}
+
+/* Loads ID's registers, then yields ROUNDS times, checking the
+   registers after each yield.  Returns the name of the first
+   register found changed, or a null pointer if none was. */
+static const char *
+check_regs (int id)
+{
+  struct fpu_regs want, got;
+  int i;
+
+  make_regs (id, &want);
+  load_regs (&want);
+  for (i = 0; i < ROUNDS; i++)
+    {
+      thread_yield ();
+      save_regs (&got);
+      if (got.xmm0 != want.xmm0)
+        return "%xmm0";
+      if (got.xmm15 != want.xmm15)
+        return "%xmm15";
+      if (got.st0 != want.st0)
+        return "%st(0)";
+      if (got.mxcsr != want.mxcsr)
+        return "MXCSR";
+    }
+  asm volatile ("fninit");
+  return NULL;
+}
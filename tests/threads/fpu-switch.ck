@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fpu-switch) begin
+(fpu-switch) Main thread kept its FPU registers across 50 yields.
+(fpu-switch) Thread 1 kept its FPU registers across 50 yields.
+(fpu-switch) Thread 2 kept its FPU registers across 50 yields.
+(fpu-switch) Thread 3 kept its FPU registers across 50 yields.
+(fpu-switch) end
+EOF
+pass;
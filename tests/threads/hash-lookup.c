@@ -0,0 +1,206 @@
+/* Builds a hash table of 100,000 pages keyed by address, the
+   way a process's supplemental page table would hold a large
+   address space, and checks that every page is found, that
+   addresses not in the table are not, and that the table stays
+   right while it is resized by insertions and deletions.
+
+   Then prints the nanoseconds a lookup takes, as in a page
+   fault, for pages visited in scattered order and for addresses
+   not in the table, hashing the address with hash_u64() and,
+   for comparison, with hash_bytes().  Those lookups too must
+   find every page and nothing else. */
+
+#include <hash.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define PAGE_CNT 100000
+#define LOOKUP_CNT 1000000
+
+/* Steps through the pages in scattered order; prime, so it
+   visits each one. */
+#define STRIDE 7919
+
+/* Base of the address space. */
+#define BASE ((uint8_t *) 0x400000)
+
+/* A page, as the supplemental page table sees it. */
+struct test_page
+  {
+    void *va;
+    struct hash_elem elem;
+  };
+
+static struct test_page *pages;
+
+static hash_hash_func page_hash_u64, page_hash_bytes;
+static hash_less_func page_less;
+static void check (struct hash *);
+static void build (struct hash *, hash_hash_func *);
+static void bench (const char *name, hash_hash_func *);
+static struct test_page *lookup (struct hash *, void *va);
+
+void
+test_hash_lookup (void)
+{
+  struct hash h;
+
+  pages = malloc (sizeof *pages * PAGE_CNT);
+  ASSERT (pages != NULL);
+
+  build (&h, page_hash_u64);
+  check (&h);
+  hash_destroy (&h, NULL);
+  msg ("Lookups match while resizing.");
+
+  bench ("hash_u64", page_hash_u64);
+  bench ("hash_bytes", page_hash_bytes);
+
+  free (pages);
+}
+
+/* Initializes H with hash function HASH and inserts every page. */
+static void
+build (struct hash *h, hash_hash_func *hash)
+{
+  int i;
+
+  if (!hash_init (h, hash, page_less, NULL))
+    fail ("out of memory");
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      pages[i].va = BASE + (size_t) i * PGSIZE;
+      if (!hash_insert (h, &pages[i].elem, NULL))
+        fail ("page %d not inserted", i);
+    }
+}
+
+/* Checks H, holding every page, then deletes and reinserts pages
+   to make it shrink and grow again. */
+static void
+check (struct hash *h)
+{
+  struct hash_iterator it;
+  struct test_page dup;
+  struct hash_elem *old;
+  size_t cnt;
+  int i;
+
+  if (hash_size (h) != PAGE_CNT)
+    fail ("table has %zu pages, not %d", hash_size (h), PAGE_CNT);
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      if (lookup (h, pages[i].va) != &pages[i])
+        fail ("page %d not found", i);
+      if (lookup (h, (uint8_t *) pages[i].va + PAGE_CNT * PGSIZE) != NULL)
+        fail ("page %d found past the end", i);
+    }
+
+  /* A second page at an address already in the table is refused,
+     and the one there is reported. */
+  dup.va = pages[PAGE_CNT / 2].va;
+  if (hash_insert (h, &dup.elem, &old) || old != &pages[PAGE_CNT / 2].elem)
+    fail ("duplicate page inserted or not reported");
+
+  /* Delete all but every 64th page, then put them back. */
+  for (i = 0; i < PAGE_CNT; i++)
+    if (i % 64 != 0 && hash_delete (h, &pages[i].elem) != &pages[i].elem)
+      fail ("page %d not deleted", i);
+  for (i = 0; i < PAGE_CNT; i++)
+    if ((lookup (h, pages[i].va) != NULL) != (i % 64 == 0))
+      fail ("page %d wrong after deletion", i);
+  for (i = 0; i < PAGE_CNT; i++)
+    if (i % 64 != 0 && !hash_insert (h, &pages[i].elem, NULL))
+      fail ("page %d not reinserted", i);
+
+  cnt = 0;
+  hash_first (&it, h);
+  while (hash_next (&it))
+    cnt++;
+  if (cnt != PAGE_CNT)
+    fail ("iteration visited %zu pages, not %d", cnt, PAGE_CNT);
+  for (i = 0; i < PAGE_CNT; i++)
+    if (lookup (h, pages[i].va) != &pages[i])
+      fail ("page %d not found after reinsertion", i);
+}
+
+/* Times LOOKUP_CNT lookups of pages in a table hashed with HASH,
+   and as many of addresses not in it. */
+static void
+bench (const char *name, hash_hash_func *hash)
+{
+  struct hash h;
+  int64_t start, hit_ns, miss_ns;
+  size_t idx;
+  int found;
+  int i;
+
+  build (&h, hash);
+
+  found = 0;
+  idx = 0;
+  start = timer_now_ns ();
+  for (i = 0; i < LOOKUP_CNT; i++)
+    {
+      found += lookup (&h, BASE + idx * PGSIZE) != NULL;
+      idx = (idx + STRIDE) % PAGE_CNT;
+    }
+  hit_ns = timer_now_ns () - start;
+  if (found != LOOKUP_CNT)
+    fail ("%s: %d of %d pages found", name, found, LOOKUP_CNT);
+
+  found = 0;
+  start = timer_now_ns ();
+  for (i = 0; i < LOOKUP_CNT; i++)
+    {
+      found += lookup (&h, BASE + (PAGE_CNT + idx) * PGSIZE) != NULL;
+      idx = (idx + STRIDE) % PAGE_CNT;
+    }
+  miss_ns = timer_now_ns () - start;
+  if (found != 0)
+    fail ("%s: %d missing pages found", name, found);
+  msg ("%s: every page found, no other address.", name);
+
+  msg ("%s: %lld ns per hit, %lld ns per miss.", name,
+       hit_ns / LOOKUP_CNT, miss_ns / LOOKUP_CNT);
+  hash_destroy (&h, NULL);
+}
+
+/* Returns the page at VA in H, the way spt_find_page() finds it,
+   or a null pointer. */
+static struct test_page *
+lookup (struct hash *h, void *va)
+{
+  struct test_page key;
+  struct hash_elem *e;
+
+  key.va = va;
+  e = hash_find (h, &key.elem);
+  return e != NULL ? hash_entry (e, struct test_page, elem) : NULL;
+}
+
+static uint64_t
+page_hash_u64 (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_u64 ((uint64_t) hash_entry (e, struct test_page, elem)->va);
+}
+
+static uint64_t
+page_hash_bytes (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct test_page *p = hash_entry (e, struct test_page, elem);
+  return hash_bytes (&p->va, sizeof p->va);
+}
+
+static bool
+page_less (const struct hash_elem *a, const struct hash_elem *b,
+           void *aux UNUSED)
+{
+  return (hash_entry (a, struct test_page, elem)->va
+          < hash_entry (b, struct test_page, elem)->va);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_lines_and_rates
+  (["(hash-lookup) Lookups match while resizing.",
+    "(hash-lookup) hash_u64: every page found, no other address.",
+    "(hash-lookup) hash_bytes: every page found, no other address."],
+   [map (qr/^\(hash-lookup\) $_: \d+ ns per hit, \d+ ns per miss\.$/,
+	 "hash_u64", "hash_bytes")]);
+pass;
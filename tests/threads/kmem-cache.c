@@ -0,0 +1,178 @@
+/* Checks object caches and compares them with malloc().
+
+   First, objects from a cache with a constructor must all be
+   constructed, and must keep their constructed state across
+   kmem_cache_free() and kmem_cache_alloc().  Objects from
+   kmem_cache_zalloc() must be zeroed.
+
+   Then, for 72-byte objects, which malloc() rounds up to 128
+   bytes, prints the memory each allocator uses per object when
+   holding many of them, and the allocations each can make per
+   second when objects are allocated and freed in small batches,
+   the way page faults and open() use them.  The cache must have
+   no objects left in use afterward. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define OBJ_CNT 1000
+#define BATCH 16
+#define MAGIC 0x1234abcd
+
+/* A 72-byte object. */
+struct obj
+  {
+    int magic;
+    int id;
+    char data[64];
+  };
+
+static struct kmem_cache ctor_cache, bench_cache;
+static void *objs[OBJ_CNT];
+static void *pages[OBJ_CNT];
+
+static void obj_ctor (void *);
+static size_t count_pages (void);
+static long long run_bench (bool kmem);
+
+void
+test_kmem_cache (void)
+{
+  int i;
+
+  kmem_cache_init (&ctor_cache, "test-ctor", sizeof (struct obj), obj_ctor);
+  kmem_cache_init (&bench_cache, "test-bench", sizeof (struct obj), NULL);
+
+  /* Constructed state. */
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      struct obj *o = kmem_cache_alloc (&ctor_cache);
+
+      ASSERT (o != NULL);
+      if (o->magic != MAGIC)
+        fail ("object %d not constructed", i);
+      o->id = i;
+      objs[i] = o;
+    }
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (&ctor_cache, objs[i]);
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      struct obj *o = kmem_cache_alloc (&ctor_cache);
+
+      ASSERT (o != NULL);
+      if (o->magic != MAGIC)
+        fail ("object %d lost its constructed state", i);
+      objs[i] = o;
+    }
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (&ctor_cache, objs[i]);
+  msg ("Constructed objects survive reuse.");
+
+  /* Zeroed objects, after poisoning on free. */
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      struct obj *o = kmem_cache_zalloc (&bench_cache);
+      size_t j;
+
+      ASSERT (o != NULL);
+      for (j = 0; j < sizeof *o; j++)
+        if (((char *) o)[j] != 0)
+          fail ("object %d not zeroed", i);
+      memset (o, 0x5a, sizeof *o);
+      objs[i] = o;
+    }
+
+  /* Footprint, counted in pages touched. */
+  msg ("kmem: %zu bytes per object.", count_pages () * PGSIZE / OBJ_CNT);
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (&bench_cache, objs[i]);
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      objs[i] = malloc (sizeof (struct obj));
+      ASSERT (objs[i] != NULL);
+    }
+  msg ("malloc: %zu bytes per object.", count_pages () * PGSIZE / OBJ_CNT);
+  for (i = 0; i < OBJ_CNT; i++)
+    free (objs[i]);
+
+  /* Throughput. */
+  msg ("kmem: %lld allocs per second.", run_bench (true));
+  msg ("malloc: %lld allocs per second.", run_bench (false));
+  if (bench_cache.active != 0 || bench_cache.allocs != bench_cache.frees)
+    fail ("%lld allocs, %lld frees, %zu objects in use",
+          bench_cache.allocs, bench_cache.frees, bench_cache.active);
+  msg ("Every kmem allocation was freed.");
+}
+
+static void
+obj_ctor (void *o_)
+{
+  struct obj *o = o_;
+
+  o->magic = MAGIC;
+  o->id = -1;
+}
+
+/* Returns the number of distinct pages that OBJS points into. */
+static size_t
+count_pages (void)
+{
+  size_t cnt = 0;
+  int i;
+
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      void *page = pg_round_down (objs[i]);
+      size_t j;
+
+      for (j = 0; j < cnt; j++)
+        if (pages[j] == page)
+          break;
+      if (j == cnt)
+        pages[cnt++] = page;
+    }
+  return cnt;
+}
+
+/* For one second, allocates and frees BATCH objects at a time
+   with kmem_cache_alloc() if KMEM, otherwise with malloc().
+   Returns the number of allocations. */
+static long long
+run_bench (bool kmem)
+{
+  long long allocs = 0;
+  int64_t end_tick;
+
+  /* Start on a tick boundary. */
+  end_tick = timer_ticks ();
+  while (timer_ticks () == end_tick)
+    continue;
+  end_tick = timer_ticks () + TIMER_FREQ;
+
+  while (timer_ticks () < end_tick)
+    {
+      int i;
+
+      for (i = 0; i < BATCH; i++)
+        {
+          objs[i] = kmem ? kmem_cache_alloc (&bench_cache)
+                         : malloc (sizeof (struct obj));
+          if (objs[i] == NULL)
+            fail ("out of memory");
+        }
+      for (i = 0; i < BATCH; i++)
+        if (kmem)
+          kmem_cache_free (&bench_cache, objs[i]);
+        else
+          free (objs[i]);
+      allocs += BATCH;
+    }
+  return allocs;
+}
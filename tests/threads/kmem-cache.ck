@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_lines_and_rates
+  (["(kmem-cache) Constructed objects survive reuse.",
+    "(kmem-cache) Every kmem allocation was freed."],
+   [map ((qr/^\(kmem-cache\) $_: \d+ bytes per object\.$/,
+	  qr/^\(kmem-cache\) $_: \d+ allocs per second\.$/),
+	 "kmem", "malloc")]);
+pass;
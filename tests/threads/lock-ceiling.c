@@ -0,0 +1,131 @@
+/* Checks priority-ceiling locks and compares their cost with
+   locks that donate priority.
+
+   First, a thread holding nested ceiling locks must run at the
+   highest of their ceilings and drop back as it releases them.
+
+   Then, for one second each, four threads of increasing priority
+   take a pair of nested locks over and over: ordinary locks,
+   then ceiling locks.  The lowest-priority thread never sleeps;
+   the others sleep for a tick after every batch, so every tick
+   they wake up and preempt it, often while it holds the locks.
+   With ordinary locks they then donate to it; with ceiling locks
+   it already runs at the ceiling and is not preempted inside.
+   Prints the lock pairs taken per second for each. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 4
+#define BATCH 64
+
+static struct lock outer_lock, inner_lock;
+static struct ceiling_lock outer_ceiling, inner_ceiling;
+static bool use_ceiling;
+static int64_t end_tick;
+static long long pairs[THREAD_CNT];
+static struct semaphore done;
+
+static thread_func lock_thread;
+static long long run_bench (bool ceiling);
+
+void
+test_lock_ceiling (void)
+{
+  struct ceiling_lock low, high;
+
+  /* This test relies on priority scheduling. */
+  ASSERT (!thread_mlfqs);
+
+  ceiling_lock_init (&high, PRI_DEFAULT + 20);
+  ceiling_lock_init (&low, PRI_DEFAULT + 10);
+  ceiling_lock_acquire (&high);
+  msg ("Holding high, priority %d.", thread_get_priority () - PRI_DEFAULT);
+  ceiling_lock_acquire (&low);
+  msg ("Holding high and low, priority %d.",
+       thread_get_priority () - PRI_DEFAULT);
+  ceiling_lock_release (&low);
+  msg ("Holding high, priority %d.", thread_get_priority () - PRI_DEFAULT);
+  ceiling_lock_release (&high);
+  msg ("Holding nothing, priority %d.", thread_get_priority () - PRI_DEFAULT);
+
+  msg ("donation: %lld lock pairs per second.", run_bench (false));
+  msg ("ceiling: %lld lock pairs per second.", run_bench (true));
+}
+
+/* Runs the threads for one second with ordinary locks, or with
+   ceiling locks if CEILING, and returns the lock pairs taken. */
+static long long
+run_bench (bool ceiling)
+{
+  long long total = 0;
+  int i;
+
+  lock_init (&outer_lock);
+  lock_init (&inner_lock);
+  ceiling_lock_init (&outer_ceiling, PRI_DEFAULT + THREAD_CNT);
+  ceiling_lock_init (&inner_ceiling, PRI_DEFAULT + THREAD_CNT);
+  use_ceiling = ceiling;
+  sema_init (&done, 0);
+
+  /* Start on a tick boundary. */
+  end_tick = timer_ticks ();
+  while (timer_ticks () == end_tick)
+    continue;
+  end_tick = timer_ticks () + TIMER_FREQ;
+
+  /* Create every thread before any of them runs. */
+  thread_set_priority (PRI_MAX);
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      char name[16];
+
+      pairs[i] = 0;
+      snprintf (name, sizeof name, "locker %d", i);
+      thread_create (name, PRI_DEFAULT + 1 + i, lock_thread,
+                     (void *) (intptr_t) i);
+    }
+  thread_set_priority (PRI_DEFAULT);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      sema_down (&done);
+      total += pairs[i];
+    }
+  return total;
+}
+
+static void
+lock_thread (void *idx_)
+{
+  int idx = (intptr_t) idx_;
+
+  while (timer_ticks () < end_tick)
+    {
+      int i;
+
+      for (i = 0; i < BATCH; i++)
+        if (use_ceiling)
+          {
+            ceiling_lock_acquire (&outer_ceiling);
+            ceiling_lock_acquire (&inner_ceiling);
+            ceiling_lock_release (&inner_ceiling);
+            ceiling_lock_release (&outer_ceiling);
+          }
+        else
+          {
+            lock_acquire (&outer_lock);
+            lock_acquire (&inner_lock);
+            lock_release (&inner_lock);
+            lock_release (&outer_lock);
+          }
+      pairs[idx] += BATCH;
+      if (idx > 0)
+        timer_sleep (1);
+    }
+  sema_up (&done);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_lines_and_rates
+  (["(lock-ceiling) Holding high, priority 20.",
+    "(lock-ceiling) Holding high and low, priority 20.",
+    "(lock-ceiling) Holding high, priority 20.",
+    "(lock-ceiling) Holding nothing, priority 0."],
+   [qr/^\(lock-ceiling\) donation: \d+ lock pairs per second\.$/,
+    qr/^\(lock-ceiling\) ceiling: \d+ lock pairs per second\.$/]);
+pass;
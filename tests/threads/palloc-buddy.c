@@ -0,0 +1,117 @@
+/* Checks the buddy page allocator.
+
+   Fragments the kernel pool by freeing every other page of a run
+   of single pages, then allocates blocks of three pages among the
+   holes and checks that none of them overlap.  Once everything is
+   freed, the free blocks of every order must be exactly as they
+   were at the start, which they only are if freed pages merge
+   back with their buddies.
+
+   Then, on the fragmented pool, times allocating and freeing
+   8-page blocks for one second and prints how many it managed.
+   That too must leave the free blocks as they were. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define PAGE_CNT 512
+#define BLOCK_CNT 64
+#define BLOCK_PAGES 3
+#define BENCH_PAGES 8
+
+static void *pages[PAGE_CNT];
+static void *blocks[BLOCK_CNT];
+static size_t counts[PALLOC_ORDERS];
+
+static void fragment (void);
+static void unfragment (void);
+static void check_counts (void);
+
+void
+test_palloc_buddy (void)
+{
+  long long allocs = 0;
+  int64_t end_tick;
+  unsigned order;
+  int i, j;
+
+  for (order = 0; order < PALLOC_ORDERS; order++)
+    counts[order] = palloc_free_blocks (0, order);
+
+  /* Blocks among the holes. */
+  fragment ();
+  for (i = 0; i < BLOCK_CNT; i++)
+    {
+      blocks[i] = palloc_get_multiple (PAL_ASSERT, BLOCK_PAGES);
+      for (j = 0; j < BLOCK_PAGES; j++)
+        memset (blocks[i] + j * PGSIZE, i, PGSIZE);
+    }
+  for (i = 0; i < BLOCK_CNT; i++)
+    for (j = 0; j < BLOCK_PAGES * PGSIZE; j++)
+      if (((uint8_t *) blocks[i])[j] != (uint8_t) i)
+        fail ("block %d overwritten at byte %d", i, j);
+  msg ("Multi-page blocks do not overlap.");
+
+  for (i = 0; i < BLOCK_CNT; i++)
+    palloc_free_multiple (blocks[i], BLOCK_PAGES);
+  unfragment ();
+  check_counts ();
+  msg ("Freed pages merge back.");
+
+  /* Throughput. */
+  fragment ();
+  end_tick = timer_ticks ();
+  while (timer_ticks () == end_tick)
+    continue;
+  end_tick = timer_ticks () + TIMER_FREQ;
+  while (timer_ticks () < end_tick)
+    {
+      void *block = palloc_get_multiple (PAL_ASSERT, BENCH_PAGES);
+
+      palloc_free_multiple (block, BENCH_PAGES);
+      allocs++;
+    }
+  unfragment ();
+  check_counts ();
+  msg ("Benchmark leaves the free blocks as they were.");
+  msg ("%lld %d-page allocs per second.", allocs, BENCH_PAGES);
+}
+
+/* Allocates PAGE_CNT single pages and frees every other one. */
+static void
+fragment (void)
+{
+  int i;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    pages[i] = palloc_get_page (PAL_ASSERT);
+  for (i = 1; i < PAGE_CNT; i += 2)
+    palloc_free_page (pages[i]);
+}
+
+/* Frees the pages that fragment() kept. */
+static void
+unfragment (void)
+{
+  int i;
+
+  for (i = 0; i < PAGE_CNT; i += 2)
+    palloc_free_page (pages[i]);
+}
+
+/* Fails unless the kernel pool's free blocks are as at the start. */
+static void
+check_counts (void)
+{
+  unsigned order;
+
+  for (order = 0; order < PALLOC_ORDERS; order++)
+    if (palloc_free_blocks (0, order) != counts[order])
+      fail ("%zu free blocks of order %u, expected %zu",
+            palloc_free_blocks (0, order), order, counts[order]);
+}
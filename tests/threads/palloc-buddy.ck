@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_lines_and_rates
+  (["(palloc-buddy) Multi-page blocks do not overlap.",
+    "(palloc-buddy) Freed pages merge back.",
+    "(palloc-buddy) Benchmark leaves the free blocks as they were."],
+   [qr/^\(palloc-buddy\) \d+ 8-page allocs per second\.$/]);
+pass;
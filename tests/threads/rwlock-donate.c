@@ -0,0 +1,78 @@
+/* The main thread reads a file, guarded by a readers-writer lock
+   the way every inode is.  A higher-priority writer then waits
+   for the main thread to finish reading, so it must donate its
+   priority to the main thread, the lone reader.  A still
+   higher-priority reader that queues behind the writer donates
+   to the writer, and through it to the main thread.
+
+   A medium-priority thread created meanwhile must not run before
+   the writer and the reader, or the writer would wait on a
+   thread that cannot run: priority inversion. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func writer_thread;
+static thread_func reader_thread;
+static thread_func medium_thread;
+
+void
+test_rwlock_donate (void)
+{
+  struct rwlock rw;
+
+  /* This test relies on priority donation. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rw);
+  rwlock_acquire_read (&rw);
+
+  thread_create ("writer", PRI_DEFAULT + 2, writer_thread, &rw);
+  msg ("Main should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 2, thread_get_priority ());
+
+  thread_create ("reader", PRI_DEFAULT + 4, reader_thread, &rw);
+  msg ("Main should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 4, thread_get_priority ());
+
+  thread_create ("medium", PRI_DEFAULT + 1, medium_thread, NULL);
+  msg ("Main releases its read hold.");
+  rwlock_release_read (&rw);
+
+  msg ("Main should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+writer_thread (void *rw_)
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_write (rw);
+  msg ("Writer has the lock.");
+  rwlock_release_write (rw);
+  msg ("Writer is done.");
+}
+
+static void
+reader_thread (void *rw_)
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_read (rw);
+  msg ("Reader has the lock.");
+  rwlock_release_read (rw);
+  msg ("Reader is done.");
+}
+
+static void
+medium_thread (void *aux UNUSED)
+{
+  msg ("Medium thread ran.");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-donate) begin
+(rwlock-donate) Main should have priority 33.  Actual priority: 33.
+(rwlock-donate) Main should have priority 35.  Actual priority: 35.
+(rwlock-donate) Main releases its read hold.
+(rwlock-donate) Writer has the lock.
+(rwlock-donate) Reader has the lock.
+(rwlock-donate) Reader is done.
+(rwlock-donate) Writer is done.
+(rwlock-donate) Medium thread ran.
+(rwlock-donate) Main should have priority 31.  Actual priority: 31.
+(rwlock-donate) end
+EOF
+pass;
@@ -0,0 +1,249 @@
+/* Two "files" are each guarded by their own readers-writer lock,
+   the way every inode is.
+
+   A writer takes file A and then blocks, as if waiting on the
+   disk.  The main thread must still be able to read file B
+   meanwhile.  Two readers then queue on file A behind the writer.
+   Once the writer finishes, both readers must be inside file A at
+   the same time, which the second one checks by seeing two
+   active readers.
+
+   With a file system, the same is then checked through
+   file_read_at() and file_write_at() on two real files, whose
+   inodes each carry such a lock.  The main thread only runs
+   while a higher-priority reader or writer waits on the disk,
+   that is, while it is inside a file.  A reader that then reads
+   the same file must finish first, since readers share the
+   file; a reader of the other file must finish first too, even
+   while a writer holds this one; and a reader of the end of the
+   file being written must wait for the whole write, or it would
+   see the old bytes there. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#ifdef FILESYS
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#endif
+
+struct files
+  {
+    struct rwlock a;            /* Lock for file A. */
+    struct rwlock b;            /* Lock for file B. */
+    struct semaphore disk;      /* Writer's pretend disk request. */
+    struct semaphore hold;      /* Keeps readers inside file A. */
+  };
+
+static thread_func writer_thread;
+static thread_func reader_thread;
+#ifdef FILESYS
+static void test_file_readers (void);
+#endif
+
+void
+test_rwlock_readers (void)
+{
+  struct files f;
+
+  /* This test relies on priority scheduling. */
+  ASSERT (!thread_mlfqs);
+
+  rwlock_init (&f.a);
+  rwlock_init (&f.b);
+  sema_init (&f.disk, 0);
+  sema_init (&f.hold, 0);
+
+  thread_create ("writer", PRI_DEFAULT + 1, writer_thread, &f);
+
+  rwlock_acquire_read (&f.b);
+  msg ("Main reads file B while file A is being written.");
+  rwlock_release_read (&f.b);
+
+  thread_create ("reader 1", PRI_DEFAULT + 1, reader_thread, &f);
+  thread_create ("reader 2", PRI_DEFAULT + 1, reader_thread, &f);
+
+  msg ("Main completes the writer's disk request.");
+  sema_up (&f.disk);
+
+  msg ("Main lets the readers finish.");
+  sema_up (&f.hold);
+  sema_up (&f.hold);
+  msg ("File A has %d reader(s) left.", f.a.readers);
+
+#ifdef FILESYS
+  test_file_readers ();
+#endif
+}
+
+static void
+writer_thread (void *f_)
+{
+  struct files *f = f_;
+
+  rwlock_acquire_write (&f->a);
+  msg ("Writer holds file A and waits on the disk.");
+  sema_down (&f->disk);
+  msg ("Writer is done with file A.");
+  rwlock_release_write (&f->a);
+}
+
+static void
+reader_thread (void *f_)
+{
+  struct files *f = f_;
+
+  rwlock_acquire_read (&f->a);
+  msg ("Thread %s reads file A with %d reader(s).",
+       thread_name (), f->a.readers);
+  sema_down (&f->hold);
+  rwlock_release_read (&f->a);
+  msg ("Thread %s is done with file A.", thread_name ());
+}
+
+#ifdef FILESYS
+/* Size of file A: long enough that its reader or writer waits
+   on the disk many times. */
+#define LONG_SIZE (64 * 512)
+
+/* A read or write of a real file by its own thread. */
+struct file_op
+  {
+    struct file *file;          /* File to read or write. */
+    off_t ofs, size;            /* Bytes to read or write. */
+    char fill;                  /* Byte expected or written. */
+    const bool *other_done;     /* The other operation's DONE. */
+    bool other_was_done;        /* OTHER_DONE when this one ended. */
+    bool ok;                    /* All bytes read were FILL, or
+                                   all were written. */
+    bool done;                  /* This operation has ended. */
+    struct semaphore *finished; /* Up'd at the end. */
+  };
+
+static thread_func read_op_thread;
+static thread_func write_op_thread;
+
+/* Creates file NAME of SIZE bytes, all FILL, and opens it. */
+static struct file *
+make_file (const char *name, off_t size, char fill)
+{
+  struct file *file;
+  char *buf;
+
+  if (!filesys_create (name, size))
+    fail ("create \"%s\"", name);
+  file = filesys_open (name);
+  if (file == NULL)
+    fail ("open \"%s\"", name);
+  buf = malloc (size);
+  ASSERT (buf != NULL);
+  memset (buf, fill, size);
+  if (file_write_at (file, buf, size, 0) != size)
+    fail ("write \"%s\"", name);
+  free (buf);
+  return file;
+}
+
+/* Runs OP in a new thread of priority PRIORITY. */
+static void
+start_op (struct file_op *op, const char *name, int priority,
+          thread_func *func, struct file *file, off_t ofs, off_t size,
+          char fill, const bool *other_done, struct semaphore *finished)
+{
+  op->file = file;
+  op->ofs = ofs;
+  op->size = size;
+  op->fill = fill;
+  op->other_done = other_done;
+  op->other_was_done = false;
+  op->ok = false;
+  op->done = false;
+  op->finished = finished;
+  thread_create (name, priority, func, op);
+}
+
+static void
+test_file_readers (void)
+{
+  struct file *a, *b;
+  struct file_op long_op, short_op, b_op;
+  struct semaphore finished;
+
+  sema_init (&finished, 0);
+  a = make_file ("a", LONG_SIZE, 'a');
+  b = make_file ("b", 512, 'b');
+
+  /* Two readers of file A. */
+  start_op (&long_op, "long reader", PRI_DEFAULT + 1, read_op_thread,
+            a, 0, LONG_SIZE, 'a', NULL, &finished);
+  start_op (&short_op, "short reader", PRI_DEFAULT + 2, read_op_thread,
+            a, LONG_SIZE - 512, 512, 'a', &long_op.done, &finished);
+  sema_down (&finished);
+  sema_down (&finished);
+  if (!long_op.ok || !short_op.ok)
+    fail ("file A read back wrong");
+  msg ("Short reader of file A %s the long one.",
+       short_op.other_was_done ? "waited for" : "ran alongside");
+
+  /* A writer of file A, a reader of file B, a reader of file A. */
+  start_op (&long_op, "writer", PRI_DEFAULT + 1, write_op_thread,
+            a, 0, LONG_SIZE, 'A', NULL, &finished);
+  start_op (&b_op, "reader of B", PRI_DEFAULT + 2, read_op_thread,
+            b, 0, 512, 'b', &long_op.done, &finished);
+  start_op (&short_op, "reader of A", PRI_DEFAULT + 2, read_op_thread,
+            a, LONG_SIZE - 512, 512, 'A', NULL, &finished);
+  sema_down (&finished);
+  sema_down (&finished);
+  sema_down (&finished);
+  if (!long_op.ok || !b_op.ok)
+    fail ("file A written or file B read back wrong");
+  msg ("Reader of file B %s the writer of file A.",
+       b_op.other_was_done ? "waited for" : "ran alongside");
+  msg ("Reader of file A %s.",
+       short_op.ok ? "saw the whole write" : "saw a partial write");
+
+  file_close (a);
+  file_close (b);
+  filesys_remove ("a");
+  filesys_remove ("b");
+}
+
+static void
+read_op_thread (void *op_)
+{
+  struct file_op *op = op_;
+  char *buf = malloc (op->size);
+  off_t i;
+
+  ASSERT (buf != NULL);
+  if (file_read_at (op->file, buf, op->size, op->ofs) == op->size)
+    {
+      op->ok = true;
+      for (i = 0; i < op->size; i++)
+        if (buf[i] != op->fill)
+          op->ok = false;
+    }
+  op->other_was_done = op->other_done != NULL && *op->other_done;
+  op->done = true;
+  free (buf);
+  sema_up (op->finished);
+}
+
+static void
+write_op_thread (void *op_)
+{
+  struct file_op *op = op_;
+  char *buf = malloc (op->size);
+
+  ASSERT (buf != NULL);
+  memset (buf, op->fill, op->size);
+  op->ok = file_write_at (op->file, buf, op->size, op->ofs) == op->size;
+  op->done = true;
+  free (buf);
+  sema_up (op->finished);
+}
+#endif /* FILESYS */
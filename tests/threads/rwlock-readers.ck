@@ -0,0 +1,37 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+# The second output is from kernels with a file system, which also
+# check real files.
+check_expected ([<<'EOF', <<'EOF']);
+(rwlock-readers) begin
+(rwlock-readers) Writer holds file A and waits on the disk.
+(rwlock-readers) Main reads file B while file A is being written.
+(rwlock-readers) Main completes the writer's disk request.
+(rwlock-readers) Writer is done with file A.
+(rwlock-readers) Thread reader 1 reads file A with 1 reader(s).
+(rwlock-readers) Thread reader 2 reads file A with 2 reader(s).
+(rwlock-readers) Main lets the readers finish.
+(rwlock-readers) Thread reader 1 is done with file A.
+(rwlock-readers) Thread reader 2 is done with file A.
+(rwlock-readers) File A has 0 reader(s) left.
+(rwlock-readers) end
+EOF
+(rwlock-readers) begin
+(rwlock-readers) Writer holds file A and waits on the disk.
+(rwlock-readers) Main reads file B while file A is being written.
+(rwlock-readers) Main completes the writer's disk request.
+(rwlock-readers) Writer is done with file A.
+(rwlock-readers) Thread reader 1 reads file A with 1 reader(s).
+(rwlock-readers) Thread reader 2 reads file A with 2 reader(s).
+(rwlock-readers) Main lets the readers finish.
+(rwlock-readers) Thread reader 1 is done with file A.
+(rwlock-readers) Thread reader 2 is done with file A.
+(rwlock-readers) File A has 0 reader(s) left.
+(rwlock-readers) Short reader of file A ran alongside the long one.
+(rwlock-readers) Reader of file B ran alongside the writer of file A.
+(rwlock-readers) Reader of file A saw the whole write.
+(rwlock-readers) end
+EOF
+pass;
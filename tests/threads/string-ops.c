@@ -0,0 +1,234 @@
+/* Checks memcpy(), memmove(), memset(), memcmp() and strlen()
+   against byte-at-a-time loops for every size up to 300 bytes
+   and every alignment within a word, then prints the bytes per
+   cycle that memcpy() and memset() reach across sizes and
+   alignments, next to a byte loop, and that copy_page() and
+   memzero_page() reach.  Each benchmark must leave the bytes its
+   last call should have produced. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+#define CHECK_MAX 300
+#define BENCH_MAX 16384
+#define BUF_PAGES (BENCH_MAX / PGSIZE + 1)
+
+/* Bytes each benchmark moves in total. */
+#define BENCH_BYTES (1 << 20)
+
+static uint8_t *src_buf, *dst_buf, *ref_buf;
+
+static void check (void);
+static void bench (const char *name, size_t size, size_t ofs);
+static void check_bench (const char *name, size_t size, size_t ofs,
+                         uint8_t fill);
+static void print_rate (const char *name, size_t size, size_t ofs,
+                        uint64_t fast, uint64_t slow);
+
+void
+test_string_ops (void)
+{
+  static const size_t sizes[] = {8, 64, 256, 1024, 4096, BENCH_MAX};
+  size_t i;
+
+  src_buf = palloc_get_multiple (PAL_ASSERT, BUF_PAGES);
+  dst_buf = palloc_get_multiple (PAL_ASSERT, BUF_PAGES);
+  ref_buf = palloc_get_multiple (PAL_ASSERT, BUF_PAGES);
+
+  check ();
+  msg ("Results match byte loops.");
+
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    {
+      bench ("memcpy", sizes[i], 0);
+      bench ("memcpy", sizes[i], 3);
+      bench ("memset", sizes[i], 0);
+      bench ("memset", sizes[i], 3);
+    }
+  bench ("copy_page", PGSIZE, 0);
+  bench ("memzero_page", PGSIZE, 0);
+  msg ("Benchmarked calls leave the right bytes.");
+
+  palloc_free_multiple (src_buf, BUF_PAGES);
+  palloc_free_multiple (dst_buf, BUF_PAGES);
+  palloc_free_multiple (ref_buf, BUF_PAGES);
+}
+
+/* Fills SRC_BUF, DST_BUF and REF_BUF with a pattern that differs
+   between them and from run to run. */
+static void
+scramble (unsigned seed)
+{
+  size_t i;
+
+  for (i = 0; i < CHECK_MAX * 2; i++)
+    {
+      src_buf[i] = seed + i * 7;
+      dst_buf[i] = ref_buf[i] = seed * 3 + i * 13;
+    }
+}
+
+/* Fails unless DST_BUF and REF_BUF are equal. */
+static void
+compare (const char *name, size_t size, size_t ofs)
+{
+  size_t i;
+
+  for (i = 0; i < CHECK_MAX * 2; i++)
+    if (dst_buf[i] != ref_buf[i])
+      fail ("%s of %zu bytes at offset %zu wrong at byte %zu",
+            name, size, ofs, i);
+}
+
+static void
+check (void)
+{
+  size_t size, ofs, i;
+
+  for (size = 0; size <= CHECK_MAX; size++)
+    for (ofs = 0; ofs < 8; ofs++)
+      {
+        size_t back = ofs + 5;
+
+        /* memcpy(). */
+        scramble (size + ofs);
+        for (i = 0; i < size; i++)
+          ref_buf[ofs + i] = src_buf[(ofs * 3) % 8 + i];
+        if (memcpy (dst_buf + ofs, src_buf + (ofs * 3) % 8, size)
+            != dst_buf + ofs)
+          fail ("memcpy returned the wrong pointer");
+        compare ("memcpy", size, ofs);
+
+        /* memset(). */
+        scramble (size + ofs);
+        for (i = 0; i < size; i++)
+          ref_buf[ofs + i] = 0xa5;
+        memset (dst_buf + ofs, 0xa5, size);
+        compare ("memset", size, ofs);
+
+        /* memmove() up and down within one buffer. */
+        scramble (size + ofs);
+        for (i = size; i-- > 0; )
+          ref_buf[back + i] = ref_buf[ofs + i];
+        if (memmove (dst_buf + back, dst_buf + ofs, size) != dst_buf + back)
+          fail ("memmove returned the wrong pointer");
+        compare ("memmove up", size, ofs);
+        scramble (size + ofs);
+        for (i = 0; i < size; i++)
+          ref_buf[ofs + i] = ref_buf[back + i];
+        memmove (dst_buf + ofs, dst_buf + back, size);
+        compare ("memmove down", size, ofs);
+
+        /* memcmp(), equal and with one byte changed. */
+        scramble (size + ofs);
+        memcpy (dst_buf + ofs, src_buf, size);
+        if (memcmp (dst_buf + ofs, src_buf, size) != 0)
+          fail ("memcmp of %zu equal bytes is not 0", size);
+        if (size > 0)
+          {
+            size_t at = (size * 5 + ofs) % size;
+
+            dst_buf[ofs + at] = src_buf[at] + 1;
+            if (memcmp (dst_buf + ofs, src_buf, size)
+                != (dst_buf[ofs + at] > src_buf[at] ? 1 : -1))
+              fail ("memcmp of %zu bytes misses byte %zu", size, at);
+          }
+
+        /* strlen(). */
+        for (i = 0; i < size; i++)
+          dst_buf[ofs + i] = 'a' + i % 26;
+        dst_buf[ofs + size] = '\0';
+        if (strlen ((char *) dst_buf + ofs) != size)
+          fail ("strlen of %zu bytes at offset %zu is %zu", size, ofs,
+                strlen ((char *) dst_buf + ofs));
+      }
+}
+
+/* Times NAME on SIZE bytes at offset OFS into the destination,
+   and for memcpy() and memset() a byte loop doing the same, and
+   prints the rates. */
+static void
+bench (const char *name, size_t size, size_t ofs)
+{
+  bool copy = !strcmp (name, "memcpy");
+  bool fill = !strcmp (name, "memset");
+  size_t reps = BENCH_BYTES / size;
+  uint64_t start, fast, slow = 0;
+  size_t r, i;
+
+  start = rdtsc ();
+  if (copy)
+    for (r = 0; r < reps; r++)
+      memcpy (dst_buf + ofs, src_buf, size);
+  else if (fill)
+    for (r = 0; r < reps; r++)
+      memset (dst_buf + ofs, r, size);
+  else if (!strcmp (name, "copy_page"))
+    for (r = 0; r < reps; r++)
+      copy_page (dst_buf, src_buf);
+  else
+    for (r = 0; r < reps; r++)
+      memzero_page (dst_buf);
+  fast = rdtsc () - start;
+  check_bench (name, size, ofs, reps - 1);
+
+  start = rdtsc ();
+  if (copy)
+    for (r = 0; r < reps; r++)
+      for (i = 0; i < size; i++)
+        dst_buf[ofs + i] = src_buf[i];
+  else if (fill)
+    for (r = 0; r < reps; r++)
+      for (i = 0; i < size; i++)
+        dst_buf[ofs + i] = r;
+  if (copy || fill)
+    slow = rdtsc () - start;
+
+  print_rate (name, size, ofs, fast * 100 / reps, slow * 100 / reps);
+}
+
+/* Fails unless DST_BUF holds what the last call that bench()
+   timed for NAME should have left: a copy of SRC_BUF at OFS for
+   memcpy() and copy_page(), SIZE bytes of FILL at OFS for
+   memset(), or zeros for memzero_page(). */
+static void
+check_bench (const char *name, size_t size, size_t ofs, uint8_t fill)
+{
+  bool copy = !strcmp (name, "memcpy") || !strcmp (name, "copy_page");
+  size_t i;
+
+  if (!strcmp (name, "memzero_page"))
+    fill = 0;
+  for (i = 0; i < size; i++)
+    if (dst_buf[ofs + i] != (copy ? src_buf[i] : fill))
+      fail ("benchmarked %s of %zu bytes at offset %zu wrong at byte %zu",
+            name, size, ofs, i);
+}
+
+/* Prints SIZE bytes per FAST / 100 cycles, and per SLOW / 100
+   cycles for the byte loop if SLOW is nonzero, with two decimal
+   places. */
+static void
+print_rate (const char *name, size_t size, size_t ofs, uint64_t fast,
+            uint64_t slow)
+{
+  uint64_t rate = size * 10000 / (fast > 0 ? fast : 1);
+
+  if (slow > 0)
+    {
+      uint64_t byte_rate = size * 10000 / slow;
+
+      msg ("%s %zu bytes, offset %zu: %llu.%02llu bytes/cycle "
+           "(byte loop %llu.%02llu)", name, size, ofs,
+           rate / 100, rate % 100, byte_rate / 100, byte_rate % 100);
+    }
+  else
+    msg ("%s %zu bytes: %llu.%02llu bytes/cycle",
+         name, size, rate / 100, rate % 100);
+}
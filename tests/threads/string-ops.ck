@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_lines_and_rates
+  (["(string-ops) Results match byte loops.",
+    "(string-ops) Benchmarked calls leave the right bytes."],
+   [(map (qr/^\(string-ops\) $_ \d+ bytes, offset \d+: [\d.]+ bytes\/cycle \(byte loop [\d.]+\)$/,
+	  "memcpy", "memset")),
+    (map (qr/^\(string-ops\) $_ 4096 bytes: [\d.]+ bytes\/cycle$/,
+	  "copy_page", "memzero_page"))]);
+pass;
@@ -0,0 +1,73 @@
+/* Measures thread switch throughput.  Two threads of equal
+   priority bounce a pair of semaphores back and forth for one
+   second, so every round trip costs exactly two switches.  The pong
+   thread must have answered every ping.
+
+   Run once normally and once with "-iret-switch" on the kernel
+   command line to compare switch_threads() against the full
+   intr_frame path. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static thread_func pong_thread;
+static struct semaphore ping, pong;
+static volatile bool done;
+static long long pongs;
+
+void
+test_switch_pingpong (void) 
+{
+  int64_t start, elapsed;
+  long long rounds = 0;
+
+  sema_init (&ping, 0);
+  sema_init (&pong, 0);
+  done = false;
+  pongs = 0;
+  thread_create ("pong", thread_get_priority (), pong_thread, NULL);
+
+  /* Start on a tick boundary. */
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    continue;
+
+  start = timer_ticks ();
+  do
+    {
+      sema_up (&ping);
+      sema_down (&pong);
+      rounds++;
+      elapsed = timer_elapsed (start);
+    }
+  while (elapsed < TIMER_FREQ);
+
+  done = true;
+  sema_up (&ping);
+  sema_down (&pong);
+
+  if (pongs != rounds + 1)
+    fail ("%lld pings but %lld pongs", rounds + 1, pongs);
+  msg ("Pong answered every ping.");
+
+  msg ("%s: %lld switches per second.",
+       thread_iret_switch ? "iret" : "switch_threads",
+       rounds * 2 * TIMER_FREQ / elapsed);
+}
+
+static void
+pong_thread (void *aux UNUSED) 
+{
+  for (;;)
+    {
+      sema_down (&ping);
+      pongs++;
+      sema_up (&pong);
+      if (done)
+        break;
+    }
+}
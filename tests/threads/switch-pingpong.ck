@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_lines_and_rates
+  (["(switch-pingpong) Pong answered every ping."],
+   [qr/^\(switch-pingpong\) \S+: \d+ switches per second\.$/]);
+pass;
@@ -29,6 +29,18 @@ static const struct test tests[] =
         {"priority-preempt", test_priority_preempt},
         {"priority-sema", test_priority_sema},
         {"priority-condvar", test_priority_condvar},
+        {"switch-pingpong", test_switch_pingpong},
+        {"fpu-switch", test_fpu_switch},
+        {"rwlock-readers", test_rwlock_readers},
+        {"rwlock-donate", test_rwlock_donate},
+        {"workqueue-batch", test_workqueue_batch},
+        {"cfs-fair", test_cfs_fair},
+        {"deadline-edf", test_deadline_edf},
+        {"lock-ceiling", test_lock_ceiling},
+        {"kmem-cache", test_kmem_cache},
+        {"palloc-buddy", test_palloc_buddy},
+        {"string-ops", test_string_ops},
+        {"hash-lookup", test_hash_lookup},
         {"mlfqs-load-1", test_mlfqs_load_1},
         {"mlfqs-load-60", test_mlfqs_load_60},
         {"mlfqs-load-avg", test_mlfqs_load_avg},
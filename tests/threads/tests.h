@@ -23,6 +23,18 @@ extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_switch_pingpong;
+extern test_func test_fpu_switch;
+extern test_func test_rwlock_readers;
+extern test_func test_rwlock_donate;
+extern test_func test_workqueue_batch;
+extern test_func test_cfs_fair;
+extern test_func test_deadline_edf;
+extern test_func test_lock_ceiling;
+extern test_func test_kmem_cache;
+extern test_func test_palloc_buddy;
+extern test_func test_string_ops;
+extern test_func test_hash_lookup;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -0,0 +1,66 @@
+/* Exercises the deferred-work queues.
+
+   Six items go on a queue whose single worker runs below the
+   main thread, four items per batch, so none of them runs until
+   the main thread flushes the queue.  Queueing an item that is
+   still pending must do nothing.  The items must then run in
+   order, in two batches.
+
+   An item queued on a queue that outranks the main thread must
+   run before work_queue() returns, and a cancelled item must not
+   run at all. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+
+#define ITEM_CNT 6
+
+/* Static, not on the stack: the workers outlive the test. */
+static struct workqueue low_wq, high_wq;
+static struct work items[ITEM_CNT + 2];
+
+static work_func print_item;
+
+void
+test_workqueue_batch (void)
+{
+  int i;
+
+  /* This test relies on priority scheduling. */
+  ASSERT (!thread_mlfqs);
+
+  workqueue_init (&low_wq, "low", PRI_DEFAULT - 1, 4);
+  workqueue_start (&low_wq, 1);
+  workqueue_init (&high_wq, "high", PRI_DEFAULT + 1, 4);
+  workqueue_start (&high_wq, 1);
+
+  for (i = 0; i < ITEM_CNT + 2; i++)
+    work_init (&items[i], print_item, (void *) (intptr_t) i);
+
+  for (i = 0; i < ITEM_CNT; i++)
+    work_queue (&low_wq, &items[i]);
+  if (!work_queue (&low_wq, &items[0]))
+    msg ("Item 0 is already pending.");
+
+  msg ("Main flushes the low-priority queue.");
+  workqueue_flush (&low_wq);
+  msg ("Low-priority queue ran %lld items in %lld batches.",
+       low_wq.queued, low_wq.batches);
+
+  work_queue (&high_wq, &items[ITEM_CNT]);
+  msg ("Main continues.");
+
+  work_queue (&low_wq, &items[ITEM_CNT + 1]);
+  if (work_cancel (&items[ITEM_CNT + 1]))
+    msg ("Item %d is cancelled.", ITEM_CNT + 1);
+  workqueue_flush (&low_wq);
+}
+
+static void
+print_item (void *aux)
+{
+  msg ("Thread %s runs item %d.", thread_name (), (int) (intptr_t) aux);
+}
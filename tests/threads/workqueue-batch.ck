@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue-batch) begin
+(workqueue-batch) Item 0 is already pending.
+(workqueue-batch) Main flushes the low-priority queue.
+(workqueue-batch) Thread low runs item 0.
+(workqueue-batch) Thread low runs item 1.
+(workqueue-batch) Thread low runs item 2.
+(workqueue-batch) Thread low runs item 3.
+(workqueue-batch) Thread low runs item 4.
+(workqueue-batch) Thread low runs item 5.
+(workqueue-batch) Low-priority queue ran 6 items in 2 batches.
+(workqueue-batch) Thread high runs item 6.
+(workqueue-batch) Main continues.
+(workqueue-batch) Item 7 is cancelled.
+(workqueue-batch) end
+EOF
+pass;
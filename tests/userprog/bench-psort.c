@@ -0,0 +1,144 @@
+/* Sorts the same random array twice, once in the main thread and
+   once split across THREAD_CNT threads that each sort one chunk
+   in place before the main thread merges the chunks, and prints
+   the TSC cycles each took.
+
+   This is a benchmark, not a test: the numbers depend on the
+   machine, and with one CPU the threaded sort can only show the
+   cost of creating, scheduling and joining threads. */
+
+#include <random.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include <uthread.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+#define ELEM_CNT (16 * 1024)
+#define CHUNK_CNT (ELEM_CNT / THREAD_CNT)
+
+static int input[ELEM_CNT];
+static int work[ELEM_CNT];
+static int output[ELEM_CNT];
+
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* Restores the heap property below index I of the CNT-element
+   heap A. */
+static void
+sift_down (int *a, size_t i, size_t cnt)
+{
+  for (;;)
+    {
+      size_t max = i, l = 2 * i + 1, r = l + 1;
+      int t;
+
+      if (l < cnt && a[l] > a[max])
+        max = l;
+      if (r < cnt && a[r] > a[max])
+        max = r;
+      if (max == i)
+        return;
+      t = a[i];
+      a[i] = a[max];
+      a[max] = t;
+      i = max;
+    }
+}
+
+/* Sorts the CNT ints in A into ascending order. */
+static void
+heap_sort (int *a, size_t cnt)
+{
+  size_t i;
+
+  for (i = cnt / 2; i-- > 0; )
+    sift_down (a, i, cnt);
+  for (i = cnt; i-- > 1; )
+    {
+      int t = a[0];
+      a[0] = a[i];
+      a[i] = t;
+      sift_down (a, 0, i);
+    }
+}
+
+static void
+sort_chunk (void *chunk)
+{
+  heap_sort (chunk, CHUNK_CNT);
+}
+
+/* Merges the THREAD_CNT sorted chunks of WORK into OUTPUT. */
+static void
+merge (void)
+{
+  size_t idx[THREAD_CNT] = { 0 };
+  size_t i;
+
+  for (i = 0; i < ELEM_CNT; i++)
+    {
+      int min = -1, c;
+
+      for (c = 0; c < THREAD_CNT; c++)
+        if (idx[c] < CHUNK_CNT
+            && (min < 0
+                || work[c * CHUNK_CNT + idx[c]]
+                   < work[min * CHUNK_CNT + idx[min]]))
+          min = c;
+      output[i] = work[min * CHUNK_CNT + idx[min]++];
+    }
+}
+
+static void
+verify (const int *a, const char *what)
+{
+  size_t i;
+
+  for (i = 1; i < ELEM_CNT; i++)
+    if (a[i - 1] > a[i])
+      fail ("%s: out of order at %zu", what, i);
+}
+
+void
+test_main (void)
+{
+  tid_t tids[THREAD_CNT];
+  uint64_t start, serial, threaded;
+  size_t i;
+
+  random_init (0);
+  for (i = 0; i < ELEM_CNT; i++)
+    input[i] = random_ulong () & 0x7fffffff;
+
+  memcpy (work, input, sizeof work);
+  start = rdtsc ();
+  heap_sort (work, ELEM_CNT);
+  serial = rdtsc () - start;
+  verify (work, "serial sort");
+
+  memcpy (work, input, sizeof work);
+  start = rdtsc ();
+  for (i = 0; i < THREAD_CNT; i++)
+    if ((tids[i] = uthread_create (sort_chunk, work + i * CHUNK_CNT))
+        == TID_ERROR)
+      fail ("cannot create thread %zu", i);
+  for (i = 0; i < THREAD_CNT; i++)
+    uthread_join (tids[i]);
+  merge ();
+  threaded = rdtsc () - start;
+  verify (output, "threaded sort");
+
+  msg ("sorted %d ints", ELEM_CNT);
+  msg ("1 thread: %llu cycles", (unsigned long long) serial);
+  msg ("%d threads: %llu cycles", THREAD_CNT, (unsigned long long) threaded);
+}
@@ -0,0 +1,65 @@
+/* Forks a child, which must start with its parent's SSE and x87
+   registers.  The child then loads values of its own and exits,
+   and the parent's registers must have survived the switches to
+   the child and back.
+
+   Programs are compiled with -mno-sse, so the registers are only
+   reached through asm. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PARENT_XMM0 0x1122334455667788ULL
+#define PARENT_ST0 -1000003LL
+#define CHILD_XMM0 0x8877665544332211ULL
+#define CHILD_ST0 2000003LL
+
+/* Loads XMM0 into %xmm0 and ST0 onto a fresh x87 stack. */
+static void
+load_regs (uint64_t xmm0, int64_t st0)
+{
+  asm volatile ("movq %0, %%xmm0" : : "r" (xmm0));
+  asm volatile ("fninit; fildq %0" : : "m" (st0));
+}
+
+/* Returns true if %xmm0 and the top of the x87 stack hold XMM0
+   and ST0. */
+static bool
+regs_are (uint64_t xmm0, int64_t st0)
+{
+  uint64_t got_xmm0;
+  int64_t got_st0;
+
+  asm volatile ("movq %%xmm0, %0" : "=r" (got_xmm0));
+  asm volatile ("fld %%st(0); fistpq %0" : "=m" (got_st0));
+  return got_xmm0 == xmm0 && got_st0 == st0;
+}
+
+void
+test_main (void)
+{
+  int pid;
+
+  load_regs (PARENT_XMM0, PARENT_ST0);
+  if ((pid = fork ("child")))
+    {
+      int status = wait (pid);
+      msg ("Parent: child exit status is %d", status);
+      if (!regs_are (PARENT_XMM0, PARENT_ST0))
+        fail ("parent's FPU registers changed");
+      msg ("Parent kept its FPU registers.");
+    }
+  else
+    {
+      if (!regs_are (PARENT_XMM0, PARENT_ST0))
+        fail ("child did not start with its parent's FPU registers");
+      msg ("Child started with its parent's FPU registers.");
+      load_regs (CHILD_XMM0, CHILD_ST0);
+      msg ("Child loaded its own.");
+      if (!regs_are (CHILD_XMM0, CHILD_ST0))
+        fail ("child's FPU registers changed");
+      exit (81);
+    }
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fork-fpu) begin
+(fork-fpu) Child started with its parent's FPU registers.
+(fork-fpu) Child loaded its own.
+child: exit(81)
+(fork-fpu) Parent: child exit status is 81
+(fork-fpu) Parent kept its FPU registers.
+(fork-fpu) end
+fork-fpu: exit(0)
+EOF
+pass;
@@ -0,0 +1,61 @@
+/* Starts several threads that each increment a shared counter
+   many times under a umutex, joins them all, and checks that no
+   increment was lost and that every thread's exit status came
+   back through uthread_join(). */
+
+#include <syscall.h>
+#include <uthread.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+#define ITERATIONS 20000
+
+static struct umutex counter_lock = UMUTEX_INITIALIZER;
+static volatile int counter;
+static int ids[THREAD_CNT];
+
+static void
+increment (void *idx_)
+{
+  int idx = (int) (long) idx_;
+  int i;
+
+  ids[idx] = uthread_id ();
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      umutex_lock (&counter_lock);
+      counter++;
+      umutex_unlock (&counter_lock);
+    }
+  uthread_exit (idx + 10);
+}
+
+void
+test_main (void)
+{
+  tid_t tids[THREAD_CNT];
+  int i;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK ((tids[i] = uthread_create (increment, (void *) (long) i))
+           != TID_ERROR, "create thread %d", i);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      int status = uthread_join (tids[i]);
+      if (status != i + 10)
+        fail ("thread %d exited with %d, expected %d", i, status, i + 10);
+    }
+  msg ("joined %d threads", THREAD_CNT);
+
+  CHECK (uthread_join (tids[0]) == -1, "join thread 0 again");
+  CHECK (uthread_id () == 0, "main thread id is 0");
+  for (i = 0; i < THREAD_CNT; i++)
+    if (ids[i] < 1 || ids[i] > UTHREAD_MAX)
+      fail ("thread %d saw id %d", i, ids[i]);
+
+  if (counter != THREAD_CNT * ITERATIONS)
+    fail ("counter is %d, expected %d", counter, THREAD_CNT * ITERATIONS);
+  msg ("counter is %d", counter);
+}
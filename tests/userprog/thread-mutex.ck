@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-mutex) begin
+(thread-mutex) create thread 0
+(thread-mutex) create thread 1
+(thread-mutex) create thread 2
+(thread-mutex) create thread 3
+(thread-mutex) joined 4 threads
+(thread-mutex) join thread 0 again
+(thread-mutex) main thread id is 0
+(thread-mutex) counter is 80000
+(thread-mutex) end
+thread-mutex: exit(0)
+EOF
+pass;
@@ -0,0 +1,136 @@
+#include "threads/cpu.h"
+
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "devices/timer.h"
+#include "intrinsic.h"
+#include "threads/fpu.h"
+#include "threads/interrupt.h"
+#include "threads/lapic.h"
+#include "threads/loader.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Per-CPU state, indexed by cpu->id.  cpus[0] is the bootstrap
+   processor that runs main(). */
+struct cpu cpus[CPU_MAX];
+
+/* Number of CPUs to bring up. */
+int cpu_cnt = 1;
+
+/* Top of the stack for the application processor being started.
+   Read by ap_entry_64 in start.S. */
+uint64_t ap_boot_stack;
+
+/* The application processor being started. */
+static struct cpu *ap_boot_cpu;
+
+void ap_main (void) NO_RETURN;
+
+/* Returns the CPU that is running this code.  The caller must keep
+   interrupts off if it needs the answer to stay true. */
+struct cpu *
+this_cpu (void) {
+	return ((struct thread *) pg_round_down (rrsp ()))->cpu;
+}
+
+/* Initializes cpus[].  Called by thread_init() before any thread
+   exists, so only the bootstrap processor is online. */
+void
+cpu_init (void) {
+	int i;
+
+	if (cpu_cnt < 1)
+		cpu_cnt = 1;
+	if (cpu_cnt > CPU_MAX)
+		cpu_cnt = CPU_MAX;
+
+	for (i = 0; i < CPU_MAX; i++) {
+		cpus[i].id = i;
+		cpus[i].lapic_id = i;
+	}
+	cpus[0].online = true;
+}
+
+/* Starts the application processors one at a time with the
+   INIT-SIPI-SIPI sequence from [IA32-v3a] 8.4.4.1.  APIC IDs are
+   assumed to be numbered 0...cpu_cnt-1, as QEMU does; we do not
+   parse the ACPI MADT.
+
+   Requires a calibrated timer and interrupts on. */
+void
+cpu_start_aps (void) {
+	extern char ap_trampoline[], ap_trampoline_end[];
+	int i;
+
+	if (cpu_cnt == 1)
+		return;
+	if (!lapic_init ()) {
+		printf ("cpu: no local APIC, using 1 CPU\n");
+		cpu_cnt = 1;
+		return;
+	}
+	cpus[0].lapic_id = lapic_id ();
+
+	/* APs start in real mode, so the trampoline must live below
+	   1 MB. */
+	memcpy (ptov (LOADER_AP_TRAMPOLINE), ap_trampoline,
+			ap_trampoline_end - ap_trampoline);
+
+	for (i = 1; i < cpu_cnt; i++) {
+		struct cpu *c = &cpus[i];
+		uint8_t *stack = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+		int64_t start;
+		int sipi;
+
+		if (c->lapic_id == cpus[0].lapic_id)
+			c->lapic_id = 0;
+		ap_boot_cpu = c;
+		ap_boot_stack = (uint64_t) stack + PGSIZE;
+
+		lapic_send_init (c->lapic_id);
+		timer_msleep (10);
+		for (sipi = 0; sipi < 2 && !c->online; sipi++) {
+			lapic_send_sipi (c->lapic_id, LOADER_AP_TRAMPOLINE);
+			timer_usleep (200);
+		}
+
+		start = timer_ticks ();
+		while (!c->online && timer_elapsed (start) < TIMER_FREQ)
+			barrier ();
+		if (!c->online) {
+			/* The stack stays allocated: the CPU may still wake up. */
+			printf ("cpu%d: did not start\n", i);
+			cpu_cnt = i;
+			break;
+		}
+	}
+	printf ("%d CPUs online.\n", cpu_cnt);
+}
+
+/* Entered from ap_entry_64 in start.S on the boot stack, with the
+   boot page tables loaded and interrupts off.
+
+   The kernel still relies on intr_disable() for mutual exclusion
+   in many places (interrupt bookkeeping, the syscall entry scratch
+   area, the TSS, the allocator lists), so an AP does not schedule
+   threads: it comes online and parks.  Only the bootstrap
+   processor takes threads from the single run queue in thread.c,
+   and there is no load balancing between CPUs. */
+void
+ap_main (void) {
+	struct cpu *c = ap_boot_cpu;
+
+	thread_init_ap (c);
+	pml4_activate (NULL);
+	intr_init_ap ();
+	fpu_init_cpu ();
+	lapic_init ();
+	c->online = true;
+
+	for (;;)
+		asm volatile ("cli; hlt" : : : "memory");
+}
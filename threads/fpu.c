@@ -0,0 +1,262 @@
+#include "threads/fpu.h"
+
+#include <debug.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "intrinsic.h"
+#include "threads/cpu.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+#define CR0_MP (1 << 1)         /* Monitor coprocessor. */
+#define CR0_EM (1 << 2)         /* x87 emulation. */
+#define CR0_TS (1 << 3)         /* Task switched. */
+#define CR0_NE (1 << 5)         /* Native x87 error reporting. */
+
+#define CR4_OSFXSR (1 << 9)     /* FXSAVE/FXRSTOR and SSE. */
+#define CR4_OSXMMEXCPT (1 << 10) /* Unmasked SSE exceptions -> #XF. */
+#define CR4_OSXSAVE (1 << 18)   /* XSAVE and XCR0. */
+
+#define CPUID1_ECX_XSAVE (1 << 26)
+#define CPUID1_ECX_AVX (1 << 28)
+
+#define XCR0_X87 (1 << 0)
+#define XCR0_SSE (1 << 1)
+#define XCR0_AVX (1 << 2)
+
+/* Power-on values of the x87 control word and MXCSR: all
+   exceptions masked, round to nearest. */
+#define FCW_DEFAULT 0x037f
+#define MXCSR_DEFAULT 0x1f80
+
+/* Offsets within the legacy FXSAVE region. */
+#define FXSAVE_FCW 0
+#define FXSAVE_MXCSR 24
+
+/* XSAVE is used if the CPU has it, otherwise FXSAVE. */
+static bool use_xsave;
+static uint64_t xcr0;
+
+static void fpu_trap (struct intr_frame *);
+
+static inline void
+stts (void) {
+	lcr0 (rcr0 () | CR0_TS);
+}
+
+/* Saves the FPU registers to AREA.  CR0.TS must be clear. */
+static void
+fpu_save (void *area) {
+	if (use_xsave)
+		asm volatile ("xsave64 (%0)"
+				: : "r" (area), "a" ((uint32_t) xcr0), "d" ((uint32_t) (xcr0 >> 32))
+				: "memory");
+	else
+		asm volatile ("fxsave64 (%0)" : : "r" (area) : "memory");
+}
+
+/* Loads the FPU registers from AREA.  CR0.TS must be clear. */
+static void
+fpu_restore (void *area) {
+	if (use_xsave)
+		asm volatile ("xrstor64 (%0)"
+				: : "r" (area), "a" ((uint32_t) xcr0), "d" ((uint32_t) (xcr0 >> 32))
+				: "memory");
+	else
+		asm volatile ("fxrstor64 (%0)" : : "r" (area) : "memory");
+}
+
+/* Returns a new save area holding the initial FPU state.  A zeroed
+   XSAVE header marks every component as being in its init state;
+   only the control words need their power-on values.  Returns a
+   null pointer if memory is exhausted. */
+static void *
+fpu_alloc (void) {
+	uint8_t *area = palloc_get_page (PAL_ZERO);
+
+	if (area != NULL) {
+		*(uint16_t *) (area + FXSAVE_FCW) = FCW_DEFAULT;
+		*(uint32_t *) (area + FXSAVE_MXCSR) = MXCSR_DEFAULT;
+	}
+	return area;
+}
+
+/* Detects the FPU save mechanism, enables it on the bootstrap CPU,
+   and takes over #NM.  Called from intr_init(). */
+void
+fpu_init (void) {
+	uint32_t eax = 1, ebx, ecx = 0, edx;
+
+	asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+	if (ecx & CPUID1_ECX_XSAVE) {
+		use_xsave = true;
+		xcr0 = XCR0_X87 | XCR0_SSE;
+		if (ecx & CPUID1_ECX_AVX)
+			xcr0 |= XCR0_AVX;
+	}
+
+	fpu_init_cpu ();
+
+	if (use_xsave) {
+		/* The save area for the enabled components must fit in the
+		   page fpu_alloc() hands out. */
+		eax = 0xd;
+		ecx = 0;
+		asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+		ASSERT (ebx <= PGSIZE);
+	}
+
+	intr_register_int (7, 0, INTR_ON, fpu_trap,
+			"#NM Device Not Available Exception");
+}
+
+/* Enables FXSAVE/XSAVE on the running CPU and sets CR0.TS so that
+   the first FPU instruction traps. */
+void
+fpu_init_cpu (void) {
+	struct cpu *c = this_cpu ();
+
+	lcr0 ((rcr0 () & ~CR0_EM) | CR0_MP | CR0_NE | CR0_TS);
+	lcr4 (rcr4 () | CR4_OSFXSR | CR4_OSXMMEXCPT
+			| (use_xsave ? CR4_OSXSAVE : 0));
+	if (use_xsave)
+		asm volatile ("xsetbv"
+				: : "c" (0), "a" ((uint32_t) xcr0), "d" ((uint32_t) (xcr0 >> 32)));
+
+	c->fpu_owner = NULL;
+	c->fpu_ts = true;
+}
+
+/* Called by schedule() with interrupts off, just before switching
+   to NEXT.  Only writes CR0 when the TS bit has to change, so a
+   run of integer-only threads costs nothing. */
+void
+fpu_switch (struct thread *next) {
+	struct cpu *c = this_cpu ();
+	bool ts;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	/* Only the bootstrap processor schedules, so a switched-out
+	   owner's registers can wait for the next #NM here. */
+	ts = next != c->fpu_owner;
+	if (ts != c->fpu_ts) {
+		if (ts)
+			stts ();
+		else
+			clts ();
+		c->fpu_ts = ts;
+	}
+}
+
+/* #NM handler: the running thread used the FPU while CR0.TS was
+   set.  Hands the FPU registers over to it. */
+static void
+fpu_trap (struct intr_frame *f UNUSED) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	struct cpu *c;
+
+	/* Allocation may sleep, so do it before disabling interrupts. */
+	if (curr->fpu_state == NULL) {
+		curr->fpu_state = fpu_alloc ();
+		if (curr->fpu_state == NULL)
+			PANIC ("out of memory for FPU state of %s", curr->name);
+	}
+
+	old_level = intr_disable ();
+	c = this_cpu ();
+	clts ();
+	c->fpu_ts = false;
+	if (c->fpu_owner != curr) {
+		if (c->fpu_owner != NULL)
+			fpu_save (c->fpu_owner->fpu_state);
+		fpu_restore (curr->fpu_state);
+		c->fpu_owner = curr;
+	}
+	intr_set_level (old_level);
+}
+
+/* Gives DST, the running thread, a copy of SRC's FPU state.  Used
+   by fork so the child starts with the parent's registers. */
+void
+fpu_copy (struct thread *dst, struct thread *src) {
+	enum intr_level old_level;
+	struct cpu *c;
+
+	ASSERT (dst == thread_current ());
+
+	if (src->fpu_state == NULL)
+		return;
+	if (dst->fpu_state == NULL && (dst->fpu_state = fpu_alloc ()) == NULL)
+		PANIC ("out of memory for FPU state of %s", dst->name);
+
+	old_level = intr_disable ();
+	c = this_cpu ();
+	if (c->fpu_owner == src) {
+		/* The newest copy of SRC's state is still in the registers. */
+		if (c->fpu_ts)
+			clts ();
+		fpu_save (dst->fpu_state);
+		if (c->fpu_ts)
+			stts ();
+	} else
+		memcpy (dst->fpu_state, src->fpu_state, PGSIZE);
+	intr_set_level (old_level);
+}
+
+/* Releases the running thread's FPU state.  Called from
+   thread_exit() before the thread is descheduled. */
+void
+fpu_exit (void) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	struct cpu *c;
+	void *area;
+
+	old_level = intr_disable ();
+	c = this_cpu ();
+	if (c->fpu_owner == curr) {
+		c->fpu_owner = NULL;
+		if (!c->fpu_ts) {
+			stts ();
+			c->fpu_ts = true;
+		}
+	}
+	area = curr->fpu_state;
+	curr->fpu_state = NULL;
+	intr_set_level (old_level);
+
+	if (area != NULL)
+		palloc_free_page (area);
+}
+
+/* Claims the FPU for kernel code on the running CPU.  The owner's
+   state is saved first, so the caller may clobber any register.
+   Returns the interrupt level to pass to fpu_kernel_end(). */
+enum intr_level
+fpu_kernel_begin (void) {
+	enum intr_level old_level = intr_disable ();
+	struct cpu *c = this_cpu ();
+
+	clts ();
+	c->fpu_ts = false;
+	if (c->fpu_owner != NULL) {
+		fpu_save (c->fpu_owner->fpu_state);
+		c->fpu_owner = NULL;
+	}
+	return old_level;
+}
+
+/* Ends a section started by fpu_kernel_begin().  The next thread
+   to touch the FPU reloads its own state through #NM. */
+void
+fpu_kernel_end (enum intr_level old_level) {
+	struct cpu *c = this_cpu ();
+
+	stts ();
+	c->fpu_ts = true;
+	intr_set_level (old_level);
+}
@@ -15,6 +15,7 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "devices/vga.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
@@ -23,6 +24,7 @@
 #include "threads/palloc.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
 #include "userprog/gdt.h"
@@ -100,11 +102,13 @@ int main(void) {
 #ifdef USERPROG
     exception_init();
     syscall_init();
+    process_cache_init();
 #endif
     /* Start thread scheduler and enable interrupts. */
     thread_start();
     serial_init_queue();
     timer_calibrate();
+    cpu_start_aps();
 
 #ifdef FILESYS
     /* Initialize file system. */
@@ -221,6 +225,22 @@ parse_options(char **argv) {
             random_init(atoi(value));
         else if (!strcmp(name, "-mlfqs"))
             thread_mlfqs = true;
+        else if (!strcmp(name, "-cfs"))
+            thread_cfs = true;
+        else if (!strcmp(name, "-tickless"))
+            timer_tickless = true;
+        else if (!strcmp(name, "-smp"))
+            cpu_cnt = atoi(value);
+        else if (!strcmp(name, "-iret-switch"))
+            thread_iret_switch = true;
+        else if (!strcmp(name, "-trace"))
+            trace_set_enabled(true);
+        else if (!strcmp(name, "-sched-stats"))
+            thread_sched_stats = true;
+        else if (!strcmp(name, "-intr-stats"))
+            intr_stats = true;
+        else if (!strcmp(name, "-pic"))
+            intr_force_pic = true;
 #ifdef USERPROG
         else if (!strcmp(name, "-ul"))
             user_page_limit = atoi(value);
@@ -231,6 +251,9 @@ parse_options(char **argv) {
             PANIC("unknown option `%s' (use -h for help)", name);
     }
 
+    if (thread_mlfqs && thread_cfs)
+        PANIC("-mlfqs and -cfs cannot be used together");
+
     return argv;
 }
 
@@ -327,6 +350,14 @@ usage(void) {
         "  -f                 Format file system disk during startup.\n"
         "  -rs=SEED           Set random number seed to SEED.\n"
         "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+        "  -cfs               Use completely fair scheduler.\n"
+        "  -tickless          Program the timer for the next deadline only.\n"
+        "  -smp=N             Bring up N CPUs.\n"
+        "  -iret-switch       Switch threads through a full intr_frame.\n"
+        "  -trace             Record scheduler events, dump at power off.\n"
+        "  -sched-stats       Print per-thread scheduling statistics.\n"
+        "  -intr-stats        Time interrupt handlers and interrupts-off sections.\n"
+        "  -pic               Use the 8259A PIC and PIT, not the APICs.\n"
 #ifdef USERPROG
         "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -341,6 +372,7 @@ void power_off(void) {
     filesys_done();
 #endif
 
+    trace_dump();
     print_stats();
 
     printf("Powering off...\n");
@@ -354,6 +386,7 @@ static void
 print_stats(void) {
     timer_print_stats();
     thread_print_stats();
+    intr_print_stats();
 #ifdef FILESYS
     disk_print_stats();
 #endif
@@ -4,17 +4,22 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "devices/timer.h"
 #include "intrinsic.h"
 #include "threads/flags.h"
+#include "threads/fpu.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
+#include "threads/ioapic.h"
+#include "threads/lapic.h"
 #include "threads/mmu.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #ifdef USERPROG
 #include "userprog/gdt.h"
+#include "userprog/process.h"
 #endif
 
 /* Number of x86_64 interrupts. */
@@ -101,13 +106,81 @@ static const char *intr_names[INTR_CNT];
 static bool in_external_intr; /* Are we processing an external interrupt? */
 static bool yield_on_return;  /* Should we yield on interrupt return? */
 
+/* Interrupt controller.  intr_init() routes the 16 ISA lines
+   through the I/O APIC, and acknowledges them on the local APIC,
+   if both are present and -pic was not given.  Otherwise the
+   8259A PICs deliver them, as on the original PC.  Either way
+   they arrive on vectors 0x20...0x2f. */
+bool intr_force_pic;
+static bool apic_mode;
+
 /* Programmable Interrupt Controller helpers. */
 static void pic_init(void);
+static void pic_mask_all(void);
 static void pic_end_of_interrupt(int irq);
 
 /* Interrupt handlers. */
 void intr_handler(struct intr_frame *args);
 
+/* Interrupt accounting, enabled by the -intr-stats option.
+
+   For each vector, counts hits and keeps a histogram of the time
+   spent in the handler, in nanoseconds.  Bucket 0 holds times
+   below 2**INTR_HIST_MIN_SHIFT ns, and bucket I holds times in
+   [2**(I+INTR_HIST_MIN_SHIFT-1), 2**(I+INTR_HIST_MIN_SHIFT)).
+   The last bucket also holds everything longer.
+
+   The irqsoff tracer times each section that runs between an
+   intr_disable() that turns interrupts off and the
+   intr_enable() or intr_set_level() that turns them back on.  It
+   keeps the IRQSOFF_CNT longest sections, with the addresses of
+   the code that began and ended them, which utils/backtrace can
+   turn into function names.  Time spent in interrupt handlers
+   entered through an interrupt gate is not a section: the
+   per-vector histograms cover it. */
+bool intr_stats;
+
+#define INTR_HIST_MIN_SHIFT 8
+#define INTR_HIST_BUCKETS 16
+#define IRQSOFF_CNT 8
+
+struct vec_stats {
+    uint64_t hits;                     /* Times the vector was taken. */
+    uint64_t cycles;                   /* Total TSC cycles in the handler. */
+    uint64_t max_cycles;               /* Longest single run. */
+    uint32_t hist[INTR_HIST_BUCKETS];  /* Handler times, see above. */
+};
+static struct vec_stats vec_stats[INTR_CNT];
+
+/* An interrupts-off section. */
+struct irqsoff_section {
+    uint64_t cycles;   /* Length in TSC cycles. */
+    void *begin;       /* Caller of intr_disable(). */
+    void *end;         /* Caller that turned interrupts back on. */
+};
+static struct irqsoff_section irqsoff_longest[IRQSOFF_CNT];
+static size_t irqsoff_shortest;    /* Index of the shortest kept. */
+static uint64_t irqsoff_sections;  /* Sections timed. */
+
+/* The open section, if any.  There is only one: interrupts are
+   either on or off. */
+static bool irqsoff_open;
+static uint64_t irqsoff_start;
+static void *irqsoff_begin_caller;
+
+static enum intr_level enable(void *caller);
+static enum intr_level disable(void *caller);
+static void irqsoff_end(void *caller);
+static void account_vector(uint64_t vec_no, uint64_t cycles);
+
+/* Returns true if VEC_NO is an external interrupt: one of the 16
+   PIC lines, or a vector raised by the local APIC. */
+static inline bool
+is_external(uint64_t vec_no) {
+    return (vec_no >= 0x20 && vec_no < 0x30)
+           || (vec_no >= LAPIC_VEC_FIRST && vec_no <= LAPIC_VEC_LAST);
+}
+
 /* Returns the current interrupt status. */
 enum intr_level
 intr_get_level(void) {
@@ -126,15 +199,34 @@ intr_get_level(void) {
    returns the previous interrupt status. */
 enum intr_level
 intr_set_level(enum intr_level level) {
-    return level == INTR_ON ? intr_enable() : intr_disable();
+    void *caller = __builtin_return_address(0);
+
+    return level == INTR_ON ? enable(caller) : disable(caller);
 }
 
 /* Enables interrupts and returns the previous interrupt status. */
 enum intr_level
 intr_enable(void) {
+    return enable(__builtin_return_address(0));
+}
+
+/* Disables interrupts and returns the previous interrupt status. */
+enum intr_level
+intr_disable(void) {
+    return disable(__builtin_return_address(0));
+}
+
+/* Enables interrupts on behalf of CALLER, ending the open
+   interrupts-off section, and returns the previous interrupt
+   status. */
+static enum intr_level
+enable(void *caller) {
     enum intr_level old_level = intr_get_level();
     ASSERT(!intr_context());
 
+    if (irqsoff_open)
+        irqsoff_end(caller);
+
     /* Enable interrupts by setting the interrupt flag.
 
        See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -144,9 +236,11 @@ intr_enable(void) {
     return old_level;
 }
 
-/* Disables interrupts and returns the previous interrupt status. */
-enum intr_level
-intr_disable(void) {
+/* Disables interrupts on behalf of CALLER, opening an
+   interrupts-off section if they were on, and returns the
+   previous interrupt status. */
+static enum intr_level
+disable(void *caller) {
     enum intr_level old_level = intr_get_level();
 
     /* Disable interrupts by clearing the interrupt flag.
@@ -154,9 +248,36 @@ intr_disable(void) {
        Hardware Interrupts". */
     asm volatile("cli" : : : "memory");
 
+    if (intr_stats && old_level == INTR_ON) {
+        irqsoff_open = true;
+        irqsoff_start = rdtsc();
+        irqsoff_begin_caller = caller;
+    }
+
     return old_level;
 }
 
+/* Closes the open interrupts-off section at CALLER, and keeps it
+   if it is one of the IRQSOFF_CNT longest so far. */
+static void
+irqsoff_end(void *caller) {
+    uint64_t cycles = rdtsc() - irqsoff_start;
+    struct irqsoff_section *s = &irqsoff_longest[irqsoff_shortest];
+    size_t i;
+
+    irqsoff_open = false;
+    irqsoff_sections++;
+    if (cycles <= s->cycles)
+        return;
+
+    s->cycles = cycles;
+    s->begin = irqsoff_begin_caller;
+    s->end = caller;
+    for (i = 0; i < IRQSOFF_CNT; i++)
+        if (irqsoff_longest[i].cycles < irqsoff_longest[irqsoff_shortest].cycles)
+            irqsoff_shortest = i;
+}
+
 /* Initializes the interrupt system. */
 void intr_init(void) {
     int i;
@@ -198,6 +319,32 @@ void intr_init(void) {
     intr_names[17] = "#AC Alignment Check Exception";
     intr_names[18] = "#MC Machine-Check Exception";
     intr_names[19] = "#XF SIMD Floating-Point Exception";
+
+    /* Take over #NM for lazy FPU switching. */
+    fpu_init();
+
+    /* Switch to the APICs if we can.  The PICs stay programmed,
+       so that their spurious interrupts land on 0x27 and 0x2f,
+       but fully masked. */
+    if (!intr_force_pic && lapic_init() && ioapic_init()) {
+        pic_mask_all();
+        apic_mode = true;
+        printf("Interrupts: I/O APIC with %d pins, %s local APIC.\n",
+               ioapic_pin_cnt(), lapic_is_x2apic() ? "x2APIC" : "xAPIC");
+    } else
+        printf("Interrupts: 8259A PIC.\n");
+}
+
+/* Returns true if ISA interrupts are routed through the I/O APIC
+   rather than the 8259A PICs. */
+bool intr_apic_mode(void) {
+    return apic_mode;
+}
+
+/* Loads the IDT on an application processor.  The IDT itself is
+   shared and was filled in by intr_init() on the bootstrap CPU. */
+void intr_init_ap(void) {
+    lidt(&idt_desc);
 }
 
 /* Registers interrupt VEC_NO to invoke HANDLER with descriptor
@@ -222,8 +369,29 @@ register_handler(uint8_t vec_no, int dpl, enum intr_level level,
    execute with interrupts disabled. */
 void intr_register_ext(uint8_t vec_no, intr_handler_func *handler,
                        const char *name) {
-    ASSERT(vec_no >= 0x20 && vec_no <= 0x2f);
+    ASSERT(is_external(vec_no));
     register_handler(vec_no, 0, INTR_OFF, handler, name);
+
+    /* I/O APIC lines stay masked until someone handles them.  All
+       threads run on the bootstrap processor, so that is where
+       the interrupts go. */
+    if (apic_mode && vec_no < 0x30)
+        ioapic_route(vec_no - 0x20, vec_no, lapic_id());
+}
+
+/* Stops ISA interrupt VEC_NO, one of 0x20...0x2f, from being
+   delivered, at whichever controller is in use. */
+void intr_mask_ext(uint8_t vec_no) {
+    int irq = vec_no - 0x20;
+
+    ASSERT(vec_no >= 0x20 && vec_no < 0x30);
+
+    if (apic_mode)
+        ioapic_mask(irq);
+    else if (irq < 8)
+        outb(0x21, inb(0x21) | (1 << irq));
+    else
+        outb(0xa1, inb(0xa1) | (1 << (irq - 8)));
 }
 
 /* Registers internal interrupt VEC_NO to invoke HANDLER, which
@@ -241,7 +409,7 @@ void intr_register_ext(uint8_t vec_no, intr_handler_func *handler,
    discussion. */
 void intr_register_int(uint8_t vec_no, int dpl, enum intr_level level,
                        intr_handler_func *handler, const char *name) {
-    ASSERT(vec_no < 0x20 || vec_no > 0x2f);
+    ASSERT(!is_external(vec_no));
     register_handler(vec_no, dpl, level, handler, name);
 }
 
@@ -299,6 +467,13 @@ pic_init(void) {
     outb(0xa1, 0x00);
 }
 
+/* Masks every line on both PICs. */
+static void
+pic_mask_all(void) {
+    outb(0x21, 0xff);
+    outb(0xa1, 0xff);
+}
+
 /* Sends an end-of-interrupt signal to the PIC for the given IRQ.
    If we don't acknowledge the IRQ, it will never be delivered to
    us again, so this is important.  */
@@ -322,12 +497,14 @@ pic_end_of_interrupt(int irq) {
 void intr_handler(struct intr_frame *frame) {
     bool external;
     intr_handler_func *handler;
+    uint64_t start = intr_stats ? rdtsc() : 0;
 
     /* External interrupts are special.
        We only handle one at a time (so interrupts must be off)
-       and they need to be acknowledged on the PIC (see below).
+       and they need to be acknowledged on the PIC or the local
+       APIC (see below).
        An external interrupt handler cannot sleep. */
-    external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+    external = is_external(frame->vec_no);
     if (external) {
         ASSERT(intr_get_level() == INTR_OFF);
         ASSERT(!intr_context());
@@ -340,7 +517,8 @@ void intr_handler(struct intr_frame *frame) {
     handler = intr_handlers[frame->vec_no];
     if (handler != NULL)
         handler(frame);
-    else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f) {
+    else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f
+             || frame->vec_no == 0xff) {
         /* There is no handler, but this interrupt can trigger
            spuriously due to a hardware fault or hardware race
            condition.  Ignore it. */
@@ -357,10 +535,107 @@ void intr_handler(struct intr_frame *frame) {
         ASSERT(intr_context());
 
         in_external_intr = false;
-        pic_end_of_interrupt(frame->vec_no);
+        if (frame->vec_no < 0x30 && !apic_mode)
+            pic_end_of_interrupt(frame->vec_no);
+        else
+            lapic_eoi();
+    }
+
+    /* Time spent in another thread after yielding below is not
+       the handler's. */
+    if (intr_stats)
+        account_vector(frame->vec_no, rdtsc() - start);
 
+    if (external) {
         if (yield_on_return)
             thread_yield();
+
+        /* The thread we yielded to may have switched out in the
+           middle of an interrupts-off section.  The iret below
+           turns interrupts back on, so that section ends here. */
+        if (irqsoff_open)
+            irqsoff_end(__builtin_return_address(0));
+    }
+
+#ifdef USERPROG
+    /* A user thread whose process is exiting dies here rather
+       than going back to user mode. */
+    if (frame->cs == SEL_UCSEG)
+        process_exit_if_killed();
+#endif
+}
+
+/* Counts a hit on VEC_NO whose handler took CYCLES. */
+static void
+account_vector(uint64_t vec_no, uint64_t cycles) {
+    struct vec_stats *v = &vec_stats[vec_no];
+    uint64_t ns = timer_cycles_to_ns(cycles);
+    int bucket = ns == 0 ? 0 : 64 - __builtin_clzll(ns) - INTR_HIST_MIN_SHIFT;
+
+    if (bucket < 0)
+        bucket = 0;
+    if (bucket >= INTR_HIST_BUCKETS)
+        bucket = INTR_HIST_BUCKETS - 1;
+    v->hits++;
+    v->cycles += cycles;
+    if (cycles > v->max_cycles)
+        v->max_cycles = cycles;
+    v->hist[bucket]++;
+}
+
+/* Prints interrupt accounting and the longest interrupts-off
+   sections, if -intr-stats was given. */
+void intr_print_stats(void) {
+    int vec, i;
+
+    if (!intr_stats)
+        return;
+
+    printf("Interrupts (handler time in ns):\n");
+    for (vec = 0; vec < INTR_CNT; vec++) {
+        struct vec_stats *v = &vec_stats[vec];
+
+        if (v->hits == 0)
+            continue;
+        printf("  %#04x %-20s %8llu hits, %llu avg, %llu max\n",
+               vec, intr_names[vec], v->hits,
+               timer_cycles_to_ns(v->cycles / v->hits),
+               timer_cycles_to_ns(v->max_cycles));
+        for (i = 0; i < INTR_HIST_BUCKETS; i++) {
+            if (v->hist[i] == 0)
+                continue;
+            if (i == 0)
+                printf("      %10s < %-10llu %u\n", "",
+                       1ULL << INTR_HIST_MIN_SHIFT, v->hist[i]);
+            else if (i == INTR_HIST_BUCKETS - 1)
+                printf("      %10llu+ %-10s %u\n",
+                       1ULL << (i + INTR_HIST_MIN_SHIFT - 1), "", v->hist[i]);
+            else
+                printf("      %10llu - %-10llu %u\n",
+                       1ULL << (i + INTR_HIST_MIN_SHIFT - 1),
+                       1ULL << (i + INTR_HIST_MIN_SHIFT), v->hist[i]);
+        }
+    }
+
+    /* Longest first.  The addresses are return addresses; pass
+       them to utils/backtrace to see where they are. */
+    printf("Longest interrupts-off sections of %llu (ns, begin, end):\n",
+           irqsoff_sections);
+    struct irqsoff_section sorted[IRQSOFF_CNT];
+    memcpy(sorted, irqsoff_longest, sizeof sorted);
+    for (i = 0; i < IRQSOFF_CNT; i++) {
+        struct irqsoff_section *longest = NULL;
+        int j;
+
+        for (j = 0; j < IRQSOFF_CNT; j++)
+            if (sorted[j].cycles != 0
+                && (longest == NULL || sorted[j].cycles > longest->cycles))
+                longest = &sorted[j];
+        if (longest == NULL)
+            break;
+        printf("  %10llu %p %p\n", timer_cycles_to_ns(longest->cycles),
+               longest->begin, longest->end);
+        longest->cycles = 0;
     }
 }
 
@@ -0,0 +1,116 @@
+#include "threads/ioapic.h"
+
+#include <debug.h>
+
+#include "threads/init.h"
+#include "threads/mmu.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+
+/* Physical address of the first I/O APIC.  Like cpu.c, we do not
+   parse the ACPI MADT, so only the I/O APIC at the standard
+   address is used. */
+#define IOAPIC_BASE 0xfec00000
+
+/* The registers are reached indirectly: write the register number
+   to IOREGSEL, then access IOWIN.  See [82093AA] 3.1 "Memory
+   Mapped Registers for Accessing IOAPIC Registers". */
+#define IOREGSEL      0x00
+#define IOWIN         0x10
+
+#define IOAPIC_VER    0x01      /* Version and pin count. */
+#define IOAPIC_REDTBL 0x10      /* Redirection table, two per pin. */
+
+/* Redirection entry, low half.  Fixed delivery to a physical
+   destination, active high and edge triggered, as the ISA lines
+   are, unless the bits below say otherwise. */
+#define RTE_MASKED    0x00010000
+
+/* ISA line for the 8254 PIT.  Almost every PC, and QEMU and Bochs,
+   wire it to pin 2 instead of pin 0 (an "interrupt source
+   override" in the MADT); pin 0 carries the PIC's output. */
+#define IRQ_PIT       0
+#define PIT_PIN       2
+
+static volatile uint32_t *ioapic;
+static int pin_cnt;
+
+static uint32_t
+ioapic_read (int reg) {
+	ioapic[IOREGSEL / 4] = reg;
+	return ioapic[IOWIN / 4];
+}
+
+static void
+ioapic_write (int reg, uint32_t value) {
+	ioapic[IOREGSEL / 4] = reg;
+	ioapic[IOWIN / 4] = value;
+}
+
+/* Returns the pin that ISA line IRQ is wired to. */
+static int
+irq_to_pin (int irq) {
+	return irq == IRQ_PIT ? PIT_PIN : irq;
+}
+
+/* Maps the I/O APIC's registers into base_pml4, uncached, and
+   masks every pin.  Returns false if there is no I/O APIC, or it
+   has fewer than the 16 pins needed for the ISA lines. */
+bool
+ioapic_init (void) {
+	uint64_t *pte;
+	uint32_t ver;
+	int pin;
+
+	if (ioapic == NULL) {
+		pte = pml4e_walk (base_pml4, (uint64_t) ptov (IOAPIC_BASE), 1);
+		ASSERT (pte != NULL);
+		*pte = IOAPIC_BASE | PTE_P | PTE_W | PTE_PCD | PTE_PWT;
+		ioapic = ptov (IOAPIC_BASE);
+	}
+
+	/* Unbacked addresses read as all ones or all zeros.  Real I/O
+	   APICs report version 0x1X or 0x2X. */
+	ver = ioapic_read (IOAPIC_VER);
+	if ((ver & 0xff) < 0x10 || (ver & 0xff) > 0x2f)
+		return false;
+	pin_cnt = ((ver >> 16) & 0xff) + 1;
+	if (pin_cnt < 16)
+		return false;
+
+	for (pin = 0; pin < pin_cnt; pin++) {
+		ioapic_write (IOAPIC_REDTBL + 2 * pin, RTE_MASKED);
+		ioapic_write (IOAPIC_REDTBL + 2 * pin + 1, 0);
+	}
+	return true;
+}
+
+/* Returns the number of pins, once ioapic_init() has
+   succeeded. */
+int
+ioapic_pin_cnt (void) {
+	return pin_cnt;
+}
+
+/* Delivers ISA line IRQ as interrupt VEC to the CPU whose APIC ID
+   is APIC_ID, and unmasks it. */
+void
+ioapic_route (int irq, uint8_t vec, uint32_t apic_id) {
+	int pin = irq_to_pin (irq);
+
+	ASSERT (irq >= 0 && irq < 16);
+	ASSERT (apic_id < 256);
+
+	ioapic_write (IOAPIC_REDTBL + 2 * pin + 1, apic_id << 24);
+	ioapic_write (IOAPIC_REDTBL + 2 * pin, vec);
+}
+
+/* Masks ISA line IRQ. */
+void
+ioapic_mask (int irq) {
+	int pin = irq_to_pin (irq);
+
+	ASSERT (irq >= 0 && irq < 16);
+
+	ioapic_write (IOAPIC_REDTBL + 2 * pin, RTE_MASKED);
+}
@@ -0,0 +1,220 @@
+#include "threads/lapic.h"
+
+#include <debug.h>
+
+#include "intrinsic.h"
+#include "threads/init.h"
+#include "threads/mmu.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+
+/* Physical address of the local APIC register window.  Every CPU
+   sees its own APIC at the same address. */
+#define LAPIC_BASE 0xfee00000
+
+/* In x2APIC mode the registers are MSRs instead, register R at
+   X2APIC_MSR + R / 16.  See [IA32-v3a] 10.12 "Extended xAPIC
+   (x2APIC)". */
+#define MSR_APIC_BASE 0x1b
+#define APIC_BASE_EXTD (1 << 10)        /* x2APIC mode. */
+#define APIC_BASE_EN  (1 << 11)         /* APIC global enable. */
+#define X2APIC_MSR    0x800
+
+/* Register offsets.  See [IA32-v3a] 10.4.1 "The Local APIC Block
+   Diagram". */
+#define LAPIC_ID      0x020     /* Local APIC ID. */
+#define LAPIC_EOI     0x0b0     /* End of interrupt. */
+#define LAPIC_SVR     0x0f0     /* Spurious interrupt vector. */
+#define LAPIC_ICR_LO  0x300     /* Interrupt command, low half. */
+#define LAPIC_ICR_HI  0x310     /* Interrupt command, high half. */
+#define LAPIC_LVT_TIMER 0x320   /* Local vector table, timer entry. */
+#define LAPIC_TIMER_INIT 0x380  /* Timer initial count. */
+#define LAPIC_TIMER_CUR 0x390   /* Timer current count. */
+#define LAPIC_TIMER_DIV 0x3e0   /* Timer divide configuration. */
+
+#define SVR_ENABLE    0x100     /* APIC software enable. */
+#define SPURIOUS_VEC  0xff      /* Vector for spurious interrupts. */
+
+#define ICR_INIT      0x00000500        /* Delivery mode INIT. */
+#define ICR_STARTUP   0x00000600        /* Delivery mode start-up. */
+#define ICR_PENDING   0x00001000        /* Delivery status: send pending. */
+#define ICR_ASSERT    0x00004000        /* Level assert. */
+
+#define LVT_MASKED    0x00010000        /* Interrupt masked. */
+#define LVT_PERIODIC  0x00020000        /* Timer reloads on reaching zero. */
+#define TIMER_DIV_16  0x3               /* Divide the bus clock by 16. */
+
+#define CPUID_APIC    (1 << 9)  /* CPUID.1:EDX, on-chip APIC present. */
+#define CPUID_X2APIC  (1 << 21) /* CPUID.1:ECX, x2APIC supported. */
+
+/* Set by the first lapic_init(), which picks the mode every CPU
+   then uses. */
+static bool probed;
+
+/* Use the x2APIC MSR interface? */
+static bool x2apic;
+
+/* Kernel virtual address of the register window, once mapped, in
+   xAPIC mode. */
+static volatile uint32_t *lapic;
+
+static inline uint32_t
+lapic_read (int reg) {
+	if (x2apic)
+		return read_msr (X2APIC_MSR + reg / 16);
+	return lapic[reg / 4];
+}
+
+static inline void
+lapic_write (int reg, uint32_t value) {
+	if (x2apic)
+		write_msr (X2APIC_MSR + reg / 16, value);
+	else {
+		lapic[reg / 4] = value;
+		lapic[LAPIC_ID / 4];        /* Wait for the write to finish. */
+	}
+}
+
+/* Sends the interrupt command VALUE to the CPU whose APIC ID is
+   APIC_ID and waits until the local APIC has accepted it.  In
+   x2APIC mode the command register is a single 64-bit MSR and
+   the write itself waits. */
+static void
+lapic_send_ipi (uint32_t apic_id, uint32_t value) {
+	if (x2apic) {
+		write_msr (X2APIC_MSR + LAPIC_ICR_LO / 16,
+		           (uint64_t) apic_id << 32 | value);
+		return;
+	}
+	lapic_write (LAPIC_ICR_HI, apic_id << 24);
+	lapic_write (LAPIC_ICR_LO, value);
+	while (lapic_read (LAPIC_ICR_LO) & ICR_PENDING)
+		asm volatile ("pause");
+}
+
+/* Enables the running CPU's local APIC, in x2APIC mode if the
+   bootstrap processor supports it.  Otherwise the first call maps
+   the register window into base_pml4, uncached.  Returns false if
+   the CPU has no local APIC. */
+bool
+lapic_init (void) {
+	uint32_t eax = 1, ebx, ecx = 0, edx;
+
+	asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+	if (!(edx & CPUID_APIC))
+		return false;
+
+	if (!probed) {
+		x2apic = (ecx & CPUID_X2APIC) != 0;
+		if (!x2apic) {
+			uint64_t *pte = pml4e_walk (base_pml4,
+			                            (uint64_t) ptov (LAPIC_BASE), 1);
+
+			ASSERT (pte != NULL);
+			*pte = LAPIC_BASE | PTE_P | PTE_W | PTE_PCD | PTE_PWT;
+			lapic = ptov (LAPIC_BASE);
+		}
+		probed = true;
+	}
+
+	/* Going from xAPIC to x2APIC mode is a single write; the APIC
+	   must stay globally enabled throughout.  See [IA32-v3a]
+	   10.12.1 "Detecting and Enabling x2APIC Mode". */
+	if (x2apic)
+		write_msr (MSR_APIC_BASE, read_msr (MSR_APIC_BASE)
+		                          | APIC_BASE_EN | APIC_BASE_EXTD);
+
+	lapic_write (LAPIC_SVR, SVR_ENABLE | SPURIOUS_VEC);
+	return true;
+}
+
+/* Returns true if the local APICs run in x2APIC mode.  Only
+   meaningful once lapic_init() has succeeded. */
+bool
+lapic_is_x2apic (void) {
+	return x2apic;
+}
+
+/* Returns the APIC ID of the running CPU. */
+uint32_t
+lapic_id (void) {
+	uint32_t id = lapic_read (LAPIC_ID);
+
+	return x2apic ? id : id >> 24;
+}
+
+/* Sends an INIT IPI to APIC_ID, which resets it into the
+   wait-for-SIPI state. */
+void
+lapic_send_init (uint32_t apic_id) {
+	lapic_send_ipi (apic_id, ICR_INIT | ICR_ASSERT);
+}
+
+/* Sends a startup IPI to APIC_ID.  The CPU starts executing in real
+   mode at physical address ENTRY, which must be page-aligned and
+   below 1 MB. */
+void
+lapic_send_sipi (uint32_t apic_id, uint64_t entry) {
+	ASSERT (entry % PGSIZE == 0 && entry < 0x100000);
+
+	lapic_send_ipi (apic_id, ICR_STARTUP | ICR_ASSERT | (entry >> 12));
+}
+
+/* Acknowledges the interrupt being serviced, letting the local
+   APIC deliver the next one of equal or lower priority.  Runs on
+   every external interrupt, so it skips lapic_write()'s read-back:
+   the EOI only has to land before the iret, and the next
+   uncached access orders it. */
+void
+lapic_eoi (void) {
+	if (x2apic)
+		write_msr (X2APIC_MSR + LAPIC_EOI / 16, 0);
+	else
+		lapic[LAPIC_EOI / 4] = 0;
+}
+
+/* Stops the running CPU's APIC timer and points it at VEC in
+   one-shot mode, counting down at the bus clock divided by 16.
+   The timer stays masked until lapic_timer_start() or
+   lapic_timer_periodic(). */
+void
+lapic_timer_setup (uint8_t vec) {
+	ASSERT (probed);
+
+	lapic_write (LAPIC_TIMER_INIT, 0);
+	lapic_write (LAPIC_TIMER_DIV, TIMER_DIV_16);
+	lapic_write (LAPIC_LVT_TIMER, LVT_MASKED | vec);
+}
+
+/* Starts a one-shot countdown from COUNT that raises the timer
+   interrupt when it reaches zero, replacing any countdown in
+   progress.  A COUNT of 0 stops the timer.  If MASKED, the
+   countdown runs without raising an interrupt, which is how the
+   timer is calibrated. */
+void
+lapic_timer_start (uint32_t count, bool masked) {
+	uint32_t lvt = lapic_read (LAPIC_LVT_TIMER) & ~LVT_PERIODIC;
+
+	lvt = masked ? lvt | LVT_MASKED : lvt & ~LVT_MASKED;
+	lapic_write (LAPIC_LVT_TIMER, lvt);
+	lapic_write (LAPIC_TIMER_INIT, count);
+}
+
+/* Starts the timer in periodic mode: it raises the timer
+   interrupt every COUNT counts, from now on, until it is
+   restarted or stopped with lapic_timer_start(). */
+void
+lapic_timer_periodic (uint32_t count) {
+	uint32_t lvt = lapic_read (LAPIC_LVT_TIMER);
+
+	ASSERT (count > 0);
+
+	lapic_write (LAPIC_LVT_TIMER, (lvt & ~LVT_MASKED) | LVT_PERIODIC);
+	lapic_write (LAPIC_TIMER_INIT, count);
+}
+
+/* Returns the current count of the running CPU's APIC timer. */
+uint32_t
+lapic_timer_count (void) {
+	return lapic_read (LAPIC_TIMER_CUR);
+}
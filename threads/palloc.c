@@ -2,14 +2,15 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -24,12 +25,34 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is a binary buddy allocator.  Free pages form blocks
+   of 2**ORDER pages, aligned to their size relative to the pool
+   base, on one free list per order.  A request for N pages takes
+   the smallest block of at least N pages, splitting larger ones
+   as needed, and gives back the pages past N.  Freeing merges a
+   block with its buddy, the other half of the next larger block,
+   for as long as the buddy is free too.  Both take O(log n) time
+   however fragmented the pool is.
+
+   The free list links live in an array next to the pool's bitmap,
+   one per page, not in the free pages: the pools are built before
+   paging_init() maps all of memory, so the pages themselves may
+   not be reachable yet.  Interrupts are turned off while they change, so pages may be
+   freed from the scheduler and from interrupt handlers. */
+
+/* Order map entry for a page that does not start a free block. */
+#define ORDER_NONE 0xff
 
 /* A memory pool. */
 struct pool {
-	struct lock lock;               /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
+	uint8_t *order_map;             /* Order of the free block starting
+	                                   at each page, or ORDER_NONE. */
+	struct list_elem *links;        /* Free list element of each page. */
+	struct list free_lists[PALLOC_ORDERS];  /* Free blocks, by order. */
+	size_t free_cnt[PALLOC_ORDERS]; /* Length of each free list. */
 	uint8_t *base;                  /* Base of pool. */
 };
 
@@ -42,6 +65,8 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static size_t buddy_alloc (struct pool *, unsigned order);
+static void pool_release (struct pool *, size_t page_idx, size_t page_cnt);
 
 /* multiboot info */
 struct multiboot_info {
@@ -224,11 +249,13 @@ split:
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
 				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_release (pool, page_idx, page_cnt);
 				start = (uint64_t) pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t) end - start) / PGSIZE;
 				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_release (pool, page_idx, page_cnt);
 			}
 		}
 	}
@@ -262,20 +289,38 @@ palloc_init (void) {
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
+	size_t page_idx = BITMAP_ERROR;
+	enum intr_level old_level;
+	unsigned order = 0;
 	void *pages;
 
+	while (order < PALLOC_ORDERS && ((size_t) 1 << order) < page_cnt)
+		order++;
+
+	if (page_cnt > 0 && order < PALLOC_ORDERS) {
+		old_level = intr_disable ();
+		page_idx = buddy_alloc (pool, order);
+		if (page_idx != BITMAP_ERROR) {
+			/* Give back the pages of the block past PAGE_CNT. */
+			pool_release (pool, page_idx + page_cnt,
+					((size_t) 1 << order) - page_cnt);
+			bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+		}
+		intr_set_level (old_level);
+	}
+
 	if (page_idx != BITMAP_ERROR)
 		pages = pool->base + PGSIZE * page_idx;
 	else
 		pages = NULL;
 
 	if (pages) {
-		if (flags & PAL_ZERO)
-			memset (pages, 0, PGSIZE * page_cnt);
+		if (flags & PAL_ZERO) {
+			size_t i;
+
+			for (i = 0; i < page_cnt; i++)
+				memzero_page (pages + PGSIZE * i);
+		}
 	} else {
 		if (flags & PAL_ASSERT)
 			PANIC ("palloc_get: out of pages");
@@ -301,6 +346,7 @@ void
 palloc_free_multiple (void *pages, size_t page_cnt) {
 	struct pool *pool;
 	size_t page_idx;
+	enum intr_level old_level;
 
 	ASSERT (pg_ofs (pages) == 0);
 	if (pages == NULL || page_cnt == 0)
@@ -318,8 +364,11 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
+	old_level = intr_disable ();
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
 	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	pool_release (pool, page_idx, page_cnt);
+	intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -328,23 +377,67 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Returns the number of free blocks of 2**ORDER pages in the user
+   pool if PAL_USER is set in FLAGS, otherwise in the kernel pool. */
+size_t
+palloc_free_blocks (enum palloc_flags flags, unsigned order) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+
+	ASSERT (order < PALLOC_ORDERS);
+	return pool->free_cnt[order];
+}
+
+/* Prints the free pages of POOL, named NAME, and its free blocks
+   by order. */
+static void
+print_pool_stats (const char *name, const struct pool *pool) {
+	size_t free_pages = 0;
+	unsigned order;
+
+	for (order = 0; order < PALLOC_ORDERS; order++)
+		free_pages += pool->free_cnt[order] << order;
+	printf ("Palloc %s pool: %zu free pages, blocks by order:",
+			name, free_pages);
+	for (order = 0; order < PALLOC_ORDERS; order++)
+		if (pool->free_cnt[order] > 0)
+			printf (" %u:%zu", order, pool->free_cnt[order]);
+	printf ("\n");
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void) {
+	print_pool_stats ("kernel", &kernel_pool);
+	print_pool_stats ("user", &user_pool);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
+  /* We'll put the pool's used_map, order_map and links at its base.
+     Calculate the space needed for them
      and subtract it from the pool's size. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
 	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
+	size_t om_pages = DIV_ROUND_UP (pgcnt, PGSIZE) * PGSIZE;
+	size_t ln_pages = DIV_ROUND_UP (pgcnt * sizeof (struct list_elem),
+			PGSIZE) * PGSIZE;
+	unsigned order;
 
-	lock_init(&p->lock);
 	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
+	p->order_map = *bm_base + bm_pages;
+	p->links = *bm_base + bm_pages + om_pages;
 	p->base = (void *) start;
+	for (order = 0; order < PALLOC_ORDERS; order++) {
+		list_init (&p->free_lists[order]);
+		p->free_cnt[order] = 0;
+	}
 
 	// Mark all to unusable.
 	bitmap_set_all(p->used_map, true);
+	memset (p->order_map, ORDER_NONE, pgcnt);
 
-	*bm_base += bm_pages;
+	*bm_base += bm_pages + om_pages + ln_pages;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -356,3 +449,100 @@ page_from_pool (const struct pool *pool, void *page) {
 	size_t end_page = start_page + bitmap_size (pool->used_map);
 	return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the page index in POOL of free list element E. */
+static size_t
+elem_to_idx (const struct pool *pool, struct list_elem *e) {
+	return e - pool->links;
+}
+
+/* Returns the free list element of page PAGE_IDX in POOL. */
+static struct list_elem *
+idx_to_elem (const struct pool *pool, size_t page_idx) {
+	return &pool->links[page_idx];
+}
+
+/* Puts the free block of 2**ORDER pages at PAGE_IDX on POOL's free
+   list for ORDER. */
+static void
+block_push (struct pool *pool, size_t page_idx, unsigned order) {
+	list_push_front (&pool->free_lists[order], idx_to_elem (pool, page_idx));
+	pool->order_map[page_idx] = order;
+	pool->free_cnt[order]++;
+}
+
+/* Takes the free block of 2**ORDER pages at PAGE_IDX off POOL's free
+   list for ORDER. */
+static void
+block_remove (struct pool *pool, size_t page_idx, unsigned order) {
+	ASSERT (pool->order_map[page_idx] == order);
+
+	list_remove (idx_to_elem (pool, page_idx));
+	pool->order_map[page_idx] = ORDER_NONE;
+	pool->free_cnt[order]--;
+}
+
+/* Takes a block of 2**ORDER pages from POOL, splitting a larger
+   one if there is none of that size, and returns its page index.
+   Returns BITMAP_ERROR if no block is large enough.  Interrupts
+   must be off. */
+static size_t
+buddy_alloc (struct pool *pool, unsigned order) {
+	unsigned o = order;
+	size_t page_idx;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (o < PALLOC_ORDERS && list_empty (&pool->free_lists[o]))
+		o++;
+	if (o == PALLOC_ORDERS)
+		return BITMAP_ERROR;
+
+	page_idx = elem_to_idx (pool, list_front (&pool->free_lists[o]));
+	block_remove (pool, page_idx, o);
+
+	/* Free the upper half of each split. */
+	while (o > order) {
+		o--;
+		block_push (pool, page_idx + ((size_t) 1 << o), o);
+	}
+	return page_idx;
+}
+
+/* Frees the block of 2**ORDER pages at PAGE_IDX in POOL, merging it
+   with its buddy for as long as the buddy is a free block of the
+   same order.  Interrupts must be off. */
+static void
+buddy_free (struct pool *pool, size_t page_idx, unsigned order) {
+	size_t page_cnt = bitmap_size (pool->used_map);
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (order + 1 < PALLOC_ORDERS) {
+		size_t buddy = page_idx ^ ((size_t) 1 << order);
+
+		if (buddy >= page_cnt || pool->order_map[buddy] != order)
+			break;
+		block_remove (pool, buddy, order);
+		page_idx &= ~((size_t) 1 << order);
+		order++;
+	}
+	block_push (pool, page_idx, order);
+}
+
+/* Frees the PAGE_CNT pages starting at PAGE_IDX in POOL, as the
+   largest aligned blocks that cover them.  Interrupts must be off. */
+static void
+pool_release (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	while (page_cnt > 0) {
+		unsigned order = 0;
+
+		while (order + 1 < PALLOC_ORDERS
+				&& (page_idx & (((size_t) 2 << order) - 1)) == 0
+				&& ((size_t) 2 << order) <= page_cnt)
+			order++;
+		buddy_free (pool, page_idx, order);
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+	}
+}
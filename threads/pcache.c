@@ -0,0 +1,181 @@
+#include "threads/pcache.h"
+
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "threads/workqueue.h"
+
+/* All caches, for the background work and statistics. */
+static struct list caches;
+static bool caches_initialized;
+
+/* Background work, run at the lowest priority.  Queueing it while
+   it is still pending does nothing, so one run services every
+   cache however many pcache_get() and pcache_put() calls asked
+   for it. */
+static struct workqueue pcache_wq;
+static struct work refill_work;
+
+static work_func pcache_refill_all;
+
+/* Initializes cache PC, named NAME, to hold zeroed pages from the
+   pool selected by FLAGS.  The background thread keeps at least LOW
+   zeroed pages ready, and the cache never holds more than HIGH. */
+void
+pcache_init (struct pcache *pc, const char *name, enum palloc_flags flags,
+		size_t low, size_t high) {
+	ASSERT (pc != NULL);
+	ASSERT (low <= high);
+
+	if (!caches_initialized) {
+		list_init (&caches);
+		workqueue_init (&pcache_wq, "pcache", PRI_MIN, 1);
+		work_init (&refill_work, pcache_refill_all, NULL);
+		caches_initialized = true;
+	}
+	pc->name = name;
+	pc->flags = flags & PAL_USER;
+	list_init (&pc->clean);
+	list_init (&pc->dirty);
+	pc->clean_cnt = pc->dirty_cnt = 0;
+	pc->low = low;
+	pc->high = high;
+	pc->hits = pc->misses = 0;
+	list_push_back (&caches, &pc->elem);
+}
+
+/* Asks for the background work to run.  pcache_put() runs inside
+   the scheduler, with interrupts off, where work_queue() never
+   yields. */
+static void
+kick_worker (void) {
+	work_queue (&pcache_wq, &refill_work);
+}
+
+/* Returns true if PC has work for the background thread. */
+static bool
+needs_work (const struct pcache *pc) {
+	return pc->dirty_cnt > 0 || pc->clean_cnt < pc->low;
+}
+
+/* Returns a zeroed page, or a null pointer if memory is exhausted. */
+void *
+pcache_get (struct pcache *pc) {
+	enum intr_level old_level = intr_disable ();
+	struct list_elem *e = NULL;
+
+	if (pc->clean_cnt > 0) {
+		e = list_pop_front (&pc->clean);
+		pc->clean_cnt--;
+		pc->hits++;
+	} else
+		pc->misses++;
+	if (needs_work (pc))
+		kick_worker ();
+	intr_set_level (old_level);
+
+	if (e == NULL)
+		return palloc_get_page (pc->flags | PAL_ZERO);
+
+	/* The list link was the only non-zero part of the page. */
+	memset (e, 0, sizeof *e);
+	return e;
+}
+
+/* Returns PAGE, which came from pcache_get(), to PC. */
+void
+pcache_put (struct pcache *pc, void *page) {
+	enum intr_level old_level;
+	bool keep;
+
+	if (page == NULL)
+		return;
+	ASSERT (pg_ofs (page) == 0);
+
+	old_level = intr_disable ();
+	keep = pc->clean_cnt + pc->dirty_cnt < pc->high;
+	if (keep) {
+		list_push_back (&pc->dirty, (struct list_elem *) page);
+		pc->dirty_cnt++;
+		kick_worker ();
+	}
+	intr_set_level (old_level);
+
+	if (!keep)
+		palloc_free_page (page);
+}
+
+/* Zeroes returned pages and refills PC up to its low watermark. */
+static void
+pcache_refill (struct pcache *pc) {
+	enum intr_level old_level = intr_disable ();
+
+	while (pc->dirty_cnt > 0) {
+		struct list_elem *e = list_pop_front (&pc->dirty);
+
+		pc->dirty_cnt--;
+		intr_set_level (old_level);
+		memzero_page (e);
+		old_level = intr_disable ();
+		list_push_back (&pc->clean, e);
+		pc->clean_cnt++;
+	}
+
+	while (pc->clean_cnt < pc->low) {
+		void *page;
+
+		intr_set_level (old_level);
+		page = palloc_get_page (pc->flags | PAL_ZERO);
+		old_level = intr_disable ();
+		if (page == NULL)
+			break;
+		if (pc->clean_cnt + pc->dirty_cnt >= pc->high) {
+			/* pcache_put() filled the cache meanwhile. */
+			intr_set_level (old_level);
+			palloc_free_page (page);
+			old_level = intr_disable ();
+			break;
+		}
+		list_push_back (&pc->clean, (struct list_elem *) page);
+		pc->clean_cnt++;
+	}
+	intr_set_level (old_level);
+}
+
+/* Background work: services every cache.  Caches that still
+   need work afterward, because palloc ran dry, are retried on the
+   next pcache_get() or pcache_put(). */
+static void
+pcache_refill_all (void *aux UNUSED) {
+	struct list_elem *e;
+
+	for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e))
+		pcache_refill (list_entry (e, struct pcache, elem));
+}
+
+/* Starts the background thread.  Called by thread_start() once the
+   scheduler is running.  Work queued before then is already
+   pending and runs first. */
+void
+pcache_start (void) {
+	workqueue_start (&pcache_wq, 1);
+}
+
+/* Prints cache statistics. */
+void
+pcache_print_stats (void) {
+	struct list_elem *e;
+
+	if (!caches_initialized)
+		return;
+	for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e)) {
+		struct pcache *pc = list_entry (e, struct pcache, elem);
+
+		printf ("Page cache %s: %lld hits, %lld misses, %zu cached\n",
+				pc->name, pc->hits, pc->misses, pc->clean_cnt + pc->dirty_cnt);
+	}
+}
@@ -0,0 +1,315 @@
+#include "threads/slab.h"
+
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Empty slabs a cache keeps before giving pages back. */
+#define KMEM_EMPTY_MAX 1
+
+/* Identifies a slab header. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* A slab: one page, this header followed by the slots.  A free
+   slot is linked to the next through the pointer at its cache's
+   LINK_OFS: the first word when there is no constructor, a word
+   past the object otherwise, so a constructed object is never
+   overwritten. */
+struct slab {
+	unsigned magic;             /* Always SLAB_MAGIC. */
+	struct kmem_cache *cache;   /* Owning cache. */
+	struct list_elem elem;      /* Element in one of the cache's lists. */
+	void *free;                 /* First free slot. */
+	size_t in_use;              /* Slots not on FREE. */
+};
+
+/* Offset of the first slot in a slab. */
+#define SLAB_HDR_SIZE ROUND_UP (sizeof (struct slab), sizeof (void *))
+
+/* All caches, for statistics. */
+static struct list caches;
+static bool caches_initialized;
+
+static struct slab *slab_of (void *obj);
+static struct slab *slab_create (struct kmem_cache *);
+static bool mag_refill (struct kmem_cache *);
+static void mag_drain (struct kmem_cache *, size_t cnt);
+static void cache_reclaim (struct kmem_cache *);
+
+/* Returns the link word of free slot OBJ of cache C. */
+static inline void **
+slot_link (const struct kmem_cache *c, void *obj) {
+	return (void **) ((uint8_t *) obj + c->link_ofs);
+}
+
+/* Initializes cache C, named NAME, to hand out objects of SIZE
+   bytes.  If CTOR is non-null, it is run on each object once,
+   when the slab holding it is created. */
+void
+kmem_cache_init (struct kmem_cache *c, const char *name, size_t size,
+		kmem_ctor_func *ctor) {
+	ASSERT (c != NULL);
+	ASSERT (size > 0 && size <= KMEM_MAX_SIZE);
+
+	if (!caches_initialized) {
+		list_init (&caches);
+		caches_initialized = true;
+	}
+	c->name = name;
+	c->size = size;
+	c->link_ofs = ctor != NULL ? ROUND_UP (size, sizeof (void *)) : 0;
+	c->slot_size = ROUND_UP (size, sizeof (void *));
+	if (ctor != NULL)
+		c->slot_size += sizeof (void *);
+	c->objs_per_slab = (PGSIZE - SLAB_HDR_SIZE) / c->slot_size;
+	c->ctor = ctor;
+	list_init (&c->partial);
+	list_init (&c->full);
+	list_init (&c->empty);
+	c->empty_cnt = c->slab_cnt = 0;
+	c->mag_cnt = 0;
+	c->allocs = c->frees = c->refills = c->drains = 0;
+	c->active = c->peak = 0;
+	list_push_back (&caches, &c->elem);
+}
+
+/* Returns an object from C, or a null pointer if memory is
+   exhausted.  The object is as the constructor left it, or as the
+   last kmem_cache_free() of it did; with no constructor, its
+   contents are undefined.  Sleeps when C must grow, so it may not
+   be called from an interrupt handler. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) {
+	enum intr_level old_level;
+	void *obj;
+
+	ASSERT (c != NULL);
+
+	old_level = intr_disable ();
+	while (c->mag_cnt == 0 && !mag_refill (c)) {
+		struct slab *s;
+
+		/* palloc and the constructor may sleep: run them with
+		   interrupts as they were, then look again, since another
+		   thread may have freed or grown meanwhile. */
+		intr_set_level (old_level);
+		ASSERT (!intr_context ());
+		s = slab_create (c);
+		if (s == NULL)
+			return NULL;
+		old_level = intr_disable ();
+		list_push_back (&c->empty, &s->elem);
+		c->empty_cnt++;
+		c->slab_cnt++;
+	}
+	obj = c->mag[--c->mag_cnt];
+	c->allocs++;
+	if (++c->active > c->peak)
+		c->peak = c->active;
+	intr_set_level (old_level);
+
+	return obj;
+}
+
+/* Returns a zeroed object from C, which must have no constructor,
+   or a null pointer if memory is exhausted. */
+void *
+kmem_cache_zalloc (struct kmem_cache *c) {
+	void *obj;
+
+	ASSERT (c != NULL && c->ctor == NULL);
+
+	obj = kmem_cache_alloc (c);
+	if (obj != NULL)
+		memset (obj, 0, c->size);
+	return obj;
+}
+
+/* Returns OBJ, which must have come from C, to C.  With a
+   constructor, OBJ must be back in its constructed state.  Does
+   nothing if OBJ is a null pointer. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) {
+	enum intr_level old_level;
+	bool reclaim;
+
+	ASSERT (c != NULL);
+
+	if (obj == NULL)
+		return;
+	ASSERT (slab_of (obj)->cache == c);
+
+#ifndef NDEBUG
+	/* Clear the object to help detect use-after-free bugs. */
+	if (c->ctor == NULL)
+		memset (obj, 0xcc, c->size);
+#endif
+
+	old_level = intr_disable ();
+	if (c->mag_cnt == KMEM_MAG_SIZE)
+		mag_drain (c, KMEM_MAG_BATCH);
+	c->mag[c->mag_cnt++] = obj;
+	c->frees++;
+	c->active--;
+	reclaim = c->empty_cnt > KMEM_EMPTY_MAX && !intr_context ();
+	intr_set_level (old_level);
+
+	if (reclaim)
+		cache_reclaim (c);
+}
+
+/* Returns the bytes of memory C holds: its slabs' pages. */
+size_t
+kmem_cache_footprint (const struct kmem_cache *c) {
+	return c->slab_cnt * PGSIZE;
+}
+
+/* Returns the slab that holds OBJ. */
+static struct slab *
+slab_of (void *obj) {
+	struct slab *s = pg_round_down (obj);
+
+	ASSERT (s->magic == SLAB_MAGIC);
+	return s;
+}
+
+/* Allocates a slab for C, constructs its objects and links them
+   together.  Returns the slab, or a null pointer if no page is
+   free. */
+static struct slab *
+slab_create (struct kmem_cache *c) {
+	struct slab *s;
+	uint8_t *obj;
+	size_t i;
+
+	s = palloc_get_page (0);
+	if (s == NULL)
+		return NULL;
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->free = NULL;
+	s->in_use = 0;
+
+	/* Link back to front, so that slots go out in address order. */
+	obj = (uint8_t *) s + SLAB_HDR_SIZE + c->objs_per_slab * c->slot_size;
+	for (i = 0; i < c->objs_per_slab; i++) {
+		obj -= c->slot_size;
+		if (c->ctor != NULL)
+			c->ctor (obj);
+		*slot_link (c, obj) = s->free;
+		s->free = obj;
+	}
+	return s;
+}
+
+/* Moves up to KMEM_MAG_BATCH objects from C's slabs into its
+   magazine, preferring partly used slabs over empty ones so that
+   empty slabs can be given back.  Returns true if the magazine is
+   no longer empty.  Interrupts must be off. */
+static bool
+mag_refill (struct kmem_cache *c) {
+	size_t start = c->mag_cnt;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (c->mag_cnt < KMEM_MAG_BATCH) {
+		struct slab *s;
+
+		if (!list_empty (&c->partial))
+			s = list_entry (list_front (&c->partial), struct slab, elem);
+		else if (!list_empty (&c->empty)) {
+			s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+			c->empty_cnt--;
+			list_push_front (&c->partial, &s->elem);
+		} else
+			break;
+
+		while (s->free != NULL && c->mag_cnt < KMEM_MAG_BATCH) {
+			void *obj = s->free;
+
+			s->free = *slot_link (c, obj);
+			s->in_use++;
+			c->mag[c->mag_cnt++] = obj;
+		}
+		if (s->free == NULL) {
+			list_remove (&s->elem);
+			list_push_back (&c->full, &s->elem);
+		}
+	}
+	if (c->mag_cnt > start)
+		c->refills++;
+	return c->mag_cnt > 0;
+}
+
+/* Returns the top CNT objects of C's magazine to their slabs.
+   Interrupts must be off. */
+static void
+mag_drain (struct kmem_cache *c, size_t cnt) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (cnt <= c->mag_cnt);
+
+	for (; cnt > 0; cnt--) {
+		void *obj = c->mag[--c->mag_cnt];
+		struct slab *s = slab_of (obj);
+		bool was_full = s->free == NULL;
+
+		*slot_link (c, obj) = s->free;
+		s->free = obj;
+		if (--s->in_use == 0) {
+			list_remove (&s->elem);
+			list_push_back (&c->empty, &s->elem);
+			c->empty_cnt++;
+		} else if (was_full) {
+			list_remove (&s->elem);
+			list_push_front (&c->partial, &s->elem);
+		}
+	}
+	c->drains++;
+}
+
+/* Gives C's empty slabs beyond KMEM_EMPTY_MAX back to the page
+   allocator. */
+static void
+cache_reclaim (struct kmem_cache *c) {
+	for (;;) {
+		enum intr_level old_level = intr_disable ();
+		struct slab *s = NULL;
+
+		if (c->empty_cnt > KMEM_EMPTY_MAX) {
+			s = list_entry (list_pop_back (&c->empty), struct slab, elem);
+			c->empty_cnt--;
+			c->slab_cnt--;
+		}
+		intr_set_level (old_level);
+
+		if (s == NULL)
+			break;
+		s->magic = 0;
+		palloc_free_page (s);
+	}
+}
+
+/* Prints cache statistics. */
+void
+kmem_print_stats (void) {
+	struct list_elem *e;
+
+	if (!caches_initialized)
+		return;
+	for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e)) {
+		struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+
+		if (c->allocs == 0)
+			continue;
+		printf ("Kmem cache %s: %zu-byte objects, %lld allocs, %lld frees, "
+				"%zu active, %zu peak, %zu slabs, %zu bytes unused\n",
+				c->name, c->size, c->allocs, c->frees, c->active, c->peak,
+				c->slab_cnt, kmem_cache_footprint (c) - c->active * c->size);
+	}
+}
@@ -33,6 +33,18 @@
 
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+
+/* 기부가 따라가는 중첩 락의 최대 깊이. */
+#define DONATE_DEPTH_MAX 8
+
+static bool thread_priority_more(const struct pheap_elem *,
+                                 const struct pheap_elem *, void *);
+static bool lock_priority_more(const struct pheap_elem *,
+                               const struct pheap_elem *, void *);
+static void donate_priority(struct thread *, int depth);
+static void donate_to_readers(struct thread *writer, int depth);
+static struct rwlock_hold *find_hold(struct thread *, struct rwlock *);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -47,7 +59,7 @@ void sema_init(struct semaphore *sema, unsigned value) {
     ASSERT(sema != NULL);
 
     sema->value = value;
-    list_init(&sema->waiters);
+    pheap_init(&sema->waiters, thread_priority_more, NULL);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -59,6 +71,7 @@ void sema_init(struct semaphore *sema, unsigned value) {
    thread will probably turn interrupts back on. This is
    sema_down function. */
 void sema_down(struct semaphore *sema) {
+    struct thread *cur = thread_current();
     enum intr_level old_level;
 
     ASSERT(sema != NULL);
@@ -66,7 +79,10 @@ void sema_down(struct semaphore *sema) {
 
     old_level = intr_disable();
     while (sema->value == 0) {
-        list_insert_ordered(&sema->waiters, &thread_current()->elem, cmp_priority, NULL);
+        /* 기다리는 동안 우선순위가 바뀌면 synch_priority_changed()가
+         * WAITING_SEMA를 보고 힙 안의 위치를 고쳐줍니다. */
+        cur->waiting_sema = sema;
+        pheap_push(&sema->waiters, &cur->wait_elem);
         thread_block();
     }
     sema->value--;
@@ -105,12 +121,14 @@ void sema_up(struct semaphore *sema) {
     ASSERT(sema != NULL);
 
     old_level = intr_disable();
-    list_sort(&sema->waiters, cmp_priority, NULL);
-    if (!list_empty(&sema->waiters))
-        thread_unblock(list_entry(list_pop_front(&sema->waiters), struct thread, elem));
+    if (!pheap_empty(&sema->waiters)) {
+        struct thread *t = pheap_entry(pheap_pop(&sema->waiters), struct thread, wait_elem);
+
+        t->waiting_sema = NULL;
+        thread_unblock(t);
+    }
 
     sema->value++;
-    list_sort(&sema->waiters, cmp_priority, NULL);
     thread_switching();
     intr_set_level(old_level);
 }
@@ -166,9 +184,85 @@ void lock_init(struct lock *lock) {
     ASSERT(lock != NULL);
 
     lock->holder = NULL;
+    lock->max_priority = PRI_MIN - 1;
     sema_init(&lock->semaphore, 1);
 }
 
+/* 방금 LOCK을 얻은 현재 스레드를 holder로 기록합니다. 우선순위 스케줄링이면
+ * 남아있는 대기자들의 우선순위를 LOCK의 max_priority로 모아 held_locks에
+ * 넣으므로, 대기자들은 새 holder에게 그대로 기부하게 됩니다.
+ * 인터럽트가 꺼진 상태에서 불러야 합니다. */
+static void lock_take(struct lock *lock) {
+    struct thread *cur = thread_current();
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    lock->holder = cur;
+    cur->waiting_lock = NULL;
+    if (thread_mlfqs) return;
+
+    if (pheap_empty(&lock->semaphore.waiters))
+        lock->max_priority = PRI_MIN - 1;
+    else
+        lock->max_priority =
+            pheap_entry(pheap_top(&lock->semaphore.waiters), struct thread, wait_elem)->priority;
+
+    pheap_push(&cur->held_locks, &lock->elem);
+    restore_priority();
+}
+
+/* T가 기다리는 waiting_lock부터 holder를 따라가며 T의 우선순위를
+ * 기부합니다. 락마다 max_priority를 올리고 holder의 held_locks에서 위치를
+ * 고친 뒤 holder의 우선순위를 올립니다. 사슬의 끝이 읽기가 끝나기를 기다리는
+ * 작성자이면 읽는 스레드들에게 이어서 기부합니다. DEPTH는 이미 따라온 락의
+ * 수입니다. 인터럽트가 꺼진 상태에서 불러야 합니다. */
+static void donate_priority(struct thread *t, int depth) {
+    struct lock *l = t->waiting_lock;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    for (; l != NULL && l->holder != NULL && depth < DONATE_DEPTH_MAX; depth++) {
+        struct thread *holder = l->holder;
+
+        if (l->max_priority >= t->priority) return;
+        trace_event(TRACE_DONATE, t, holder);
+        holder->stats.donations++;
+        l->max_priority = t->priority;
+        pheap_update(&holder->held_locks, &l->elem);
+
+        if (holder->priority >= t->priority) return;
+        thread_update_priority(holder, t->priority);
+
+        t = holder;  // 기존 lock_holder였던 스레드가 기다리는 lock도 있다. (nested lock)
+        l = holder->waiting_lock;
+    }
+    if (l == NULL && t->waiting_rwlock != NULL && depth < DONATE_DEPTH_MAX)
+        donate_to_readers(t, depth + 1);
+}
+
+/* 읽기-쓰기 락의 읽기가 끝나기를 기다리는 WRITER의 우선순위를 그 락의
+ * max_priority에 올리고, 더 낮은 우선순위로 읽고 있는 스레드들에게
+ * 기부합니다. 읽는 스레드가 다른 락을 기다리고 있으면 거기서부터 다시
+ * 따라갑니다. 인터럽트가 꺼진 상태에서 불러야 합니다. */
+static void donate_to_readers(struct thread *writer, int depth) {
+    struct rwlock *rw = writer->waiting_rwlock;
+    struct list_elem *e;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (rw->max_priority >= writer->priority) return;
+    rw->max_priority = writer->priority;
+    for (e = list_begin(&rw->holds); e != list_end(&rw->holds); e = list_next(e)) {
+        struct thread *reader = list_entry(e, struct rwlock_hold, elem)->thread;
+
+        if (reader->priority >= writer->priority) continue;
+        trace_event(TRACE_DONATE, writer, reader);
+        reader->stats.donations++;
+        thread_update_priority(reader, writer->priority);
+        donate_priority(reader, depth);
+    }
+}
+
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
@@ -178,17 +272,21 @@ void lock_init(struct lock *lock) {
    interrupts disabled, but interrupts will be turned back on if
    we need to sleep. */
 void lock_acquire(struct lock *lock) {
+    enum intr_level old_level;
+
     ASSERT(lock != NULL);
     ASSERT(!intr_context());
     ASSERT(!lock_held_by_current_thread(lock));
 
+    old_level = intr_disable();
     if (!thread_mlfqs) {
         thread_current()->waiting_lock = lock;
-        donate_priority();
+        donate_priority(thread_current(), 0);
     }
 
     sema_down(&lock->semaphore);
-    lock->holder = thread_current();
+    lock_take(lock);
+    intr_set_level(old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -198,14 +296,17 @@ void lock_acquire(struct lock *lock) {
    This function will not sleep, so it may be called within an
    interrupt handler. */
 bool lock_try_acquire(struct lock *lock) {
+    enum intr_level old_level;
     bool success;
 
     ASSERT(lock != NULL);
     ASSERT(!lock_held_by_current_thread(lock));
 
+    old_level = intr_disable();
     success = sema_try_down(&lock->semaphore);
     if (success)
-        lock->holder = thread_current();
+        lock_take(lock);
+    intr_set_level(old_level);
     return success;
 }
 
@@ -216,16 +317,20 @@ bool lock_try_acquire(struct lock *lock) {
    make sense to try to release a lock within an interrupt
    handler. */
 void lock_release(struct lock *lock) {
+    enum intr_level old_level;
+
     ASSERT(lock != NULL);
     ASSERT(lock_held_by_current_thread(lock));
 
+    old_level = intr_disable();
     if (!thread_mlfqs) {
-        remove_donors_with_lock(lock);
+        pheap_remove(&thread_current()->held_locks, &lock->elem);
         restore_priority();
     }
 
     lock->holder = NULL;
     sema_up(&lock->semaphore);
+    intr_set_level(old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -237,19 +342,219 @@ bool lock_held_by_current_thread(const struct lock *lock) {
     return lock->holder == thread_current();
 }
 
-/* One semaphore in a list. */
+/* Initializes ceiling lock LOCK with priority ceiling CEILING.
+   CEILING should be the highest priority of any thread that will
+   acquire LOCK. */
+void ceiling_lock_init(struct ceiling_lock *lock, int ceiling) {
+    ASSERT(lock != NULL);
+    ASSERT(PRI_MIN <= ceiling && ceiling <= PRI_MAX);
+
+    lock->holder = NULL;
+    lock->ceiling = ceiling;
+    lock->held_ceiling = ceiling;
+    lock->outer = NULL;
+    sema_init(&lock->semaphore, 1);
+}
+
+/* Acquires ceiling lock LOCK, sleeping until it becomes available
+   if necessary, and raises the current thread to LOCK's ceiling.
+   Unlike lock_acquire(), walks no holder chain.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void ceiling_lock_acquire(struct ceiling_lock *lock) {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+
+    ASSERT(lock != NULL);
+    ASSERT(!intr_context());
+    ASSERT(!ceiling_lock_held_by_current_thread(lock));
+
+    old_level = intr_disable();
+    sema_down(&lock->semaphore);
+    lock->holder = cur;
+    lock->outer = cur->ceiling_locks;
+    lock->held_ceiling = lock->ceiling;
+    if (lock->outer != NULL && lock->outer->held_ceiling > lock->ceiling)
+        lock->held_ceiling = lock->outer->held_ceiling;
+    cur->ceiling_locks = lock;
+
+    /* 실행 중인 스레드이므로 어느 큐에서도 옮길 필요가 없습니다. */
+    if (!thread_mlfqs && cur->priority < lock->held_ceiling)
+        thread_update_priority(cur, lock->held_ceiling);
+    intr_set_level(old_level);
+}
+
+/* Releases ceiling lock LOCK, which must be the ceiling lock the
+   current thread acquired most recently, and drops the current
+   thread back to the priority it would have without LOCK. */
+void ceiling_lock_release(struct ceiling_lock *lock) {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+
+    ASSERT(lock != NULL);
+    ASSERT(ceiling_lock_held_by_current_thread(lock));
+    ASSERT(cur->ceiling_locks == lock);
+
+    old_level = intr_disable();
+    cur->ceiling_locks = lock->outer;
+    lock->outer = NULL;
+    if (!thread_mlfqs)
+        restore_priority();
+
+    lock->holder = NULL;
+    sema_up(&lock->semaphore);
+    intr_set_level(old_level);
+}
+
+/* Returns true if the current thread holds ceiling lock LOCK,
+   false otherwise. */
+bool ceiling_lock_held_by_current_thread(const struct ceiling_lock *lock) {
+    ASSERT(lock != NULL);
+
+    return lock->holder == thread_current();
+}
+
+/* Initializes readers-writer lock RW.  Any number of readers
+   may hold RW at once, or a single writer.
+
+   Writers are preferred: once a writer has started waiting, new
+   readers queue behind it until it is done, so a steady stream of
+   readers cannot starve writers. */
+void rwlock_init(struct rwlock *rw) {
+    ASSERT(rw != NULL);
+
+    lock_init(&rw->lock);
+    sema_init(&rw->drained, 0);
+    rw->readers = 0;
+    list_init(&rw->holds);
+    rw->max_priority = PRI_MIN - 1;
+    rw->writer_waiting = false;
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or
+   waits for it.  The current thread may hold at most
+   RWLOCK_HOLD_MAX readers-writer locks for reading at once.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rwlock_acquire_read(struct rwlock *rw) {
+    struct thread *cur = thread_current();
+    struct rwlock_hold *hold = find_hold(cur, NULL);
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+    ASSERT(!intr_context());
+    ASSERT(hold != NULL);
+
+    /* 작성자가 있으면 여기서 기다리며 작성자에게 우선순위를 기부합니다. */
+    lock_acquire(&rw->lock);
+    old_level = intr_disable();
+    hold->rwlock = rw;
+    hold->thread = cur;
+    list_push_back(&rw->holds, &hold->elem);
+    rw->readers++;
+    intr_set_level(old_level);
+    lock_release(&rw->lock);
+}
+
+/* Releases RW, which the current thread must hold for reading. */
+void rwlock_release_read(struct rwlock *rw) {
+    struct rwlock_hold *hold;
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+
+    old_level = intr_disable();
+    hold = find_hold(thread_current(), rw);
+    ASSERT(hold != NULL);
+    ASSERT(rw->readers > 0);
+    list_remove(&hold->elem);
+    hold->rwlock = NULL;
+    rw->readers--;
+
+    /* 기다리는 작성자에게 받은 기부를 내려놓습니다. */
+    if (!thread_mlfqs) restore_priority();
+    if (rw->readers == 0 && rw->writer_waiting) {
+        rw->writer_waiting = false;
+        sema_up(&rw->drained);
+    } else
+        thread_switching();
+    intr_set_level(old_level);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rwlock_acquire_write(struct rwlock *rw) {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+    ASSERT(!intr_context());
+
+    /* LOCK을 쥔 채로 남은 읽기가 끝나기를 기다리므로, 그 사이에 오는
+     * 읽기와 쓰기는 모두 LOCK에서 기다립니다. 기다리는 동안에는 읽는
+     * 스레드들에게 우선순위를 기부합니다. */
+    lock_acquire(&rw->lock);
+    old_level = intr_disable();
+    while (rw->readers > 0) {
+        rw->writer_waiting = true;
+        if (!thread_mlfqs) {
+            cur->waiting_rwlock = rw;
+            donate_to_readers(cur, 0);
+        }
+        sema_down(&rw->drained);
+    }
+    cur->waiting_rwlock = NULL;
+    rw->max_priority = PRI_MIN - 1;
+    intr_set_level(old_level);
+}
+
+/* Releases RW, which the current thread must hold for writing. */
+void rwlock_release_write(struct rwlock *rw) {
+    ASSERT(rw != NULL);
+    ASSERT(rw->readers == 0);
+
+    lock_release(&rw->lock);
+}
+
+/* T의 읽기 보유 중 RW를 가리키는 것을 반환합니다. RW가 NULL이면 빈 자리를
+ * 반환합니다. 없으면 NULL을 반환합니다. */
+static struct rwlock_hold *find_hold(struct thread *t, struct rwlock *rw) {
+    int i;
+
+    for (i = 0; i < RWLOCK_HOLD_MAX; i++)
+        if (t->read_holds[i].rwlock == rw) return &t->read_holds[i];
+    return NULL;
+}
+
+/* One semaphore in a condition's waiters heap. */
 struct semaphore_elem {
-    struct list_elem elem;      /* List element. */
+    struct pheap_elem elem;     /* Heap element. */
     struct semaphore semaphore; /* This semaphore. */
+    struct thread *thread;      /* Thread waiting on SEMAPHORE. */
 };
 
+/* 조건 변수 대기자 A의 스레드가 B의 스레드보다 우선순위가 높으면 true. */
+static bool waiter_priority_more(const struct pheap_elem *a,
+                                 const struct pheap_elem *b,
+                                 void *aux UNUSED) {
+    struct semaphore_elem *waiter_a = pheap_entry(a, struct semaphore_elem, elem);
+    struct semaphore_elem *waiter_b = pheap_entry(b, struct semaphore_elem, elem);
+
+    return waiter_a->thread->priority > waiter_b->thread->priority;
+}
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
 void cond_init(struct condition *cond) {
     ASSERT(cond != NULL);
 
-    list_init(&cond->waiters);
+    pheap_init(&cond->waiters, waiter_priority_more, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -273,7 +578,9 @@ void cond_init(struct condition *cond) {
    interrupts disabled, but interrupts will be turned back on if
    we need to sleep. */
 void cond_wait(struct condition *cond, struct lock *lock) {
+    struct thread *cur = thread_current();
     struct semaphore_elem waiter;
+    enum intr_level old_level;
 
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
@@ -281,8 +588,17 @@ void cond_wait(struct condition *cond, struct lock *lock) {
     ASSERT(lock_held_by_current_thread(lock));
 
     sema_init(&waiter.semaphore, 0);
-    // list_push_back (&cond->waiters, &waiter.elem);
-    list_insert_ordered(&cond->waiters, &waiter.elem, cmp_sem_priority, NULL);
+    waiter.thread = cur;
+
+    /* 대기 중에도 다른 락을 통해 기부받을 수 있으므로, 힙 위치를 고칠 수
+     * 있도록 COND_WAITERS를 남겨둡니다. 기부는 LOCK 없이 일어나므로 힙은
+     * 인터럽트를 끄고 다룹니다. */
+    old_level = intr_disable();
+    pheap_push(&cond->waiters, &waiter.elem);
+    cur->cond_waiters = &cond->waiters;
+    cur->cond_elem = &waiter.elem;
+    intr_set_level(old_level);
+
     lock_release(lock);
     sema_down(&waiter.semaphore);
     lock_acquire(lock);
@@ -296,15 +612,23 @@ void cond_wait(struct condition *cond, struct lock *lock) {
    make sense to try to signal a condition variable within an
    interrupt handler. */
 void cond_signal(struct condition *cond, struct lock *lock UNUSED) {
+    enum intr_level old_level;
+
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
     ASSERT(!intr_context());
     ASSERT(lock_held_by_current_thread(lock));
 
-    if (!list_empty(&cond->waiters)) {
-        list_sort(&cond->waiters, cmp_sem_priority, NULL);
-        sema_up(&list_entry(list_pop_front(&cond->waiters), struct semaphore_elem, elem)->semaphore);
+    old_level = intr_disable();
+    if (!pheap_empty(&cond->waiters)) {
+        struct semaphore_elem *waiter =
+            pheap_entry(pheap_pop(&cond->waiters), struct semaphore_elem, elem);
+
+        waiter->thread->cond_waiters = NULL;
+        waiter->thread->cond_elem = NULL;
+        sema_up(&waiter->semaphore);
     }
+    intr_set_level(old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -317,111 +641,100 @@ void cond_broadcast(struct condition *cond, struct lock *lock) {
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
 
-    while (!list_empty(&cond->waiters))
+    while (!pheap_empty(&cond->waiters))
         cond_signal(cond, lock);
 }
 
-bool cmp_sem_priority(const struct list_elem *a,
-                      const struct list_elem *b,
-                      void *aux) {
-    struct semaphore_elem *sema_elem_a = list_entry(a, struct semaphore_elem, elem);
-    struct semaphore_elem *sema_elem_b = list_entry(b, struct semaphore_elem, elem);
+/* 세마포어 대기자 A가 B보다 우선순위가 높으면 true. */
+static bool thread_priority_more(const struct pheap_elem *a,
+                                 const struct pheap_elem *b,
+                                 void *aux UNUSED) {
+    struct thread *thread_a = pheap_entry(a, struct thread, wait_elem);
+    struct thread *thread_b = pheap_entry(b, struct thread, wait_elem);
 
-    if (list_empty(&(sema_elem_a->semaphore.waiters))) {  // a가 비어있는경우 b가 크다.
-        return false;
-    } else if (list_empty(&(sema_elem_b->semaphore.waiters))) {  // b가 비어있는경우 a가 크다.
-        return true;
-    }
+    return thread_a->priority > thread_b->priority;
+}
 
-    struct thread *thread_a = list_entry(list_front(&sema_elem_a->semaphore.waiters), struct thread, elem);
-    struct thread *thread_b = list_entry(list_front(&sema_elem_b->semaphore.waiters), struct thread, elem);
+/* 락 A로 기부된 우선순위가 락 B보다 높으면 true. */
+static bool lock_priority_more(const struct pheap_elem *a,
+                               const struct pheap_elem *b,
+                               void *aux UNUSED) {
+    struct lock *lock_a = pheap_entry(a, struct lock, elem);
+    struct lock *lock_b = pheap_entry(b, struct lock, elem);
 
-    return thread_a->priority > thread_b->priority;
+    return lock_a->max_priority > lock_b->max_priority;
 }
 
-bool cmp_donation_priority(const struct list_elem *a, const struct list_elem *b, void *aux) {
-    struct thread *thread_a = list_entry(a, struct thread, donation_elem);
-    struct thread *thread_b = list_entry(b, struct thread, donation_elem);
+/* print_waiters_in_*()가 대기자 하나를 출력합니다. */
+static void print_waiter(struct pheap_elem *e, void *aux UNUSED) {
+    struct thread *t = pheap_entry(e, struct thread, wait_elem);
 
-    return thread_a->priority > thread_b->priority;
+    printf("%s(%d) ", t->name, t->priority);
 }
 
 void print_waiters_in_lock(struct lock *lock) {
-    struct list_elem *e;
-    struct list *waiters = &lock->semaphore.waiters;
-    struct thread *t;
-
     printf("waiters in lock : ");
-    for (e = list_begin(waiters); e != list_end(waiters); e = list_next(e)) {
-        t = list_entry(e, struct thread, elem);
-        printf("%s(%d) ", t->name, t->priority);
-    }
+    pheap_apply(&lock->semaphore.waiters, print_waiter, NULL);
     printf("\n");
 }
 
 void print_waiters_in_sema(struct semaphore *sema) {
-    struct list_elem *e;
-    struct list *waiters = &sema->waiters;
-    struct thread *t;
-
     printf("waiters in sema : ");
-    for (e = list_begin(waiters); e != list_end(waiters); e = list_next(e)) {
-        t = list_entry(e, struct thread, elem);
-        printf("%s(%d) ", t->name, t->priority);
-    }
+    pheap_apply(&sema->waiters, print_waiter, NULL);
     printf("\n");
 }
 
-void donate_priority(void) {
-    struct thread *cur = thread_current();
-    struct thread *lock_holder = cur->waiting_lock->holder;
-    struct lock *l = cur->waiting_lock;
-    int depth = 0;
-    if (lock_holder)
-        list_insert_ordered(&lock_holder->donation_list, &cur->donation_elem, cmp_donation_priority, NULL);
-
-    while (lock_holder != NULL && depth < 8) {
-        if (lock_holder->priority < cur->priority) {
-            lock_holder->priority = cur->priority;
-        }
-        l = lock_holder->waiting_lock;  // 기존 lock_holder였던 스레드가 기다렸던 lock도 있다. (nested lock)
-        lock_holder = l->holder;
-        depth++;
-    }
-}
-
+/* 현재 스레드의 우선순위를 original_priority, 가진 락들로 기부된 우선순위,
+ * 가진 ceiling 락들의 ceiling, 읽고 있는 읽기-쓰기 락으로 기부된 우선순위 중
+ * 가장 높은 값으로 되돌립니다. held_locks의 top, 가장 안쪽 ceiling 락,
+ * RWLOCK_HOLD_MAX개의 읽기 보유만 보면 되므로 O(1)입니다. */
 void restore_priority(void) {
     struct thread *t = thread_current();
     int max_priority = t->original_priority;
+    enum intr_level old_level;
+    int i;
 
-    if (!list_empty(&t->donation_list)) {
-        struct list_elem *e;
-        struct list *donations = &t->donation_list;
-        struct thread *t_donated;
+    old_level = intr_disable();
+    if (!pheap_empty(&t->held_locks)) {
+        struct lock *l = pheap_entry(pheap_top(&t->held_locks), struct lock, elem);
 
-        // list_sort(&t->donation_list, cmp_donation_priority, NULL); 이미 넣어줄때 내림차순이므로, 필요가 없음을 확인완료.
-        t_donated = list_entry(list_front(&t->donation_list), struct thread, donation_elem);
-        if (max_priority < t_donated->priority) {
-            max_priority = t_donated->priority;
+        if (max_priority < l->max_priority) {
+            max_priority = l->max_priority;
         }
     }
-    t->priority = max_priority;
+    if (t->ceiling_locks != NULL && max_priority < t->ceiling_locks->held_ceiling)
+        max_priority = t->ceiling_locks->held_ceiling;
+    for (i = 0; i < RWLOCK_HOLD_MAX; i++) {
+        struct rwlock *rw = t->read_holds[i].rwlock;
+
+        if (rw != NULL && max_priority < rw->max_priority)
+            max_priority = rw->max_priority;
+    }
+    thread_update_priority(t, max_priority);
+    intr_set_level(old_level);
 }
 
-void remove_donors_with_lock(struct lock *lock) {
-    struct list_elem *e;
-    struct list *donations = &thread_current()->donation_list;
-    struct thread *t;
+/* init_thread()가 T의 동기화 관련 필드를 초기화할 때 부릅니다. */
+void synch_thread_init(struct thread *t) {
+    pheap_init(&t->held_locks, lock_priority_more, NULL);
+    t->waiting_lock = NULL;
+    t->waiting_sema = NULL;
+    t->cond_waiters = NULL;
+    t->cond_elem = NULL;
+    t->ceiling_locks = NULL;
+    t->waiting_rwlock = NULL;
+}
 
-    if (list_empty(donations)) {
-        return;
-    }
-    for (e = list_begin(donations); e != list_end(donations);) {
-        t = list_entry(e, struct thread, donation_elem);
-        if (t->waiting_lock == lock) {
-            e = list_remove(e);
-        } else {
-            e = list_next(e);
-        }
-    }
-}
\ No newline at end of file
+/* T의 우선순위가 바뀐 뒤 thread_update_priority()가 부릅니다. T가 세마포어나
+ * 조건 변수를 기다리고 있다면 그 대기자 힙에서 T의 위치를 O(log n)에
+ * 고칩니다. 인터럽트가 꺼진 상태에서 불러야 합니다. */
+void synch_priority_changed(struct thread *t) {
+    struct semaphore *sema = t->waiting_sema;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (sema != NULL)
+        pheap_update(&sema->waiters, &t->wait_elem);
+    if (t->cond_waiters != NULL)
+        pheap_update(t->cond_waiters, t->cond_elem);
+}
@@ -4,6 +4,15 @@ threads_SRC += threads/interrupt.c	# Interrupt core.
 threads_SRC += threads/intr-stubs.S	# Interrupt stubs.
 threads_SRC += threads/synch.c		# Synchronization.
 threads_SRC += threads/palloc.c		# Page allocator.
+threads_SRC += threads/pcache.c		# Zeroed page caches.
 threads_SRC += threads/malloc.c		# Subpage allocator.
+threads_SRC += threads/slab.c		# Object caches.
 threads_SRC += threads/start.S		# Startup code.
+threads_SRC += threads/switch.S		# Thread switch routine.
 threads_SRC += threads/mmu.c		    # Memory management unit related things.
+threads_SRC += threads/cpu.c		# Per-CPU data and AP bring-up.
+threads_SRC += threads/lapic.c		# Local APIC.
+threads_SRC += threads/ioapic.c		# I/O APIC.
+threads_SRC += threads/fpu.c		# Lazy FPU context switching.
+threads_SRC += threads/trace.c		# Scheduler event trace.
+threads_SRC += threads/workqueue.c	# Deferred work queues.
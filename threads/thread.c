@@ -7,14 +7,22 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "devices/timer.h"
 #include "intrinsic.h"
+#include "threads/cpu.h"
 #include "threads/fixed_point.h"
+#include "threads/fpu.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/pcache.h"
+#include "threads/slab.h"
+#include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -28,17 +36,31 @@
    이 값을 수정하지 마세요. */
 #define THREAD_BASIC 0xd42df210
 
-/* THREAD_READY 상태인 프로세스 목록, 즉 실행 준비가 되었으나 실제로 실행 중이지
- * 않은 프로세스들입니다. */
-static struct list ready_list;
+/* 우선순위별 실행 대기 큐.
+ * THREAD_READY 상태인 스레드들을 우선순위마다 하나씩 있는 FIFO 리스트에 넣고,
+ * 비어있지 않은 큐를 64비트 bitmap으로 표시합니다. 가장 높은 우선순위의
+ * 스레드는 bitmap의 최상위 비트를 찾는 것만으로 O(1)에 구할 수 있습니다.
+ * CFS에서는 대신 vruntime 순서의 레드-블랙 트리에 넣고, deadline 스레드는
+ * 마감 시각 순서의 트리에 따로 넣어 다른 모든 스레드보다 먼저 실행합니다. */
+struct run_queue {
+    struct list queues[PRI_MAX + 1]; /* 우선순위별 FIFO 리스트. */
+    uint64_t bitmap;                 /* 비트 p가 1이면 queues[p]가 비어있지 않음. */
+    size_t size;                     /* 큐에 들어있는 스레드의 총 개수. */
+    struct rbtree cfs;               /* CFS: vruntime 순서의 대기 스레드. */
+    int64_t min_vruntime;            /* CFS: 줄어들지 않는 vruntime 기준점. */
+    long load;                       /* CFS: 대기 스레드 가중치의 합. */
+    struct rbtree dl;                /* EDF: 마감 시각 순서의 deadline 스레드. */
+};
+
+/* THREAD_READY 상태인 스레드 목록. 스케줄링은 BSP만 하므로(threads/cpu.c의
+ * ap_main() 참조) 실행 대기 큐는 하나뿐입니다. 유휴 스레드, 타임 슬라이스,
+ * 통계는 CPU별로 struct cpu에 있습니다. */
+static struct run_queue ready_queue;
+
+/* thread_sleep()으로 잠든 스레드 목록. 깨어날 시각은 각 스레드의 sleep_timer가
+ * 타이머 휠에서 관리하므로, 이 리스트는 정렬되어 있지 않습니다. */
 static struct list sleep_list;
 
-/* 다음 깨워야 할 최소 시간 */
-static int64_t min_wake_ticks;
-
-/* 유휴 스레드. */
-static struct thread *idle_thread;
-
 /* 초기 스레드, init.c:main()을 실행하는 스레드. */
 static struct thread *initial_thread;
 
@@ -48,24 +70,93 @@ static struct lock tid_lock;
 /* 스레드 파괴 요청 */
 static struct list destruction_req;
 
-/* 통계. */
-static long long idle_ticks; /* 유휴 상태에서 보낸 타이머 틱의 수. */
-static long long kernel_ticks; /* 커널 스레드에서 보낸 타이머 틱의 수. */
-static long long user_ticks; /* 사용자 프로그램에서 보낸 타이머 틱의 수. */
+/* 스레드 페이지 캐시. 죽은 스레드의 페이지를 palloc에 돌려주지 않고 모아
+ * 두었다가, 백그라운드에서 0으로 채워 다음 thread_create()에 바로 내줍니다. */
+static struct pcache thread_page_cache;
+#define THREAD_CACHE_LOW 8   /* 미리 준비해 둘 페이지 수. */
+#define THREAD_CACHE_HIGH 32 /* 캐시가 최대로 들고 있을 페이지 수. */
 
 /* 스케줄링. */
 #define TIME_SLICE 4 /* 각 스레드에게 주어지는 타이머 틱의 수. */
-static unsigned thread_ticks; /* 마지막 yield 이후의 타이머 틱 수. */
+
+/* CFS. 시간은 모두 ns 단위입니다. */
+#define TICK_NS (1000000000LL / TIMER_FREQ)
+#define CFS_LATENCY (2 * TIME_SLICE * TICK_NS) /* 대기 중인 스레드가 모두 한 번씩
+                                                  도는 주기. */
+#define CFS_MIN_GRANULARITY TICK_NS    /* 가장 짧은 타임 슬라이스. */
+#define CFS_WAKEUP_GRANULARITY TICK_NS /* 깨어난 스레드가 선점하려면 이만큼
+                                          vruntime이 뒤처져 있어야 합니다. */
+#define NICE_0_WEIGHT 1024
+
+/* nice -20...20에 대응하는 CFS 가중치. nice가 1 오를 때마다 약 1.25배씩
+ * 줄어들어, 경쟁하는 두 스레드의 CPU 몫이 10%쯤 벌어집니다. 실행 시간은
+ * NICE_0_WEIGHT / 가중치 배로 vruntime에 쌓입니다. */
+static const int nice_weight[] = {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */ 9548,  7620,  6100,  4904,  3906,
+    /*  -5 */ 3121,  2501,  1991,  1586,  1277,
+    /*   0 */ 1024,  820,   655,   526,   423,
+    /*   5 */ 335,   272,   215,   172,   137,
+    /*  10 */ 110,   87,    70,    56,    45,
+    /*  15 */ 36,    29,    23,    18,    15,
+    /*  20 */ 12,
+};
+
+/* EDF. 대역폭(runtime / period)은 DL_BW_SHIFT비트 고정소수점이며, 승인된
+ * deadline 스레드의 대역폭 합이 DL_BW_MAX를 넘지 않아야 합니다. 남은 5%는
+ * 일반 클래스의 스레드들이 굶지 않게 남겨 둡니다. */
+#define DL_BW_SHIFT 20
+#define DL_BW_MAX ((95LL << DL_BW_SHIFT) / 100)
+#define DL_PERIOD_MAX (10 * 1000000000LL) /* 가장 긴 주기(10초). */
+
+static int64_t dl_total_bw;    /* 승인된 대역폭의 합. */
+static long long dl_admitted;  /* 승인된 횟수. */
+static long long dl_misses;    /* 마감 시각을 넘긴 횟수. */
+static long long dl_throttles; /* 예산을 다 써서 다음 주기까지 멈춘 횟수. */
 
 /* false (기본값)인 경우, 라운드-로빈 스케줄러를 사용합니다.
    true인 경우, 다중 레벨 피드백 큐 스케줄러를 사용합니다.
    커널 명령줄 옵션 "-o mlfqs"에 의해 제어됩니다. */
 bool thread_mlfqs;
 
+/* true인 경우 완전 공정 스케줄러(CFS)를 사용합니다. 우선순위 대신 nice 값에서
+   나온 가중치에 비례해 CPU를 나눠 줍니다. 커널 명령줄 옵션 "-cfs"에 의해
+   제어됩니다. */
+bool thread_cfs;
+
+/* true인 경우 모든 스레드 전환을 intr_frame 전체를 저장하고 iretq로 복원하는
+   예전 방식(thread_launch())으로 합니다. 비교용이며, 커널 명령줄 옵션
+   "-iret-switch"에 의해 제어됩니다. */
+bool thread_iret_switch;
+
+/* true인 경우 스레드가 종료될 때 스케줄링 통계를, 전원이 꺼질 때 깨어난 뒤
+   실행되기까지의 지연 히스토그램을 출력합니다. 커널 명령줄 옵션
+   "-sched-stats"에 의해 제어됩니다. */
+bool thread_sched_stats;
+
+/* 깨어난 뒤(thread_unblock) 실제로 실행되기까지 걸린 시간(ns)의
+ * 히스토그램. 버킷 0은 2^LATENCY_MIN_SHIFT ns 미만, 버킷 i는
+ * [2^(i+LATENCY_MIN_SHIFT-1), 2^(i+LATENCY_MIN_SHIFT)) 구간이며, 마지막
+ * 버킷은 그보다 긴 것을 모두 셉니다. */
+#define LATENCY_MIN_SHIFT 8
+#define LATENCY_BUCKETS 22
+static long long wake_latency[LATENCY_BUCKETS];
+
 /* 로드 평균 */
 static int load_avg;
 
+/* recent_cpu 감쇠는 스레드마다 게으르게(lazily) 적용합니다. load_avg가 갱신될
+ * 때마다 load_epoch를 하나 늘리고 그 시점의 감쇠 계수 (2*load_avg)/(2*load_avg+1)를
+ * decay_history에 남겨둡니다. 각 스레드는 마지막으로 반영한 epoch를 기억해 두었다가
+ * 실행 대기 큐에 들어가거나 값을 읽을 때 밀린 감쇠를 한꺼번에 적용합니다.
+ * 따라서 차단된 스레드는 깨어날 때까지 아무 비용도 들지 않습니다. */
+#define DECAY_HISTORY 128
+static int load_epoch;
+static int decay_history[DECAY_HISTORY];
+
 static void kernel_thread(thread_func *, void *aux);
+static void thread_first_entry(void);
 
 static void idle(void *aux UNUSED);
 static struct thread *next_thread_to_run(void);
@@ -73,9 +164,31 @@ static void init_thread(struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule(void);
 static tid_t allocate_tid(void);
-void thread_sleep(int64_t ticks);
-void thread_wakeup(int64_t ticks);
-void thread_switching(void);
+static void rq_init(struct run_queue *);
+static void rq_push(struct run_queue *, struct thread *);
+static void rq_remove(struct run_queue *, struct thread *);
+static struct thread *rq_pop(struct run_queue *);
+static int rq_max_priority(const struct run_queue *);
+static int mlfqs_priority(struct thread *);
+static int cfs_weight(const struct thread *);
+static bool cfs_less(const struct rb_elem *, const struct rb_elem *,
+                     void *aux);
+static void update_min_vruntime(struct run_queue *, int64_t vruntime);
+static void cfs_update_curr(struct thread *);
+static bool cfs_preempt_tick(struct thread *);
+static bool cfs_wakeup_preempt(struct thread *);
+static void cfs_place(struct thread *);
+static bool dl_less(const struct rb_elem *, const struct rb_elem *,
+                    void *aux);
+static void dl_update_curr(struct thread *);
+static bool dl_preempts(struct run_queue *, struct thread *curr);
+static bool dl_preempt_tick(struct thread *);
+static bool dl_wakeup_preempt(struct thread *);
+static void dl_wakeup(struct thread *);
+static void dl_throttle(struct thread *);
+static void dl_timer_expired(void *t_);
+static void update_curr(struct thread *);
+static void sleep_timer_expired(void *t_);
 /* T가 유효한 스레드를 가리키는 경우 true를 반환합니다. */
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC)
 
@@ -85,6 +198,12 @@ void thread_switching(void);
  있으므로, 이를 통해 현재 스레드를 찾을 수 있습니다. */
 #define running_thread() ((struct thread *)(pg_round_down(rrsp())))
 
+/* T가 자신이 속한 CPU의 유휴 스레드이면 true를 반환합니다. */
+#define is_idle(t) ((t) == (t)->cpu->idle_thread)
+
+/* T가 deadline(EDF) 스레드이면 true를 반환합니다. */
+#define is_deadline(t) ((t)->dl.period != 0)
+
 // 스레드 시작을 위한 전역 디스크립터 테이블.
 // 스레드 초기화 후에 gdt가 설정될 것이므로, 우선 임시 gdt를 설정해야 합니다.
 static uint64_t gdt[3] = {0, 0x00af9a000000ffff, 0x00cf92000000ffff};
@@ -111,17 +230,45 @@ void thread_init(void) {
     lgdt(&gdt_ds);
 
     /* 전역 스레드 컨텍스트를 초기화합니다. */
+    cpu_init();
+    rq_init(&ready_queue);
     lock_init(&tid_lock);
-    list_init(&ready_list);
     list_init(&sleep_list);
     list_init(&destruction_req);
+    pcache_init(&thread_page_cache, "thread", 0, THREAD_CACHE_LOW,
+                THREAD_CACHE_HIGH);
 
     /* 실행 중인 스레드에 대한 스레드 구조체를 설정합니다. */
     initial_thread = running_thread();
     init_thread(initial_thread, "main", PRI_DEFAULT);
+    initial_thread->cpu = &cpus[0];
     initial_thread->status = THREAD_RUNNING;
     initial_thread->tid = allocate_tid();
-    min_wake_ticks = INT64_MAX;
+    cpus[0].curr = initial_thread;
+}
+
+/* 응용 프로세서(AP) C에서 실행 중인 부트 코드를 스레드로 만듭니다.
+ * cpu_start_aps()가 준비해 둔 스택 페이지의 맨 앞이 struct thread가 되며,
+ * 이 스레드가 곧 C의 유휴 스레드입니다. 인터럽트는 꺼져 있어야 합니다. */
+void thread_init_ap(struct cpu *c) {
+    struct desc_ptr gdt_ds = {.size = sizeof(gdt) - 1,
+                              .address = (uint64_t)gdt};
+    struct thread *t = running_thread();
+    char name[16];
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    /* 부트 GDT는 곧 사라질 항등 매핑 주소에 있으므로 바꿔 둡니다. */
+    lgdt(&gdt_ds);
+
+    snprintf(name, sizeof name, "idle%d", c->id);
+    init_thread(t, name, PRI_MIN);
+    t->cpu = c;
+    t->status = THREAD_RUNNING;
+    /* 이 CPU는 아직 스케줄링을 하지 않으므로 tid_lock에서 기다릴 수
+     * 없습니다. 유휴 스레드는 tid를 쓸 일이 없으니 0으로 둡니다. */
+    t->tid = 0;
+    c->curr = c->idle_thread = t;
 }
 
 /* 선점 스레드 스케줄링을 시작하고 인터럽트를 활성화합니다.
@@ -138,30 +285,140 @@ void thread_start(void) {
 
     /* 유휴 스레드가 idle_thread를 초기화할 때까지 기다립니다. */
     sema_down(&idle_started);
+
+    /* 페이지 캐시를 채우는 백그라운드 스레드를 시작합니다. */
+    workqueue_start_system();
+    pcache_start();
 }
 
 /* 타이머 인터럽트 핸들러가 각 타이머 틱마다 호출합니다.
    따라서, 이 함수는 외부 인터럽트 컨텍스트에서 실행됩니다. */
 void thread_tick(void) {
     struct thread *t = thread_current();
+    struct cpu *c = t->cpu;
 
     /* Update statistics. */
-    if (t == idle_thread) idle_ticks++;
+    if (is_idle(t)) c->idle_ticks++;
 #ifdef USERPROG
     else if (t->pml4 != NULL)
-        user_ticks++;
+        c->user_ticks++;
 #endif
     else
-        kernel_ticks++;
+        c->kernel_ticks++;
 
     /* Enforce preemption. */
-    if (++thread_ticks >= TIME_SLICE) intr_yield_on_return();
+    c->thread_ticks++;
+    if (is_deadline(t) || !rb_empty(&ready_queue.dl)) {
+        if (dl_preempt_tick(t)) intr_yield_on_return();
+    } else if (thread_cfs) {
+        if (is_idle(t) ? ready_queue.size > 0 : cfs_preempt_tick(t))
+            intr_yield_on_return();
+    } else if (c->thread_ticks >= TIME_SLICE)
+        intr_yield_on_return();
+}
+
+/* tickless 모드에서 타이머 인터럽트 없이 지나간 N개의 틱을 현재 스레드 몫으로
+ * 반영합니다. 타이머 인터럽트 핸들러가 thread_tick() 직전에 호출합니다. */
+void thread_skip_ticks(int64_t n) {
+    struct thread *t = thread_current();
+    struct cpu *c = t->cpu;
+
+    if (is_idle(t)) c->idle_ticks += n;
+#ifdef USERPROG
+    else if (t->pml4 != NULL)
+        c->user_ticks += n;
+#endif
+    else
+        c->kernel_ticks += n;
+
+    if (thread_mlfqs && !is_idle(t))
+        t->recent_cpu = add_mixed(t->recent_cpu, n);
+    c->thread_ticks += n;
+    c->skipped_ticks += n;
+}
+
+/* NOW 이후 스케줄러가 타이머 인터럽트를 받아야 하는 가장 이른 틱을
+ * 반환합니다. tickless 모드에서 다음 인터럽트 시각을 정할 때 쓰입니다.
+ * 유휴 스레드만 돌고 있다면 깨울 일이 없으므로 INT64_MAX입니다. */
+int64_t thread_next_tick(int64_t now) {
+    struct thread *t = thread_current();
+    int64_t deadline = INT64_MAX;
+
+    if (!is_idle(t)) {
+        unsigned used = t->cpu->thread_ticks;
+
+        /* MLFQS는 실행 중인 스레드의 recent_cpu를 매 틱 갱신하고, CFS는
+         * 타임 슬라이스가 대기 중인 스레드 수에 따라 바뀌므로 매 틱
+         * 선점 여부를 봅니다. deadline 스레드는 매 틱 예산을 깎습니다. */
+        if (thread_mlfqs || thread_cfs || is_deadline(t)) return now + 1;
+        deadline = now + (used < TIME_SLICE ? TIME_SLICE - used : 1);
+    }
+
+    /* load_avg는 매 초 경계에서 계산해야 합니다. */
+    if (thread_mlfqs) {
+        int64_t second = (now / TIMER_FREQ + 1) * TIMER_FREQ;
+        if (second < deadline) deadline = second;
+    }
+    return deadline;
+}
+
+/* 깨어난 뒤 실행되기까지 NS 나노초가 걸렸음을 히스토그램에 기록합니다. */
+static void record_wake_latency(uint64_t ns) {
+    int bucket = ns == 0 ? 0 : 64 - __builtin_clzll(ns) - LATENCY_MIN_SHIFT;
+
+    if (bucket < 0) bucket = 0;
+    if (bucket >= LATENCY_BUCKETS) bucket = LATENCY_BUCKETS - 1;
+    wake_latency[bucket]++;
+}
+
+/* 깨어난 뒤 실행되기까지의 지연 히스토그램을 출력합니다. */
+static void print_wake_latency(void) {
+    int i;
+
+    printf("Wakeup-to-run latency (ns):\n");
+    for (i = 0; i < LATENCY_BUCKETS; i++) {
+        if (wake_latency[i] == 0) continue;
+        if (i == 0)
+            printf("  %12s < %-12llu %lld\n", "", 1ULL << LATENCY_MIN_SHIFT,
+                   wake_latency[i]);
+        else if (i == LATENCY_BUCKETS - 1)
+            printf("  %12llu+ %-12s %lld\n", 1ULL << (i + LATENCY_MIN_SHIFT - 1), "",
+                   wake_latency[i]);
+        else
+            printf("  %12llu - %-12llu %lld\n", 1ULL << (i + LATENCY_MIN_SHIFT - 1),
+                   1ULL << (i + LATENCY_MIN_SHIFT), wake_latency[i]);
+    }
 }
 
 /* 스레드 통계를 출력합니다. */
 void thread_print_stats(void) {
+    long long idle_ticks = 0, kernel_ticks = 0, user_ticks = 0;
+    long long skipped_ticks = 0;
+    int i;
+
+    for (i = 0; i < cpu_cnt; i++) {
+        struct cpu *c = &cpus[i];
+
+        idle_ticks += c->idle_ticks;
+        kernel_ticks += c->kernel_ticks;
+        user_ticks += c->user_ticks;
+        skipped_ticks += c->skipped_ticks;
+        if (cpu_cnt > 1)
+            printf("CPU %d: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
+                   c->id, c->idle_ticks, c->kernel_ticks, c->user_ticks);
+    }
     printf("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
            idle_ticks, kernel_ticks, user_ticks);
+    if (timer_tickless)
+        printf("Tickless: %lld ticks skipped\n", skipped_ticks);
+    if (dl_admitted > 0)
+        printf("Deadline: %lld admitted, %lld misses, %lld throttles\n",
+               dl_admitted, dl_misses, dl_throttles);
+    if (thread_sched_stats) print_wake_latency();
+    palloc_print_stats();
+    pcache_print_stats();
+    kmem_print_stats();
+    workqueue_print_stats();
 }
 
 /* NAME 이름과 주어진 초기 PRIORITY를 가진 새로운 커널 스레드를 생성하고,
@@ -184,12 +441,14 @@ tid_t thread_create(const char *name, int priority, thread_func *function,
 
     ASSERT(function != NULL);
 
-    /* 스레드 할당. */
-    t = palloc_get_page(PAL_ZERO);
+    /* 스레드 할당. 캐시에서 이미 0으로 채워진 페이지를 받습니다. */
+    t = pcache_get(&thread_page_cache);
     if (t == NULL) return TID_ERROR;
 
     /* 스레드 초기화. */
     init_thread(t, name, priority);
+    t->cpu = this_cpu();
+    t->vruntime = ready_queue.min_vruntime;
     tid = t->tid = allocate_tid();
 
     /* 스케줄된 경우 kernel_thread를 호출합니다.
@@ -203,14 +462,16 @@ tid_t thread_create(const char *name, int priority, thread_func *function,
     t->tf.cs = SEL_KCSEG;
     t->tf.eflags = FLAG_IF;
 
-    t->fd_table = palloc_get_page(PAL_ZERO);
-    t->next_fd_idx = 2;
+    /* switch_threads()가 처음 이 스레드로 전환할 때 꺼낼 스택을 만듭니다.
+     * 0으로 채워진 callee-saved 레지스터들 위에 thread_first_entry()의 주소를
+     * 놓아, ret 직후 rsp가 call 직후와 같은 정렬(16n+8)이 되게 합니다.
+     * 페이지는 PAL_ZERO로 받았으므로 레지스터 자리는 이미 0입니다. */
+    uint64_t *sp = (uint64_t *)((uint8_t *)t + PGSIZE - 16);
+    *sp = (uint64_t)thread_first_entry;
+    t->ksp = (uint64_t)(sp - SWITCH_SAVED_REGS);
 
-    // fork가 여러번 진행될시에, fd_table에 할당할 메모리조차 없을경우. ->
-    // 실제로 존재함.
-    if (t->fd_table == NULL) {
-        return TID_ERROR;
-    }
+    /* fd_table은 사용자 프로세스가 될 때 process.c에서 할당합니다.
+     * 커널 스레드는 파일 디스크립터를 쓰지 않습니다. */
 
     /*for hierarchical*/
     t->parent = thread_current();
@@ -230,19 +491,6 @@ tid_t thread_create(const char *name, int priority, thread_func *function,
     return tid;
 }
 
-/* 현재 수행중인 스레드와 가장 높은 우선순위의 스레드의 우선순위를 비교하여
- * 스케줄링 */
-void thread_switch(void) {
-    if (!list_empty(&ready_list)) {
-        struct list_elem *e = list_begin(&sleep_list);
-        struct thread *ready_thread = list_entry(e, struct thread, elem);
-
-        if (thread_get_priority() < ready_thread->priority) {
-            thread_yield();
-        }
-    }
-}
-
 /* 현재 스레드를 대기 상태로 만듭니다. 다시 스케줄될 때까지 실행되지 않습니다.
    thread_unblock()에 의해 깨어날 때까지입니다.
 
@@ -251,6 +499,7 @@ void thread_switch(void) {
 void thread_block(void) {
     ASSERT(!intr_context());
     ASSERT(intr_get_level() == INTR_OFF);
+    trace_event(TRACE_BLOCK, thread_current(), NULL);
     thread_current()->status = THREAD_BLOCKED;
     schedule();
 }
@@ -272,14 +521,6 @@ bool cmp_priority(const struct list_elem *a, const struct list_elem *b,
     return thread_a->priority > thread_b->priority;
 }
 
-bool cmp_wake_up_time(const struct list_elem *a, const struct list_elem *b,
-                      void *aux) {
-    struct thread *thread_a = list_entry(a, struct thread, elem);
-    struct thread *thread_b = list_entry(b, struct thread, elem);
-
-    return thread_a->wake_up_time < thread_b->wake_up_time;
-}
-
 // 레디로 만드는 함수
 void thread_unblock(struct thread *t) {
     enum intr_level old_level;
@@ -289,10 +530,30 @@ void thread_unblock(struct thread *t) {
     old_level = intr_disable();
     ASSERT(t->status == THREAD_BLOCKED);
 
-    list_insert_ordered(&ready_list, &t->elem, cmp_priority, NULL);
-    // list_insert_ordered(&ready_list, &t->elem, cmp_priority, NULL);
+    /* 차단되어 있는 동안 밀린 recent_cpu 감쇠를 따라잡습니다. */
+    if (thread_mlfqs && t->load_epoch != load_epoch) {
+        calculate_recent_cpu(t);
+        t->priority = mlfqs_priority(t);
+    }
+    if (is_deadline(t)) {
+        if (!t->dl.throttled) dl_wakeup(t);
+    } else if (thread_cfs)
+        cfs_place(t);
+    rq_push(&ready_queue, t);
     t->status = THREAD_READY;
 
+    /* 인터럽트 핸들러가 깨운 deadline 스레드는 핸들러가 끝나는 즉시
+     * 선점합니다. 스레드 문맥에서는 thread_switching()이 맡습니다. */
+    if (is_deadline(t) && intr_context() &&
+        dl_preempts(&ready_queue, this_cpu()->curr))
+        intr_yield_on_return();
+
+    uint64_t now = rdtsc();
+    t->stats.blocked += now - t->stats.since;
+    t->stats.since = now;
+    t->stats.woken = true;
+    trace_event(TRACE_WAKE, t, running_thread());
+
     intr_set_level(old_level);
 }
 
@@ -326,11 +587,29 @@ void thread_exit(void) {
 #ifdef USERPROG
     process_exit();
 #endif
+    fpu_exit();
+    trace_event(TRACE_EXIT, thread_current(), NULL);
+    if (thread_sched_stats) {
+        struct thread *curr = thread_current();
+        struct sched_stats *s = &curr->stats;
+
+        printf("%s: tid %d: %lld run, %lld ready, %lld blocked us; "
+               "%u voluntary, %u involuntary switches; %u donations\n",
+               curr->name, curr->tid,
+               timer_cycles_to_ns(s->run + (rdtsc() - s->since)) / 1000,
+               timer_cycles_to_ns(s->ready) / 1000,
+               timer_cycles_to_ns(s->blocked) / 1000, s->voluntary,
+               s->involuntary, s->donations);
+        if (is_deadline(curr))
+            printf("%s: tid %d: %u deadline misses\n", curr->name, curr->tid,
+                   curr->dl.misses);
+    }
     /* 단순히 우리의 상태를 dying으로 설정하고 다른 프로세스를 스케줄합니다.
        schedule_tail() 호출 중에 우리는 파괴될 것입니다. */
     /* Just set our status to dying and schedule another process.
        We will be destroyed during the call to schedule_tail(). */
     intr_disable();
+    dl_total_bw -= thread_current()->dl.bw;
     do_schedule(THREAD_DYING);
     NOT_REACHED();
 }
@@ -344,19 +623,26 @@ void thread_yield(void) {
     ASSERT(!intr_context());
 
     old_level = intr_disable();
-    if (curr != idle_thread) {
-        list_insert_ordered(&ready_list, &curr->elem, cmp_priority,
-                            NULL);  // for priority...
+    if (is_deadline(curr)) {
+        /* 예산을 다 쓴 deadline 스레드는 다음 주기까지 쉽니다. */
+        dl_update_curr(curr);
+        if (curr->dl.budget <= 0) {
+            dl_throttle(curr);
+            do_schedule(THREAD_BLOCKED);
+            intr_set_level(old_level);
+            return;
+        }
+    }
+    if (!is_idle(curr)) {
+        rq_push(&ready_queue, curr);
     }
 
     do_schedule(THREAD_READY);
     intr_set_level(old_level);
 }
 
-void set_wake_up_time(struct thread *t, int64_t ticks) {
-    t->wake_up_time = ticks;
-}
-
+/* 현재 스레드를 TICKS 시각(timer_ticks() 기준)까지 재웁니다.
+ * 깨우는 일은 스레드에 내장된 sleep_timer가 타이머 인터럽트에서 처리합니다. */
 void thread_sleep(int64_t ticks) {
     struct thread *curr = thread_current();
     enum intr_level old_level;
@@ -365,50 +651,60 @@ void thread_sleep(int64_t ticks) {
 
     old_level = intr_disable();
 
-    if (curr != idle_thread) {
-        set_wake_up_time(curr, ticks);
-        list_insert_ordered(&sleep_list, &curr->elem, cmp_wake_up_time,
-                            NULL);  // for priority...
-        if (ticks < min_wake_ticks) {
-            min_wake_ticks = ticks;
-        }
+    if (!is_idle(curr)) {
+        list_push_back(&sleep_list, &curr->elem);
+        timer_arm(&curr->sleep_timer, ticks);
     }
+    trace_event(TRACE_SLEEP, curr, NULL);
 
     thread_block();  // thread_current의 status를 BLOCKED로, schedule()진행.
                      // 순서 굉장히 중요.
     intr_set_level(old_level);
 }
 
-void thread_wakeup(int64_t ticks) {
-    if (ticks < min_wake_ticks) return;
-
-    int64_t next_min_wake_ticks = INT64_MAX;
+/* 잠든 스레드 T를 깨어날 시각 전에 깨웁니다. T가 thread_sleep()으로 잠들어
+ * 있었다면 true, 아니라면(이미 깨어났다면) false를 반환합니다. */
+bool thread_wake_sleeper(struct thread *t) {
+    enum intr_level old_level;
+    bool success;
 
-    struct list_elem *e = list_begin(&sleep_list);
-    for (e; e != list_end(&sleep_list);) {
-        struct thread *t = list_entry(e, struct thread, elem);
-        if (t->wake_up_time <= ticks) {
-            e = list_remove(e);
-            thread_unblock(
-                t);  // status를 READY로 바꾸고, ready_list에 push까지 하는함수.
+    ASSERT(is_thread(t));
 
-        } else {
-            struct list_elem *k = list_front(&sleep_list);
-            struct thread *sleep_front = list_entry(k, struct thread, elem);
-            min_wake_ticks = sleep_front->wake_up_time;
-            break;
-        }
+    old_level = intr_disable();
+    success = timer_cancel(&t->sleep_timer);
+    if (success) {
+        list_remove(&t->elem);
+        thread_unblock(t);
     }
+    intr_set_level(old_level);
+
+    return success;
+}
+
+/* sleep_timer가 만료되면 타이머 인터럽트에서 호출됩니다. */
+static void sleep_timer_expired(void *t_) {
+    struct thread *t = t_;
+
+    list_remove(&t->elem);
+    thread_unblock(t);  // status를 READY로 바꾸고, 실행 대기 큐에 push까지 하는함수.
 }
 
 void thread_switching(void) {
     if (intr_context()) return;
 
-    if (list_empty(&ready_list)) return;
+    struct thread *curr = thread_current();
+    if (is_deadline(curr) || !rb_empty(&ready_queue.dl)) {
+        if (dl_wakeup_preempt(curr)) thread_yield();
+        return;
+    }
+    if (thread_cfs) {
+        if (cfs_wakeup_preempt(curr)) thread_yield();
+        return;
+    }
+
+    if (ready_queue.size == 0) return;
     int now_priority = thread_get_priority();
-    struct list_elem *e = list_front(&ready_list);
-    struct thread *ready_front = list_entry(e, struct thread, elem);
-    int new_priority = ready_front->priority;
+    int new_priority = rq_max_priority(&ready_queue);
 
     if (new_priority > now_priority) {
         // switching 진행!
@@ -423,9 +719,7 @@ void thread_set_priority(int new_priority) {
     }
     thread_current()->priority = new_priority;
     thread_current()->original_priority = new_priority;  // 간과하면 큰일난다.
-    donate_priority();
-    restore_priority();  // donate_priority()와 restore_priority()순서는
-                         // 중요하지 않음. 결과가 똑같음.
+    restore_priority();  // 가진 락으로 기부받은 우선순위보다 낮아지지는 않음.
     thread_switching();
 }
 
@@ -436,9 +730,12 @@ int thread_get_priority(void) { return thread_current()->priority; }
 void thread_set_nice(int nice UNUSED) {
     struct thread *curr = thread_current();
     enum intr_level old_level = intr_disable();
+
+    /* CFS: 지금까지 실행한 시간은 이전 가중치로 반영합니다. */
+    update_curr(curr);
     curr->nice = nice;
 
-    calculate_priority_mlfqs(curr, NULL);
+    if (!thread_cfs) calculate_priority_mlfqs(curr, NULL);
     thread_switching();
     intr_set_level(old_level);
 }
@@ -452,6 +749,61 @@ int thread_get_nice(void) {
     return nice;
 }
 
+/* 현재 스레드를 주기 PERIOD마다 RUNTIME만큼의 CPU 시간을, 주기가 시작된
+ * 뒤 DEADLINE 안에 받는 deadline(EDF) 스레드로 만듭니다. 시간은 모두 ns
+ * 단위이며 0 < RUNTIME <= DEADLINE <= PERIOD <= 10초여야 합니다.
+ *
+ * deadline 스레드는 우선순위나 nice와 상관없이 일반 스레드보다 먼저
+ * 실행되고, 자기들끼리는 마감 시각이 이른 순서로 실행됩니다. 한 주기에
+ * RUNTIME을 다 쓰면 다음 주기까지 멈춥니다. 승인된 대역폭(RUNTIME / PERIOD)의
+ * 합이 95%를 넘게 되면 거절하고 false를 반환합니다.
+ *
+ * PERIOD가 0이면 현재 스레드를 일반 스레드로 되돌립니다. 예산 집행은 타이머
+ * 틱 단위이므로 RUNTIME은 한 틱보다 충분히 긴 편이 좋습니다. */
+bool thread_set_deadline(int64_t runtime, int64_t deadline, int64_t period) {
+    struct thread *curr = thread_current();
+    enum intr_level old_level;
+    int64_t bw = 0;
+
+    ASSERT(!intr_context());
+    ASSERT(!is_idle(curr));
+
+    if (period != 0) {
+        if (runtime <= 0 || runtime > deadline || deadline > period ||
+            period > DL_PERIOD_MAX)
+            return false;
+        bw = (runtime << DL_BW_SHIFT) / period;
+    }
+
+    old_level = intr_disable();
+    if (dl_total_bw - curr->dl.bw + bw > DL_BW_MAX) {
+        intr_set_level(old_level);
+        return false;
+    }
+
+    /* 지금까지 실행한 시간은 이전 클래스에 반영합니다. */
+    update_curr(curr);
+    dl_total_bw += bw - curr->dl.bw;
+    curr->dl.runtime = runtime;
+    curr->dl.deadline = deadline;
+    curr->dl.period = period;
+    curr->dl.bw = bw;
+    curr->dl.budget = runtime;
+    curr->dl.abs_deadline = timer_now_ns() + deadline;
+    curr->exec_start = rdtsc();
+    curr->dl.missed = false;
+    if (period != 0)
+        dl_admitted++;
+    else if (thread_cfs) {
+        /* 일반 클래스로 돌아오는 스레드는 지금 기준점부터 다시 셉니다. */
+        if (curr->vruntime < ready_queue.min_vruntime)
+            curr->vruntime = ready_queue.min_vruntime;
+    }
+    thread_switching();
+    intr_set_level(old_level);
+    return true;
+}
+
 /* 시스템 평균 부하의 100배를 반환합니다. */
 int thread_get_load_avg(void) {
     enum intr_level old_level = intr_disable();
@@ -469,57 +821,128 @@ int thread_get_recent_cpu(void) {
     return recent_cpu_100;
 }
 
-void calculate_priority_mlfqs(struct thread *t, void *aux UNUSED) {
-    if (t == idle_thread) return;
-    int new_priority =
+/* T의 우선순위를 PRIORITY로 바꿉니다. T가 실행 대기 큐에 있다면 새 우선순위의
+ * 큐로 O(1)에 옮겨줍니다. 기부(donation)와 MLFQS 재계산 모두 이 함수를 통해
+ * 우선순위를 바꿔야 실행 대기 큐가 어긋나지 않습니다. */
+void thread_update_priority(struct thread *t, int priority) {
+    enum intr_level old_level;
+
+    ASSERT(is_thread(t));
+
+    if (priority < PRI_MIN) priority = PRI_MIN;
+    if (priority > PRI_MAX) priority = PRI_MAX;
+
+    old_level = intr_disable();
+    if (t->priority != priority) {
+        if (t->status == THREAD_READY) {
+            rq_remove(&ready_queue, t);
+            t->priority = priority;
+            rq_push(&ready_queue, t);
+        } else {
+            t->priority = priority;
+            synch_priority_changed(t);
+        }
+    }
+    intr_set_level(old_level);
+}
+
+/* MLFQS 공식으로 T의 우선순위를 구합니다. [PRI_MIN, PRI_MAX]로 잘라냅니다. */
+static int mlfqs_priority(struct thread *t) {
+    int priority =
         PRI_MAX - fp_to_int_round(div_mixed(t->recent_cpu, 4)) - t->nice * 2;
-    t->priority = new_priority;
+
+    if (priority < PRI_MIN) priority = PRI_MIN;
+    if (priority > PRI_MAX) priority = PRI_MAX;
+    return priority;
+}
+
+void calculate_priority_mlfqs(struct thread *t, void *aux UNUSED) {
+    if (is_idle(t)) return;
+    thread_update_priority(t, mlfqs_priority(t));
 }
 
+/* 고정소수점 값 C의 N제곱을 O(log N)에 구합니다. */
+static int decay_power(int c, int n) {
+    int result = int_to_fp(1);
+
+    while (n > 0) {
+        if (n & 1) result = mult_fp(result, c);
+        c = mult_fp(c, c);
+        n >>= 1;
+    }
+    return result;
+}
+
+/* T의 recent_cpu에 아직 반영하지 않은 epoch들의 감쇠를 모두 적용합니다.
+ * decay_history보다 오래 밀려 있었다면, 기록이 남지 않은 앞부분은 남아있는 가장
+ * 오래된 계수 c로 근사해 닫힌 식 c^n*x + nice*(1-c^n)/(1-c)로 한 번에 계산합니다. */
 void calculate_recent_cpu(struct thread *t) {
-    if (t == idle_thread) return;
-    int new_recent_cpu =
-        div_fp(mult_mixed(load_avg, 2), add_mixed(mult_mixed(load_avg, 2), 1));
-    new_recent_cpu = mult_fp(new_recent_cpu, t->recent_cpu);
-    new_recent_cpu = add_mixed(new_recent_cpu, t->nice);
+    int missed, epoch;
 
-    t->recent_cpu = new_recent_cpu;
+    if (is_idle(t)) return;
+    missed = load_epoch - t->load_epoch;
+
+    if (missed > DECAY_HISTORY) {
+        int c = decay_history[(load_epoch + 1) % DECAY_HISTORY];
+        int cn = decay_power(c, missed - DECAY_HISTORY);
+        int one = int_to_fp(1);
+
+        t->recent_cpu = add_fp(
+            mult_fp(cn, t->recent_cpu),
+            mult_mixed(div_fp(sub_fp(one, cn), sub_fp(one, c)), t->nice));
+        missed = DECAY_HISTORY;
+    }
+
+    for (epoch = load_epoch - missed + 1; epoch <= load_epoch; epoch++)
+        t->recent_cpu = add_mixed(
+            mult_fp(decay_history[epoch % DECAY_HISTORY], t->recent_cpu),
+            t->nice);
+    t->load_epoch = load_epoch;
 }
 
 void calculate_load_avg(void) {
-    int ready_threads = (int)list_size(&ready_list);
-    if (thread_current() != idle_thread) ready_threads++;
+    int ready_threads = (int)ready_queue.size;
+    if (!is_idle(thread_current())) ready_threads++;
     int load_avg_1 = mult_fp(div_fp(int_to_fp(59), int_to_fp(60)), load_avg);
     int load_avg_2 =
         mult_mixed(div_fp(int_to_fp(1), int_to_fp(60)), ready_threads);
 
     load_avg = add_fp(load_avg_1, load_avg_2);
+
+    /* 새 epoch의 감쇠 계수를 기록합니다. */
+    load_epoch++;
+    decay_history[load_epoch % DECAY_HISTORY] =
+        div_fp(mult_mixed(load_avg, 2), add_mixed(mult_mixed(load_avg, 2), 1));
 }
 
 void increase_recent_cpu(void) {
     struct thread *curr = thread_current();
-    if (curr == idle_thread) return;
+    if (is_idle(curr)) return;
     curr->recent_cpu = add_mixed(curr->recent_cpu, 1);
 }
 
+/* 매 초 실행 중인 스레드와 실행 대기 큐의 스레드들만 새 epoch로 갱신합니다.
+ * 실행 대기 큐는 우선순위로 정렬되어 있으므로 미룰 수 없습니다. */
 void recalculate_all(void) {
     struct thread *curr = thread_current();
-    struct list_elem *e = list_begin(&ready_list);
+    struct list ready;
 
     calculate_recent_cpu(curr);
-    for (e; e != list_end(&ready_list); e = list_next(e)) {
-        struct thread *t = list_entry(e, struct thread, elem);
-        calculate_recent_cpu(t);
-        calculate_priority_mlfqs(t, NULL);
-    }
 
-    e = list_begin(&sleep_list);
-    for (e; e != list_end(&sleep_list); e = list_next(e)) {
-        struct thread *t = list_entry(e, struct thread, elem);
+    /* 재계산 도중 우선순위가 바뀐 스레드가 다른 큐로 옮겨가면서 두 번 계산되지
+     * 않도록, 실행 대기 큐를 먼저 비운 뒤 다시 채웁니다. */
+    list_init(&ready);
+    while (ready_queue.size > 0)
+        list_push_back(&ready, &rq_pop(&ready_queue)->elem);
+    while (!list_empty(&ready)) {
+        struct thread *t = list_entry(list_pop_front(&ready), struct thread, elem);
         calculate_recent_cpu(t);
-        calculate_priority_mlfqs(t, NULL);
+        t->priority = mlfqs_priority(t);
+        rq_push(&ready_queue, t);
     }
-}  // test
+
+    /* 차단된 스레드는 thread_unblock()에서 밀린 감쇠를 따라잡습니다. */
+}
 
 /* 유휴 스레드. 다른 스레드가 실행할 준비가 되어 있지 않을 때 실행됩니다.
 
@@ -532,7 +955,7 @@ void recalculate_all(void) {
 static void idle(void *idle_started_ UNUSED) {
     struct semaphore *idle_started = idle_started_;
 
-    idle_thread = thread_current();
+    thread_current()->cpu->idle_thread = thread_current();
     sema_up(idle_started);
 
     for (;;) {
@@ -554,6 +977,12 @@ static void idle(void *idle_started_ UNUSED) {
     }
 }
 
+/* switch_threads()로 처음 전환된 새 스레드가 실행하는 함수.
+ * thread_create()가 채워둔 intr_frame으로 kernel_thread()에 들어갑니다. */
+static void thread_first_entry(void) {
+    do_iret(&running_thread()->tf);
+}
+
 /* 커널 스레드의 기초로 사용되는 함수. */
 static void kernel_thread(thread_func *function, void *aux) {
     ASSERT(function != NULL);
@@ -576,26 +1005,327 @@ static void init_thread(struct thread *t, const char *name, int priority) {
     t->priority = priority;
     t->magic = THREAD_MAGIC;
     t->original_priority = priority;
-    list_init(&t->donation_list);
-    t->waiting_lock = NULL;
+    synch_thread_init(t);
     t->nice = 0;
     t->recent_cpu = 0;
-    t->wake_up_time = 0;
+    t->load_epoch = load_epoch;
+    t->stats.since = rdtsc();
+    t->exec_start = t->stats.since;
+    timer_setup(&t->sleep_timer, sleep_timer_expired, t);
+    timer_setup(&t->dl.timer, dl_timer_expired, t);
 
     ///////위는 수정 금지///////
     list_init(&t->child_list); /*자식리스트 초기화*/
+#ifdef USERPROG
+    list_init(&t->uthreads);
+    sema_init(&t->uthreads_done, 0);
+#endif
 }
 
 /* 스케줄할 다음 스레드를 선택하고 반환합니다. 실행 대기 큐에서 스레드를
-   반환해야 합니다. 실행 대기 큐가 비어있으면 idle_thread를 반환합니다. */
+   꺼내고, 비어있다면 이 CPU의 idle_thread를 반환합니다. */
 static struct thread *next_thread_to_run(void) {
-    if (list_empty(&ready_list))
-        return idle_thread;
-    else
-        return list_entry(list_pop_front(&ready_list), struct thread, elem);
+    if (ready_queue.size > 0) return rq_pop(&ready_queue);
+    return this_cpu()->idle_thread;
+}
+
+/* 실행 대기 큐 RQ를 빈 상태로 초기화합니다. */
+static void rq_init(struct run_queue *rq) {
+    int i;
+
+    for (i = PRI_MIN; i <= PRI_MAX; i++) list_init(&rq->queues[i]);
+    rq->bitmap = 0;
+    rq->size = 0;
+    rb_init(&rq->cfs, cfs_less, NULL);
+    rq->min_vruntime = 0;
+    rq->load = 0;
+    rb_init(&rq->dl, dl_less, NULL);
+}
+
+/* T를 RQ에서 자신의 우선순위에 해당하는 큐의 맨 뒤에 넣습니다. CFS에서는
+ * vruntime 순서로, deadline 스레드는 마감 시각 순서로 트리에 넣습니다.
+ * 인터럽트는 꺼져 있어야 합니다. */
+static void rq_push(struct run_queue *rq, struct thread *t) {
+    ASSERT(PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+    /* 양보하는 스레드는 트리 안에서 키가 바뀌면 안 되므로 먼저 반영합니다. */
+    if (t->status == THREAD_RUNNING) update_curr(t);
+
+    if (is_deadline(t))
+        rb_insert(&rq->dl, &t->rb_elem);
+    else if (thread_cfs) {
+        rb_insert(&rq->cfs, &t->rb_elem);
+        rq->load += cfs_weight(t);
+    } else {
+        list_push_back(&rq->queues[t->priority], &t->elem);
+        rq->bitmap |= 1ULL << t->priority;
+    }
+    rq->size++;
+}
+
+/* RQ에 들어있는 T를 꺼냅니다.
+ * T의 priority는 넣을 때와 같아야 합니다. */
+static void rq_remove(struct run_queue *rq, struct thread *t) {
+    if (is_deadline(t))
+        rb_remove(&rq->dl, &t->rb_elem);
+    else if (thread_cfs) {
+        rb_remove(&rq->cfs, &t->rb_elem);
+        rq->load -= cfs_weight(t);
+    } else {
+        list_remove(&t->elem);
+        if (list_empty(&rq->queues[t->priority]))
+            rq->bitmap &= ~(1ULL << t->priority);
+    }
+    rq->size--;
+}
+
+/* RQ의 가장 높은 우선순위 큐의 맨 앞 스레드를 꺼내 반환합니다.
+ * CFS에서는 vruntime이 가장 작은 스레드입니다. deadline 스레드가 있으면
+ * 그중 마감 시각이 가장 이른 스레드가 먼저입니다.
+ * 큐가 비어있으면 NULL을 반환합니다. */
+static struct thread *rq_pop(struct run_queue *rq) {
+    struct thread *t = NULL;
+
+    if (!rb_empty(&rq->dl)) {
+        t = rb_entry(rb_min(&rq->dl), struct thread, rb_elem);
+        rb_remove(&rq->dl, &t->rb_elem);
+        rq->size--;
+    } else if (rq->size > 0 && thread_cfs) {
+        t = rb_entry(rb_min(&rq->cfs), struct thread, rb_elem);
+        rb_remove(&rq->cfs, &t->rb_elem);
+        rq->load -= cfs_weight(t);
+        rq->size--;
+        update_min_vruntime(rq, t->vruntime);
+    } else if (rq->size > 0) {
+        int pri = rq_max_priority(rq);
+
+        t = list_entry(list_pop_front(&rq->queues[pri]), struct thread, elem);
+        if (list_empty(&rq->queues[pri])) rq->bitmap &= ~(1ULL << pri);
+        rq->size--;
+    }
+    return t;
+}
+
+/* 큐에 있는 스레드 중 가장 높은 우선순위를 반환합니다.
+ * 큐가 비어있으면 PRI_MIN - 1을 반환합니다. */
+static int rq_max_priority(const struct run_queue *rq) {
+    if (rq->bitmap == 0) return PRI_MIN - 1;
+    return 63 - __builtin_clzll(rq->bitmap);
+}
+
+/* T의 nice 값에 해당하는 CFS 가중치를 반환합니다. */
+static int cfs_weight(const struct thread *t) {
+    int nice = t->nice;
+
+    if (nice < -20) nice = -20;
+    if (nice > 20) nice = 20;
+    return nice_weight[nice + 20];
+}
+
+/* vruntime이 작은 스레드가 앞에 옵니다. 같으면 먼저 들어온 쪽이 앞입니다. */
+static bool cfs_less(const struct rb_elem *a, const struct rb_elem *b,
+                     void *aux UNUSED) {
+    return rb_entry(a, struct thread, rb_elem)->vruntime <
+           rb_entry(b, struct thread, rb_elem)->vruntime;
+}
+
+/* RQ의 min_vruntime을 실행 중이거나 방금 꺼낸 스레드의 VRUNTIME과 트리의
+ * 맨 앞 스레드 중 작은 쪽까지 올립니다. min_vruntime은 줄어들지 않으므로
+ * 새로 들어오는 스레드의 기준점이 됩니다. */
+static void update_min_vruntime(struct run_queue *rq, int64_t vruntime) {
+    struct rb_elem *first = rb_min(&rq->cfs);
+
+    if (first != NULL) {
+        int64_t v = rb_entry(first, struct thread, rb_elem)->vruntime;
+        if (v < vruntime) vruntime = v;
+    }
+    if (vruntime > rq->min_vruntime) rq->min_vruntime = vruntime;
+}
+
+/* 실행 중인 스레드 T가 exec_start 이후 실행한 시간을 가중치로 나눠 vruntime에
+ * 더합니다. 유휴 스레드는 트리에 들어가지 않으므로 건너뜁니다. 인터럽트는
+ * 꺼져 있어야 합니다. */
+static void cfs_update_curr(struct thread *t) {
+    uint64_t now = rdtsc();
+    int64_t delta = timer_cycles_to_ns(now - t->exec_start);
+
+    t->exec_start = now;
+    if (is_idle(t)) return;
+
+    t->vruntime += delta * NICE_0_WEIGHT / cfs_weight(t);
+    update_min_vruntime(&ready_queue, t->vruntime);
+}
+
+/* 실행 중인 스레드 CURR가 매 틱 선점되어야 하는지 판단합니다. CURR의 몫은
+ * CFS_LATENCY를 대기 중인 스레드들과 가중치 비율로 나눈 것이며, 그 몫을 다
+ * 썼거나 트리의 맨 앞 스레드보다 그만큼 더 앞서 나갔으면 선점합니다. */
+static bool cfs_preempt_tick(struct thread *curr) {
+    struct run_queue *rq = &ready_queue;
+    bool preempt = false;
+
+    cfs_update_curr(curr);
+
+    if (rq->size > 0) {
+        long weight = cfs_weight(curr);
+        int64_t slice = CFS_LATENCY * weight / (rq->load + weight);
+        int64_t ran = (int64_t)curr->cpu->thread_ticks * TICK_NS;
+        struct thread *first =
+            rb_entry(rb_min(&rq->cfs), struct thread, rb_elem);
+
+        if (slice < CFS_MIN_GRANULARITY) slice = CFS_MIN_GRANULARITY;
+        preempt = ran >= slice || curr->vruntime - first->vruntime > slice;
+    }
+    return preempt;
+}
+
+/* 방금 깨어나거나 생긴 스레드가 CURR를 바로 선점해야 하는지 판단합니다.
+ * 트리의 맨 앞 스레드가 CURR보다 CFS_WAKEUP_GRANULARITY 넘게 덜 실행했을 때만
+ * 선점해서, 서로 깨우는 스레드들이 매번 전환하지 않게 합니다. */
+static bool cfs_wakeup_preempt(struct thread *curr) {
+    struct run_queue *rq = &ready_queue;
+    enum intr_level old_level = intr_disable();
+    bool preempt = false;
+
+    if (rq->size > 0 && is_idle(curr))
+        preempt = true;
+    else if (rq->size > 0) {
+        cfs_update_curr(curr);
+        preempt = curr->vruntime -
+                      rb_entry(rb_min(&rq->cfs), struct thread, rb_elem)->vruntime >
+                  CFS_WAKEUP_GRANULARITY;
+    }
+    intr_set_level(old_level);
+    return preempt;
+}
+
+/* 깨어나는 T의 vruntime이 min_vruntime보다 CFS_LATENCY / 2 넘게
+ * 뒤처지지 않게 끌어올립니다. 오래 잠들었던 스레드는 곧바로 실행될 만큼만
+ * 우대받고, 밀린 몫을 한꺼번에 받아 다른 스레드를 굶기지는 않습니다. */
+static void cfs_place(struct thread *t) {
+    int64_t floor = ready_queue.min_vruntime - CFS_LATENCY / 2;
+
+    if (t->vruntime < floor) t->vruntime = floor;
+}
+
+/* 실행 중인 스레드 T가 실행한 시간을 T의 클래스에 반영합니다. */
+static void update_curr(struct thread *t) {
+    if (is_deadline(t))
+        dl_update_curr(t);
+    else if (thread_cfs)
+        cfs_update_curr(t);
+}
+
+/* 마감 시각이 이른 스레드가 앞에 옵니다. */
+static bool dl_less(const struct rb_elem *a, const struct rb_elem *b,
+                    void *aux UNUSED) {
+    return rb_entry(a, struct thread, rb_elem)->dl.abs_deadline <
+           rb_entry(b, struct thread, rb_elem)->dl.abs_deadline;
+}
+
+/* 실행 중인 deadline 스레드 T가 exec_start 이후 실행한 시간을 예산에서
+ * 빼고, 마감 시각을 넘겼으면 한 번 세어 둡니다. 인터럽트는 꺼져 있어야
+ * 합니다. */
+static void dl_update_curr(struct thread *t) {
+    uint64_t now = rdtsc();
+
+    t->dl.budget -= timer_cycles_to_ns(now - t->exec_start);
+    t->exec_start = now;
+    if (!t->dl.missed && timer_now_ns() > t->dl.abs_deadline) {
+        t->dl.missed = true;
+        t->dl.misses++;
+        dl_misses++;
+    }
+}
+
+/* RQ에서 기다리는 deadline 스레드가 CURR를 선점해야 하면 true를
+ * 반환합니다. 일반 스레드는 언제나, deadline 스레드는 마감 시각이 더 늦을
+ * 때 선점됩니다. */
+static bool dl_preempts(struct run_queue *rq, struct thread *curr) {
+    struct rb_elem *first = rb_min(&rq->dl);
+
+    if (first == NULL) return false;
+    if (!is_deadline(curr) || is_idle(curr)) return true;
+    return rb_entry(first, struct thread, rb_elem)->dl.abs_deadline <
+           curr->dl.abs_deadline;
+}
+
+/* deadline 스레드가 실행 중이거나 기다리고 있을 때 thread_tick()이
+ * 부릅니다. 실행 중인 스레드가 예산을 다 썼거나 선점되어야 하면 true를
+ * 반환합니다. 예산을 다 쓴 스레드는 thread_yield()에서 멈춥니다. */
+static bool dl_preempt_tick(struct thread *curr) {
+    if (is_deadline(curr)) {
+        dl_update_curr(curr);
+        if (curr->dl.budget <= 0) return true;
+    }
+    return dl_preempts(&ready_queue, curr);
+}
+
+/* 스레드 문맥에서 deadline 스레드가 깨어나거나 생겼을 때 CURR가 양보해야
+ * 하면 true를 반환합니다. */
+static bool dl_wakeup_preempt(struct thread *curr) {
+    enum intr_level old_level = intr_disable();
+    bool preempt;
+
+    if (is_deadline(curr)) dl_update_curr(curr);
+    preempt = dl_preempts(&ready_queue, curr);
+    intr_set_level(old_level);
+    return preempt;
+}
+
+/* 깨어나는 deadline 스레드 T의 예산과 마감 시각을 정합니다(CBS 규칙).
+ * 남은 예산을 마감 시각까지 다 써도 RUNTIME / DEADLINE 비율을 넘지 않으면
+ * 그대로 두고, 넘으면 지금부터 새 주기를 시작합니다. 그러지 않으면 오래
+ * 잠들었던 스레드가 묵은 예산으로 다른 deadline 스레드의 몫을 빼앗을 수
+ * 있습니다. */
+static void dl_wakeup(struct thread *t) {
+    struct sched_deadline *dl = &t->dl;
+    int64_t now = timer_now_ns();
+
+    if (dl->abs_deadline <= now ||
+        (__int128)dl->budget * dl->deadline >
+            (__int128)(dl->abs_deadline - now) * dl->runtime) {
+        dl->abs_deadline = now + dl->deadline;
+        dl->budget = dl->runtime;
+        dl->missed = false;
+    }
+
+    /* 예산을 넘겨 쓴 채로 잠들었다면 마감 시각을 미뤄 갚게 합니다. */
+    while (dl->budget <= 0) {
+        dl->abs_deadline += dl->period;
+        dl->budget += dl->runtime;
+        dl->missed = false;
+    }
 }
 
-struct list_elem *get_list_head() { return &ready_list.head; }
+/* 예산을 다 쓴 실행 중인 deadline 스레드 T를 다음 주기가 시작될 때까지
+ * 멈추도록 dl.timer를 겁니다. 호출자가 T를 차단 상태로 내려야 합니다. */
+static void dl_throttle(struct thread *t) {
+    struct sched_deadline *dl = &t->dl;
+    int64_t next_period = dl->abs_deadline - dl->deadline + dl->period;
+    int64_t wait = next_period - timer_now_ns();
+    int64_t ticks = wait <= 0 ? 1 : (wait + TICK_NS - 1) / TICK_NS;
+
+    dl->throttled = true;
+    dl_throttles++;
+    timer_arm(&dl->timer, timer_ticks() + ticks);
+}
+
+/* 멈춘 deadline 스레드의 다음 주기가 되면 타이머 인터럽트에서 호출됩니다.
+ * 예산을 채우고 마감 시각을 한 주기 미룬 뒤 깨웁니다. */
+static void dl_timer_expired(void *t_) {
+    struct thread *t = t_;
+    struct sched_deadline *dl = &t->dl;
+    int64_t now = timer_now_ns();
+
+    do {
+        dl->abs_deadline += dl->period;
+        dl->budget += dl->runtime;
+    } while (dl->budget <= 0);
+    if (dl->abs_deadline < now) dl->abs_deadline = now + dl->deadline;
+    dl->missed = false;
+    thread_unblock(t);
+    dl->throttled = false;
+}
 
 /* iretq를 사용하여 스레드를 시작합니다. */
 void do_iret(struct intr_frame *tf) {
@@ -633,7 +1363,10 @@ void do_iret(struct intr_frame *tf) {
    새 스레드가 이미 실행 중이며, 인터럽트는 여전히 비활성화된 상태입니다.
 
    스레드 전환이 완료될 때까지 printf()를 호출하는 것은 안전하지 않습니다.
-   실제로 이는 printf()를 함수의 끝에 추가해야 함을 의미합니다. */
+   실제로 이는 printf()를 함수의 끝에 추가해야 함을 의미합니다.
+
+   "-iret-switch" 옵션을 줬을 때만 쓰입니다. 평소에는 switch_threads()를
+   씁니다. */
 static void thread_launch(struct thread *th) {
     uint64_t tf_cur = (uint64_t)&running_thread()->tf;
     uint64_t tf = (uint64_t)&th->tf;
@@ -702,15 +1435,40 @@ static void do_schedule(int status) {
     while (!list_empty(&destruction_req)) {
         struct thread *victim =
             list_entry(list_pop_front(&destruction_req), struct thread, elem);
-        palloc_free_page(victim);
+        pcache_put(&thread_page_cache, victim);
     }
     thread_current()->status = status;
     schedule();
 }
 
+/* CURR에서 NEXT로 전환하는 시점의 통계를 남깁니다. CURR는 지금까지 실행
+ * 중이었고, NEXT는 지금까지 실행 대기 상태였습니다. */
+static void account_switch(struct thread *curr, struct thread *next) {
+    uint64_t now = rdtsc();
+
+    curr->stats.run += now - curr->stats.since;
+    curr->stats.since = now;
+    if (curr->status == THREAD_READY)
+        curr->stats.involuntary++;
+    else
+        curr->stats.voluntary++;
+
+    next->stats.ready += now - next->stats.since;
+    if (next->stats.woken) {
+        record_wake_latency(timer_cycles_to_ns(now - next->stats.since));
+        next->stats.woken = false;
+    }
+    next->stats.since = now;
+}
+
 static void schedule(void) {
     struct thread *curr = running_thread();
-    struct thread *next = next_thread_to_run();
+    struct thread *next;
+
+    /* 내려가는 스레드가 실행한 시간을 vruntime이나 EDF 예산에 반영합니다.
+     * 양보하는 스레드는 rq_push()가 이미 반영했습니다. */
+    if (curr->status != THREAD_READY) update_curr(curr);
+    next = next_thread_to_run();
 
     ASSERT(intr_get_level() == INTR_OFF);
     ASSERT(curr->status != THREAD_RUNNING);
@@ -719,7 +1477,20 @@ static void schedule(void) {
     next->status = THREAD_RUNNING;
 
     /* 새 타임 슬라이스를 시작합니다. */
-    thread_ticks = 0;
+    next->cpu = curr->cpu;
+    next->cpu->curr = next;
+    next->cpu->thread_ticks = 0;
+    next->exec_start = rdtsc();
+
+    /* FPU 레지스터는 필요해질 때(#NM) 옮깁니다. */
+    fpu_switch(next);
+
+    /* tickless 모드에서 유휴 상태를 벗어날 때는 PIT가 훨씬 뒤로 맞춰져 있을 수
+     * 있으므로, 새 스레드의 타임 슬라이스가 끝나기 전에 인터럽트가 오게 합니다. */
+    if (timer_tickless && is_idle(curr) && !is_idle(next))
+        timer_kick(timer_ticks() +
+                   (thread_mlfqs || thread_cfs || is_deadline(next) ? 1
+                                                                    : TIME_SLICE));
 
 #ifdef USERPROG
     /* 새 주소 공간을 활성화합니다. */
@@ -736,9 +1507,16 @@ static void schedule(void) {
             ASSERT(curr != next);
             list_push_back(&destruction_req, &curr->elem);
         }
-
-        /* 스레드를 전환하기 전에, 현재 실행 중인 정보를 먼저 저장합니다. */
-        thread_launch(next);
+        trace_event(TRACE_SWITCH, curr, next);
+        account_switch(curr, next);
+
+        /* 스레드를 전환합니다. schedule()은 항상 커널 코드에서 불리므로
+         * callee-saved 레지스터와 스택 포인터만 저장하면 충분합니다.
+         * 사용자 모드의 레지스터는 이미 커널 스택 위의 intr_frame에 있습니다. */
+        if (thread_iret_switch)
+            thread_launch(next);
+        else
+            switch_threads(&curr->ksp, next->ksp);
     }
 }
 
@@ -754,17 +1532,39 @@ static tid_t allocate_tid(void) {
     return tid;
 }
 
-/* ready_list를 thread 구조체*/
+/* 실행 대기 큐를 우선순위가 높은 순서대로(CFS에서는 vruntime이 작은
+ * 순서대로) 출력합니다. */
 void print_ready_list(void) {
+    struct run_queue *rq = &ready_queue;
+    int pri;
+
     printf("Ready list is ");
-    if (!list_empty(&ready_list)) {
+    if (!rb_empty(&rq->dl)) {
+        struct rb_elem *e;
+
+        for (e = rb_min(&rq->dl); e != NULL; e = rb_next(e)) {
+            struct thread *t = rb_entry(e, struct thread, rb_elem);
+            printf("Thread name: %s,  deadline: %lld   ", t->name,
+                   (long long)t->dl.abs_deadline);
+        }
+    }
+    if (thread_cfs) {
+        struct rb_elem *e;
+
+        for (e = rb_min(&rq->cfs); e != NULL; e = rb_next(e)) {
+            struct thread *t = rb_entry(e, struct thread, rb_elem);
+            printf("Thread name: %s,  vruntime: %lld   ", t->name,
+                   (long long)t->vruntime);
+        }
+        printf("\n");
+        return;
+    }
+    for (pri = PRI_MAX; pri >= PRI_MIN; pri--) {
+        struct list *q = &rq->queues[pri];
         struct list_elem *e;
 
-        for (e = list_begin(&ready_list); e != list_end(&ready_list);
-             e = list_next(e)) {
-            if (e == list_tail(&ready_list)) {
-                break;  // 리스트의 끝에 도달하면 반복문 종료
-            }
+        if (!(rq->bitmap & (1ULL << pri))) continue;
+        for (e = list_begin(q); e != list_end(q); e = list_next(e)) {
             struct thread *t = list_entry(e, struct thread, elem);
             printf("Thread name: %s,  status: %d   ", t->name, t->status);
         }
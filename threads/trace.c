@@ -0,0 +1,95 @@
+#include "threads/trace.h"
+
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "devices/timer.h"
+#include "intrinsic.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+
+/* Number of events the ring holds.  Must be a power of 2.  Once
+   it is full, new events overwrite the oldest ones. */
+#define TRACE_RING_SIZE 4096
+
+/* One recorded event. */
+struct trace_entry {
+	uint64_t tsc;               /* Time-stamp counter. */
+	int32_t tid_a;              /* Thread the event is about. */
+	int32_t tid_b;              /* Other party, or -1 if none. */
+	uint8_t type;               /* enum trace_type. */
+	uint8_t cpu;                /* CPU that recorded the event. */
+	uint8_t priority_a;         /* Priority of A. */
+	uint8_t priority_b;         /* Priority of B, 0 if none. */
+};
+
+/* True while events are being recorded.  -trace sets it. */
+bool trace_enabled;
+
+static struct trace_entry ring[TRACE_RING_SIZE];
+static uint64_t recorded;       /* Events ever recorded. */
+
+static const char *type_names[TRACE_TYPE_CNT] = {
+	"switch", "wake", "block", "donate", "sleep", "exit",
+};
+
+/* Turns tracing on or off.  Events already in the ring are kept. */
+void
+trace_set_enabled (bool enabled) {
+	trace_enabled = enabled;
+}
+
+/* Appends an event of TYPE about A, with B as the other party, to
+   the ring.  Call trace_event() instead, which skips the call when
+   tracing is off.  Safe in any context, including interrupt
+   handlers and the scheduler. */
+void
+trace_record (enum trace_type type, const struct thread *a,
+		const struct thread *b) {
+	enum intr_level old_level;
+	struct trace_entry *e;
+
+	ASSERT (type < TRACE_TYPE_CNT);
+	ASSERT (a != NULL);
+
+	old_level = intr_disable ();
+	e = &ring[recorded++ & (TRACE_RING_SIZE - 1)];
+	e->tsc = rdtsc ();
+	e->type = type;
+	e->cpu = this_cpu ()->id;
+	e->tid_a = a->tid;
+	e->priority_a = a->priority;
+	e->tid_b = b != NULL ? b->tid : -1;
+	e->priority_b = b != NULL ? b->priority : 0;
+	intr_set_level (old_level);
+}
+
+/* Prints the events in the ring, oldest first, one per line.
+   Recording pauses while printing so that the console's own
+   locking does not show up in the dump.  Prints nothing if no
+   event was ever recorded. */
+void
+trace_dump (void) {
+	bool was_enabled = trace_enabled;
+	uint64_t first, i;
+
+	if (recorded == 0)
+		return;
+	trace_set_enabled (false);
+
+	first = recorded > TRACE_RING_SIZE ? recorded - TRACE_RING_SIZE : 0;
+
+	printf ("trace: begin hz=%llu events=%llu dropped=%llu\n",
+			timer_tsc_hz (), recorded - first, first);
+	for (i = first; i < recorded; i++) {
+		const struct trace_entry *e = &ring[i & (TRACE_RING_SIZE - 1)];
+
+		printf ("trace: %llu %u %s %d %u %d %u\n",
+				e->tsc, e->cpu, type_names[e->type],
+				e->tid_a, e->priority_a, e->tid_b, e->priority_b);
+	}
+	printf ("trace: end\n");
+
+	trace_set_enabled (was_enabled);
+}
@@ -0,0 +1,247 @@
+#include "threads/workqueue.h"
+
+#include <debug.h>
+#include <stdio.h>
+
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* Batch size and worker count of system_wq. */
+#define SYSTEM_WQ_BATCH 8
+#define SYSTEM_WQ_WORKERS 2
+
+struct workqueue system_wq;
+
+/* All queues, for statistics. */
+static struct list queues;
+static bool queues_initialized;
+
+/* A thread waiting on a queue's IDLE or FLUSHERS list.  Lives on
+   the waiting thread's stack. */
+struct waiter {
+	struct list_elem elem;
+	struct thread *thread;
+};
+
+static thread_func worker_loop;
+
+/* Initializes WQ, named NAME, whose workers will run at PRIORITY
+   and take up to BATCH items per wake-up.  Work may be queued
+   right away, even before the scheduler runs; it waits until
+   workqueue_start() gives the queue its threads. */
+void
+workqueue_init (struct workqueue *wq, const char *name, int priority,
+				size_t batch) {
+	ASSERT (wq != NULL);
+	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+	ASSERT (batch >= 1 && batch <= WQ_BATCH_MAX);
+
+	if (!queues_initialized) {
+		list_init (&queues);
+		queues_initialized = true;
+	}
+	wq->name = name;
+	wq->priority = priority;
+	wq->batch = batch;
+	list_init (&wq->pending);
+	list_init (&wq->idle);
+	list_init (&wq->flushers);
+	wq->workers = 0;
+	wq->in_flight = 0;
+	wq->queued = wq->batches = 0;
+	list_push_back (&queues, &wq->elem);
+}
+
+/* Starts WORKERS more worker threads for WQ.  The scheduler must
+   be running. */
+void
+workqueue_start (struct workqueue *wq, int workers) {
+	ASSERT (wq != NULL);
+	ASSERT (workers > 0);
+
+	for (; workers > 0; workers--) {
+		if (thread_create (wq->name, wq->priority, worker_loop, wq) == TID_ERROR)
+			PANIC ("cannot start %s worker", wq->name);
+		wq->workers++;
+	}
+}
+
+/* Starts system_wq.  Called by thread_start() once the scheduler
+   is running. */
+void
+workqueue_start_system (void) {
+	workqueue_init (&system_wq, "events", PRI_DEFAULT, SYSTEM_WQ_BATCH);
+	workqueue_start (&system_wq, SYSTEM_WQ_WORKERS);
+}
+
+/* Initializes work item W to run FUNC(AUX) each time it is
+   queued. */
+void
+work_init (struct work *w, work_func *func, void *aux) {
+	ASSERT (w != NULL);
+	ASSERT (func != NULL);
+
+	w->func = func;
+	w->aux = aux;
+	w->wq = NULL;
+	w->pending = false;
+}
+
+/* Queues W on WQ.  Returns true if W was queued, false if it was
+   already pending, in which case it will still run once.
+
+   May be called from an interrupt handler or with interrupts off.
+   If that wakes a worker that outranks the running thread, the
+   running thread yields: at once in thread context with
+   interrupts on, on return from an interrupt handler, and not at
+   all otherwise. */
+bool
+work_queue (struct workqueue *wq, struct work *w) {
+	enum intr_level old_level;
+	bool woke = false;
+
+	ASSERT (wq != NULL);
+	ASSERT (w != NULL && w->func != NULL);
+
+	old_level = intr_disable ();
+	if (w->pending) {
+		ASSERT (w->wq == wq);
+		intr_set_level (old_level);
+		return false;
+	}
+
+	w->pending = true;
+	w->wq = wq;
+	list_push_back (&wq->pending, &w->elem);
+	wq->in_flight++;
+	wq->queued++;
+	if (!list_empty (&wq->idle)) {
+		struct waiter *worker = list_entry (list_pop_front (&wq->idle),
+											struct waiter, elem);
+		thread_unblock (worker->thread);
+		woke = true;
+	}
+
+	if (woke && wq->priority > thread_get_priority ()) {
+		if (intr_context ())
+			intr_yield_on_return ();
+		else if (old_level == INTR_ON)
+			thread_yield ();
+	}
+	intr_set_level (old_level);
+	return true;
+}
+
+/* Removes W from its queue if it has not been taken by a worker
+   yet.  Returns true if W was pending and now will not run, false
+   otherwise.  A run already under way is not waited for. */
+bool
+work_cancel (struct work *w) {
+	enum intr_level old_level;
+	bool was_pending;
+
+	ASSERT (w != NULL);
+
+	old_level = intr_disable ();
+	was_pending = w->pending;
+	if (was_pending) {
+		struct workqueue *wq = w->wq;
+
+		list_remove (&w->elem);
+		w->pending = false;
+		if (--wq->in_flight == 0)
+			while (!list_empty (&wq->flushers))
+				thread_unblock (list_entry (list_pop_front (&wq->flushers),
+											struct waiter, elem)->thread);
+	}
+	intr_set_level (old_level);
+
+	return was_pending;
+}
+
+/* Waits until WQ has no work pending or running.  Work queued
+   meanwhile is waited for too, so this need not return while
+   someone keeps WQ busy.  Must not be called by one of WQ's own
+   workers. */
+void
+workqueue_flush (struct workqueue *wq) {
+	enum intr_level old_level;
+
+	ASSERT (!intr_context ());
+
+	old_level = intr_disable ();
+	if (wq->in_flight > 0) {
+		struct waiter self;
+
+		self.thread = thread_current ();
+		list_push_back (&wq->flushers, &self.elem);
+		thread_block ();
+	}
+	intr_set_level (old_level);
+}
+
+/* A worker thread of the queue AUX.  Takes up to a batch of
+   items at once, runs them with interrupts on, and blocks when
+   the queue is empty. */
+static void
+worker_loop (void *wq_) {
+	struct workqueue *wq = wq_;
+	struct waiter self;
+	enum intr_level old_level;
+
+	self.thread = thread_current ();
+	old_level = intr_disable ();
+	for (;;) {
+		work_func *funcs[WQ_BATCH_MAX];
+		void *auxes[WQ_BATCH_MAX];
+		size_t cnt = 0, i;
+
+		while (list_empty (&wq->pending)) {
+			list_push_back (&wq->idle, &self.elem);
+			thread_block ();
+		}
+
+		/* Copy out FUNC and AUX: once W is off the pending list,
+		   its owner may queue it again or free it. */
+		while (cnt < wq->batch && !list_empty (&wq->pending)) {
+			struct work *w = list_entry (list_pop_front (&wq->pending),
+					struct work, elem);
+			w->pending = false;
+			funcs[cnt] = w->func;
+			auxes[cnt] = w->aux;
+			cnt++;
+		}
+		wq->batches++;
+		intr_set_level (old_level);
+
+		for (i = 0; i < cnt; i++)
+			funcs[i] (auxes[i]);
+
+		old_level = intr_disable ();
+		wq->in_flight -= cnt;
+		if (wq->in_flight == 0)
+			while (!list_empty (&wq->flushers))
+				thread_unblock (list_entry (list_pop_front (&wq->flushers),
+											struct waiter, elem)->thread);
+
+		/* More work is waiting: let equal-priority threads run
+		   between batches. */
+		if (!list_empty (&wq->pending))
+			thread_yield ();
+	}
+}
+
+/* Prints workqueue statistics. */
+void
+workqueue_print_stats (void) {
+	struct list_elem *e;
+
+	if (!queues_initialized)
+		return;
+	for (e = list_begin (&queues); e != list_end (&queues); e = list_next (e)) {
+		struct workqueue *wq = list_entry (e, struct workqueue, elem);
+
+		printf ("Workqueue %s: %lld queued, %lld batches, %d workers\n",
+				wq->name, wq->queued, wq->batches, wq->workers);
+	}
+}
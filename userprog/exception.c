@@ -46,8 +46,6 @@ void exception_init(void) {
     intr_register_int(0, 0, INTR_ON, kill, "#DE Divide Error");
     intr_register_int(1, 0, INTR_ON, kill, "#DB Debug Exception");
     intr_register_int(6, 0, INTR_ON, kill, "#UD Invalid Opcode Exception");
-    intr_register_int(7, 0, INTR_ON, kill,
-                      "#NM Device Not Available Exception");
     intr_register_int(11, 0, INTR_ON, kill, "#NP Segment Not Present");
     intr_register_int(12, 0, INTR_ON, kill, "#SS Stack Fault Exception");
     intr_register_int(13, 0, INTR_ON, kill, "#GP General Protection Exception");
@@ -55,6 +53,8 @@ void exception_init(void) {
     intr_register_int(19, 0, INTR_ON, kill,
                       "#XF SIMD Floating-Point Exception");
 
+    /* #NM is not fatal: threads/fpu.c uses it for lazy FPU switching. */
+
     /* Most exceptions can be handled with interrupts turned on.
        We need to disable interrupts for page faults because the
        fault address is stored in CR2 and needs to be preserved. */
@@ -0,0 +1,118 @@
+#include "userprog/futex.h"
+
+#include <debug.h>
+#include <list.h>
+
+#include "threads/synch.h"
+#include "userprog/process.h"
+
+/* 유저 주소를 키로 하는 대기/깨우기. 유저 뮤텍스는 경쟁이 없을 때는 원자적
+ * 연산만으로 잠그고 풀며, 경쟁이 있을 때만 이 시스템 콜로 잠들고 깨웁니다.
+ *
+ * 대기자는 (프로세스, 주소) 해시로 고른 버킷에 들어갑니다. futex_wait()은
+ * 버킷 락을 잡은 채 값을 확인하고 대기열에 들어가므로, 값을 바꾼 뒤
+ * futex_wake()를 부르는 쪽과 엇갈려 깨우기를 놓치는 일이 없습니다. */
+#define FUTEX_BUCKETS 64
+
+struct futex_bucket {
+    struct lock lock;     /* Protects WAITERS. */
+    struct list waiters;  /* struct futex_waiter. */
+};
+
+/* futex_wait() 중인 스레드. 그 스레드의 스택에 있습니다. */
+struct futex_waiter {
+    struct list_elem elem;   /* Element in the bucket's WAITERS. */
+    struct thread *leader;   /* Process the address belongs to. */
+    const int *uaddr;        /* User address waited on. */
+    struct semaphore sema;   /* Upped by futex_wake(). */
+};
+
+static struct futex_bucket buckets[FUTEX_BUCKETS];
+
+/* 부팅 중 한 번 호출됩니다. */
+void futex_init(void) {
+    for (int i = 0; i < FUTEX_BUCKETS; i++) {
+        lock_init(&buckets[i].lock);
+        list_init(&buckets[i].waiters);
+    }
+}
+
+/* LEADER 프로세스의 UADDR이 들어갈 버킷을 반환합니다. */
+static struct futex_bucket *bucket_of(struct thread *leader,
+                                      const int *uaddr) {
+    uintptr_t key = ((uintptr_t)uaddr >> 2) ^ ((uintptr_t)leader >> 12);
+
+    return &buckets[key % FUTEX_BUCKETS];
+}
+
+/* *UADDR이 EXPECTED인 동안 futex_wake()가 깨울 때까지 잠듭니다. 깨워지면
+ * 0을, 값이 이미 달라져 있었거나 프로세스가 끝나는 중이면 잠들지 않고 -1을
+ * 반환합니다. */
+int futex_wait(const int *uaddr, int expected) {
+    struct thread *leader = process_current();
+    struct futex_bucket *b = bucket_of(leader, uaddr);
+    struct futex_waiter w;
+    volatile const int *p = uaddr;
+
+    /* 잘못된 주소라면 락을 잡기 전에 여기서 페이지 폴트로 죽도록, 먼저 한 번
+     * 읽어 둡니다. */
+    (void)*p;
+
+    lock_acquire(&b->lock);
+    if (leader->killed || *p != expected) {
+        lock_release(&b->lock);
+        return -1;
+    }
+    w.leader = leader;
+    w.uaddr = uaddr;
+    sema_init(&w.sema, 0);
+    list_push_back(&b->waiters, &w.elem);
+    lock_release(&b->lock);
+
+    sema_down(&w.sema);
+    return 0;
+}
+
+/* UADDR에서 기다리는 스레드를 먼저 잠든 순서로 CNT개까지 깨우고, 깨운 수를
+ * 반환합니다. */
+int futex_wake(const int *uaddr, int cnt) {
+    struct thread *leader = process_current();
+    struct futex_bucket *b = bucket_of(leader, uaddr);
+    struct list_elem *e;
+    int woken = 0;
+
+    lock_acquire(&b->lock);
+    for (e = list_begin(&b->waiters); e != list_end(&b->waiters) && woken < cnt;) {
+        struct futex_waiter *w = list_entry(e, struct futex_waiter, elem);
+
+        if (w->leader == leader && w->uaddr == uaddr) {
+            e = list_remove(e);
+            sema_up(&w->sema);
+            woken++;
+        } else
+            e = list_next(e);
+    }
+    lock_release(&b->lock);
+    return woken;
+}
+
+/* LEADER 프로세스의 모든 대기자를 깨웁니다. 프로세스가 끝날 때, 잠든
+ * 스레드들이 사용자 모드로 돌아가는 길에 죽을 수 있게 합니다. */
+void futex_wake_process(struct thread *leader) {
+    for (int i = 0; i < FUTEX_BUCKETS; i++) {
+        struct futex_bucket *b = &buckets[i];
+        struct list_elem *e;
+
+        lock_acquire(&b->lock);
+        for (e = list_begin(&b->waiters); e != list_end(&b->waiters);) {
+            struct futex_waiter *w = list_entry(e, struct futex_waiter, elem);
+
+            if (w->leader == leader) {
+                e = list_remove(e);
+                sema_up(&w->sema);
+            } else
+                e = list_next(e);
+        }
+        lock_release(&b->lock);
+    }
+}
@@ -12,12 +12,17 @@
 #include "filesys/filesys.h"
 #include "intrinsic.h"
 #include "threads/flags.h"
+#include "threads/fpu.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
+#include "threads/pcache.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "userprog/futex.h"
 #include "userprog/gdt.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
@@ -25,11 +30,70 @@
 #include "vm/vm.h"
 #endif
 
+/* 파일 디스크립터 테이블 페이지 캐시. 테이블은 사용자 프로세스만 가집니다. */
+static struct pcache fd_table_cache;
+#define FD_TABLE_CACHE_LOW 4
+#define FD_TABLE_CACHE_HIGH 16
+
+#ifdef VM
+/* 지연 로딩 정보 객체 캐시. 실행 파일의 페이지마다 하나씩 쓰입니다. */
+static struct kmem_cache lazy_load_cache;
+static void lazy_load_cache_init(void);
+#endif
+
+/* 사용자 스레드의 FS 베이스 MSR. 스레드 지역 저장소를 가리킵니다. */
+#define MSR_FS_BASE 0xc0000100
+
+/* process_clone()으로 만든 스레드 하나. 리더의 uthreads 리스트에 들어 있다가
+ * process_thread_join()이, 또는 조인되지 않았다면 리더가 끝날 때 해제합니다.
+ * 스레드 구조체는 스레드가 끝나면 사라지므로 종료 상태는 여기에 남깁니다. */
+struct uthread {
+    tid_t tid;              /* Thread identifier. */
+    struct thread *leader;  /* Process the thread belongs to. */
+    uint64_t entry;         /* User entry point. */
+    uint64_t arg;           /* Passed to ENTRY in rdi. */
+    uint64_t stack;         /* Initial user rsp. */
+    uint64_t tls;           /* Initial FS base. */
+    int status;             /* Exit status, once EXITED. */
+    bool exited;            /* Has the thread exited? */
+    bool joining;           /* Claimed by a process_thread_join()? */
+    struct semaphore done;  /* Upped when the thread exits. */
+    struct list_elem elem;  /* Element in the leader's uthreads. */
+};
+
 static void process_cleanup(void);
 static bool load(const char *file_name, struct intr_frame *if_);
 static void initd(void *f_name);
 static void __do_fork(void *);
+static void start_uthread(void *);
 void argument_stack(char **parse, int count, void **rsp);
+/* fd_table 캐시와 지연 로딩 정보 캐시를 초기화합니다.
+ * 부팅 중 한 번 호출됩니다. */
+void process_cache_init(void) {
+    pcache_init(&fd_table_cache, "fd_table", 0, FD_TABLE_CACHE_LOW,
+                FD_TABLE_CACHE_HIGH);
+#ifdef VM
+    lazy_load_cache_init();
+#endif
+}
+
+/* T에게 빈 파일 디스크립터 테이블을 줍니다. 0과 1은 표준 입출력 자리입니다.
+ * 메모리가 부족하면 false를 반환합니다. */
+static bool process_alloc_fd_table(struct thread *t) {
+    t->fd_table = pcache_get(&fd_table_cache);
+    t->next_fd_idx = 2;
+    return t->fd_table != NULL;
+}
+
+/* T가 속한 프로세스, 즉 T가 쓰는 주소 공간과 fd 테이블, SPT를 가진 첫
+ * 스레드를 반환합니다. 커널 스레드는 자기 자신입니다. */
+static struct thread *process_of(struct thread *t) {
+    return t->leader != NULL ? t->leader : t;
+}
+
+/* 실행 중인 스레드가 속한 프로세스를 반환합니다. */
+struct thread *process_current(void) { return process_of(thread_current()); }
+
 /* 일반 프로세스 초기화기(initd 및 기타 프로세스를 위한). */
 static void process_init(void) { struct thread *current = thread_current(); }
 
@@ -63,11 +127,14 @@ tid_t process_create_initd(const char *file_name) {
 /* 첫 번째 사용자 프로세스를 실행하는 스레드 함수. */
 static void initd(void *f_name) {
 #ifdef VM
-    supplemental_page_table_init(&thread_current()->spt);
+    supplemental_page_table_init(&process_current()->spt);
 #endif
 
     process_init();
 
+    thread_current()->leader = thread_current();
+    if (!process_alloc_fd_table(thread_current()))
+        PANIC("Fail to launch initd\n");
     if (process_exec(f_name) < 0) PANIC("Fail to launch initd\n");
     NOT_REACHED();
 }
@@ -117,7 +184,7 @@ static bool duplicate_pte(uint64_t *pte, void *va, void *aux) {
 
     /* 3. TODO: 자식을 위한 새 PAL_USER 페이지를 할당하고
      *    TODO: 결과를 NEWPAGE로 설정합니다. */
-    newpage = palloc_get_page(PAL_USER | PAL_ZERO);
+    newpage = palloc_get_page(PAL_USER);
     if (newpage == NULL) {
         return false;
     }
@@ -125,7 +192,7 @@ static bool duplicate_pte(uint64_t *pte, void *va, void *aux) {
     /* 4. TODO: 부모의 페이지를 새 페이지로 복제하고
      *    TODO: 부모 페이지가 쓰기 가능한지 확인하고 (WRITABLE에 결과를 설정) */
 
-    memcpy(newpage, parent_page, PGSIZE);
+    copy_page(newpage, parent_page);
     pte = pml4e_walk(parent->pml4, va, 0);
     writable = is_writable(pte);
     /* 5. 주소 VA에 WRITABLE 권한으로 자식의 페이지 테이블에 새 페이지를
@@ -144,7 +211,8 @@ static bool duplicate_pte(uint64_t *pte, void *va, void *aux) {
 static void __do_fork(void *aux) {
     struct intr_frame *parent_if = (struct intr_frame *)aux;
     struct intr_frame if_;
-    struct thread *parent = thread_current()->parent;
+    struct thread *forker = thread_current()->parent;
+    struct thread *parent = process_of(forker);
     struct thread *current = thread_current();
 
     /* TODO: somehow pass the parent_if. (i.e. process_fork()'s if_) */
@@ -154,6 +222,10 @@ static void __do_fork(void *aux) {
     /* 1. CPU 컨텍스트를 로컬 스택에 읽습니다. */
     memcpy(&if_, parent_if, sizeof(struct intr_frame));
     if_.R.rax = 0;
+    fpu_copy(current, forker);
+    current->leader = current;
+    current->fs_base = forker->fs_base;
+    if (!process_alloc_fd_table(current)) goto error;
     /* 2. PT 복제 */
     current->pml4 = pml4_create();
     if (current->pml4 == NULL) goto error;
@@ -215,6 +287,14 @@ int process_exec(void *f_name) {
     _if.cs = SEL_UCSEG;
     _if.eflags = FLAG_IF | FLAG_MBS;
 
+    /* 주소 공간을 함께 쓰는 다른 스레드가 있을 수 있으므로, 첫 스레드만
+     * 주소 공간을 갈아치울 수 있습니다. */
+    if (process_current() != thread_current() ||
+        thread_current()->live_uthreads > 0) {
+        palloc_free_page(safe_name);
+        return -1;
+    }
+
     /* 우리는 먼저 현재 컨텍스트를 종료합니다. */
     process_cleanup();
 
@@ -322,16 +402,64 @@ void process_close_file(int fd) {
     cur_fdt[fd] = NULL;
 }
 
+/* process_clone()으로 만든 스레드가 끝날 때 process_exit()에서 불립니다.
+ * 주소 공간과 fd 테이블은 리더의 것이므로 건드리지 않고, 종료 상태만
+ * 남깁니다. */
+static void uthread_exit(void) {
+    struct thread *curr = thread_current();
+    struct thread *leader = curr->leader;
+    struct uthread *ut = curr->uthread;
+    enum intr_level old_level;
+
+    /* 전환 중에 남의 페이지 테이블을 다시 활성화하지 않도록 합니다. */
+    curr->pml4 = NULL;
+    pml4_activate(NULL);
+
+    old_level = intr_disable();
+    ut->status = curr->exit_status;
+    ut->exited = true;
+    sema_up(&ut->done);
+    if (--leader->live_uthreads == 0 && leader->killed)
+        sema_up(&leader->uthreads_done);
+    intr_set_level(old_level);
+}
+
+/* 프로세스의 다른 스레드를 모두 끝내고 그 구조체를 해제합니다. 리더가
+ * 끝날 때 process_exit()에서 불립니다. 사용자 모드를 돌던 스레드는 다음
+ * 인터럽트에서, 잠든 스레드는 깨어나 시스템 콜에서 돌아가는 길에 죽습니다. */
+static void kill_uthreads(struct thread *leader) {
+    enum intr_level old_level;
+
+    leader->killed = true;
+    if (leader->live_uthreads > 0) futex_wake_process(leader);
+
+    old_level = intr_disable();
+    while (leader->live_uthreads > 0) sema_down(&leader->uthreads_done);
+    intr_set_level(old_level);
+
+    while (!list_empty(&leader->uthreads))
+        free(list_entry(list_pop_front(&leader->uthreads), struct uthread, elem));
+}
+
 /* 프로세스를 종료합니다. 이 함수는 thread_exit()에 의해 호출됩니다. */
 void process_exit(void) {
     struct thread *curr = thread_current();
+
+    if (curr->leader != NULL && curr->leader != curr) {
+        uthread_exit();
+        return;
+    }
+    if (curr->leader == curr) kill_uthreads(curr);
     /* TODO: 여기에 코드가 들어갑니다.
      * TODO: 프로세스 종료 메시지 구현 (project2/process_termination.html 참조).
      * TODO: 프로세스 리소스 정리를 여기에서 구현하는 것이 좋습니다. */
-    for (int i = 2; i < 128; i++) {
-        process_close_file(i);
+    if (curr->fd_table != NULL) {
+        for (int i = 2; i < 128; i++) {
+            process_close_file(i);
+        }
+        pcache_put(&fd_table_cache, curr->fd_table);
+        curr->fd_table = NULL;
     }
-    palloc_free_page(curr->fd_table);
     file_close(curr->exec_file);
     process_cleanup();
     sema_up(&curr->wait_sema);
@@ -352,6 +480,131 @@ struct thread *get_child_process(int pid) {
     return NULL;
 }
 
+/* 실행 중인 스레드의 프로세스가 끝나는 중이면 스레드를 끝냅니다. 사용자
+ * 모드로 돌아가기 직전에 불립니다. */
+void process_exit_if_killed(void) {
+    if (process_current()->killed) {
+        intr_enable();
+        thread_exit();
+    }
+}
+
+/* 현재 프로세스에 새 스레드를 만듭니다. 새 스레드는 주소 공간, fd 테이블,
+ * SPT를 함께 쓰고, 사용자 스택 STACK과 FS 베이스 TLS를 가지고 ENTRY(ARG)
+ * 에서 사용자 모드로 시작합니다. 새 스레드의 tid를, 만들 수 없으면
+ * TID_ERROR를 반환합니다. */
+tid_t process_clone(uint64_t entry, uint64_t arg, uint64_t stack,
+                    uint64_t tls) {
+    struct thread *leader = process_current();
+    struct uthread *ut = malloc(sizeof *ut);
+    enum intr_level old_level;
+    tid_t tid;
+
+    if (ut == NULL) return TID_ERROR;
+    ut->leader = leader;
+    ut->entry = entry;
+    ut->arg = arg;
+    ut->stack = stack;
+    ut->tls = tls;
+    ut->status = -1;
+    ut->exited = ut->joining = false;
+    sema_init(&ut->done, 0);
+
+    /* 새 스레드가 곧바로 실행되어 끝나도 기록이 리스트에 있도록, 만들기 전에
+     * 넣어 둡니다. 아직 tid가 없어 조인할 수는 없습니다. */
+    old_level = intr_disable();
+    ut->tid = TID_ERROR;
+    ut->joining = true;
+    list_push_back(&leader->uthreads, &ut->elem);
+    leader->live_uthreads++;
+    intr_set_level(old_level);
+
+    tid = thread_create(leader->name, thread_get_priority(), start_uthread, ut);
+
+    old_level = intr_disable();
+    if (tid == TID_ERROR) {
+        list_remove(&ut->elem);
+        if (--leader->live_uthreads == 0 && leader->killed)
+            sema_up(&leader->uthreads_done);
+        free(ut);
+    } else {
+        ut->tid = tid;
+        ut->joining = false;
+    }
+    intr_set_level(old_level);
+    return tid;
+}
+
+/* process_clone()이 만든 스레드의 시작 함수. */
+static void start_uthread(void *ut_) {
+    struct uthread *ut = ut_;
+    struct thread *curr = thread_current();
+    struct intr_frame if_;
+    enum intr_level old_level;
+
+    /* 만든 스레드의 자식 리스트에서 빠집니다. 스레드는 fork()의 자식이
+     * 아니므로 wait()으로 기다릴 수 없습니다. */
+    old_level = intr_disable();
+    list_remove(&curr->child_elem);
+    intr_set_level(old_level);
+
+    curr->leader = ut->leader;
+    curr->uthread = ut;
+    curr->pml4 = ut->leader->pml4;
+    curr->fs_base = ut->tls;
+    process_activate(curr);
+    process_exit_if_killed();
+
+    memset(&if_, 0, sizeof if_);
+    if_.ds = if_.es = if_.ss = SEL_UDSEG;
+    if_.cs = SEL_UCSEG;
+    if_.eflags = FLAG_IF | FLAG_MBS;
+    if_.rip = ut->entry;
+    if_.rsp = ut->stack;
+    if_.R.rdi = ut->arg;
+    do_iret(&if_);
+    NOT_REACHED();
+}
+
+/* 현재 프로세스의 스레드 TID가 끝날 때까지 기다렸다가 그 종료 상태를
+ * 반환합니다. TID가 이 프로세스의 process_clone() 스레드가 아니거나 이미
+ * 조인되었거나 다른 스레드가 조인 중이면 -1을 반환합니다. */
+int process_thread_join(tid_t tid) {
+    struct thread *leader = process_current();
+    struct uthread *ut = NULL;
+    struct list_elem *e;
+    enum intr_level old_level;
+    int status;
+
+    old_level = intr_disable();
+    for (e = list_begin(&leader->uthreads); e != list_end(&leader->uthreads);
+         e = list_next(e)) {
+        struct uthread *u = list_entry(e, struct uthread, elem);
+        if (u->tid == tid && tid != thread_tid() && !u->joining) {
+            ut = u;
+            ut->joining = true;
+            break;
+        }
+    }
+    intr_set_level(old_level);
+    if (ut == NULL) return -1;
+
+    sema_down(&ut->done);
+
+    old_level = intr_disable();
+    list_remove(&ut->elem);
+    intr_set_level(old_level);
+    status = ut->status;
+    free(ut);
+    return status;
+}
+
+/* 실행 중인 스레드의 FS 베이스를 TLS로 바꿉니다. */
+void process_set_tls(uint64_t tls) {
+    thread_current()->fs_base = tls;
+    write_msr(MSR_FS_BASE, tls);
+}
+
 static void start_process(void *f_name) {
     process_init();
     process_exec(f_name);
@@ -388,6 +641,7 @@ static void process_cleanup(void) {
 void process_activate(struct thread *next) {
     /* 스레드의 페이지 테이블을 활성화합니다. */
     pml4_activate(next->pml4);
+    if (next->pml4 != NULL) write_msr(MSR_FS_BASE, next->fs_base);
 
     /* 인터럽트 처리에 사용될 스레드의 커널 스택을 설정합니다. */
     tss_update(next);
@@ -470,7 +724,6 @@ static bool load(const char *file_name, struct intr_frame *if_) {
     if (t->pml4 == NULL) goto done;
     process_activate(thread_current());
 
-    lock_acquire(&filesys_lock);
     /* 실행 파일 열기 */
     file = filesys_open(file_name);
     if (file == NULL) {
@@ -558,7 +811,6 @@ static bool load(const char *file_name, struct intr_frame *if_) {
     success = true;
 
 done:
-    lock_release(&filesys_lock);
     /* We arrive here whether the load is successful or not. */
     // file_close(file)
     return success;
@@ -695,6 +947,11 @@ struct lazy_load_info {
     bool writable;
 };
 
+static void lazy_load_cache_init(void) {
+    kmem_cache_init(&lazy_load_cache, "lazy_load_info",
+                    sizeof(struct lazy_load_info), NULL);
+}
+
 static bool lazy_load_segment(struct page *page, void *aux) {
     /* TODO: Load the segment from the file */
     /* TODO: This called when the first page fault occurs on address VA. */
@@ -710,7 +967,7 @@ static bool lazy_load_segment(struct page *page, void *aux) {
 
     if (file_read(file, page->frame->kva, page_read_bytes) !=
         (int)page_read_bytes) {
-        palloc_free_page(page->frame->kva);
+        // 프레임은 vm_do_claim_page()가 실패 처리하며 돌려줌.
         return false;
     }
     memset(page->frame->kva + page_read_bytes, 0, page_zero_bytes);
@@ -722,7 +979,7 @@ static bool lazy_load_segment(struct page *page, void *aux) {
     //     return false;
     // }
 
-    free(aux);
+    kmem_cache_free(&lazy_load_cache, aux);
 
     return true;
 }
@@ -760,8 +1017,8 @@ static bool load_segment(struct file *file, off_t ofs, uint8_t *upage,
         /*당신은 바이너리 파일을 로드할 때 필수적인 정보를 포함하는
         구조체를 생성하는 것이 좋습니다.*/
         void *aux = NULL;
-        struct lazy_load_info *aux_info =
-            (struct lazy_load_info *)malloc(sizeof(struct lazy_load_info));
+        struct lazy_load_info *aux_info = kmem_cache_alloc(&lazy_load_cache);
+        if (aux_info == NULL) return false;
         aux_info->file = file;
         aux_info->ofs = ofs;
         aux_info->read_bytes = page_read_bytes;
@@ -772,7 +1029,7 @@ static bool load_segment(struct file *file, off_t ofs, uint8_t *upage,
 
         if (!vm_alloc_page_with_initializer(VM_ANON, upage, writable,
                                             lazy_load_segment, aux)) {
-            free(aux_info);
+            kmem_cache_free(&lazy_load_cache, aux_info);
             return false;
         }
         /* Advance. */
@@ -800,7 +1057,7 @@ static bool setup_stack(struct intr_frame *if_) {
         }
     }
     struct page *stack_page =
-        spt_find_page(&thread_current()->spt, stack_bottom);
+        spt_find_page(&process_current()->spt, stack_bottom);
 
     if (stack_page != NULL) {
         stack_page->is_stack = true;
@@ -11,6 +11,7 @@
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "userprog/futex.h"
 #include "userprog/gdt.h"
 #include "userprog/process.h"
 #include "userprog/syscall.h"
@@ -32,7 +33,6 @@ typedef int pid_t;
 #define MSR_SYSCALL_MASK 0xc0000084 /* eflags에 대한 마스크 */
 
 void syscall_init(void) {
-    lock_init(&filesys_lock);
     write_msr(MSR_STAR,
               ((uint64_t)SEL_UCSEG - 0x10) << 48 | ((uint64_t)SEL_KCSEG) << 32);
     write_msr(MSR_LSTAR, (uint64_t)syscall_entry);
@@ -42,6 +42,8 @@ void syscall_init(void) {
      * 따라서, FLAG_FL을 마스킹했습니다. */
     write_msr(MSR_SYSCALL_MASK,
               FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
+
+    futex_init();
 }
 
 void check_address(void *addr) {
@@ -52,12 +54,36 @@ void check_address(void *addr) {
 
 void sys_halt(void) { power_off(); }
 
+/* 프로세스를 끝냅니다. 어느 스레드가 부르든 프로세스 전체가 끝나며, 종료
+ * 메시지는 처음 한 번만 출력합니다. */
 void sys_exit(int status) {
+    struct thread *proc = process_current();
+
+    if (!proc->killed) {
+        proc->exit_status = status;
+        printf("%s: exit(%d)\n", proc->name, status);
+    }
+    if (proc != thread_current()) {
+        /* 리더와 나머지 스레드는 사용자 모드로 돌아가는 길에 죽습니다. */
+        proc->killed = true;
+        futex_wake_process(proc);
+    }
+    thread_exit();
+}
+
+/* 실행 중인 스레드만 끝냅니다. 프로세스의 첫 스레드라면 exit()과 같습니다. */
+static void sys_thread_exit(int status) {
+    if (process_current() == thread_current()) sys_exit(status);
     thread_current()->exit_status = status;
-    printf("%s: exit(%d)\n", thread_current()->name, status);
     thread_exit();
 }
 
+/* futex 주소는 정렬된 int를 가리켜야 합니다. 아니면 프로세스를 끝냅니다. */
+static void check_futex_address(void *addr) {
+    if ((uintptr_t)addr % sizeof(int) != 0) sys_exit(-1);
+    check_address(addr);
+}
+
 pid_t sys_fork(const char *thread_name, struct intr_frame *if_) {
     return process_fork(thread_name, if_);
 }
@@ -74,17 +100,13 @@ int sys_exec(const char *file) {
 
 bool sys_create(const char *file, unsigned initial_size) {
     if (file == NULL) sys_exit(-1);
-    // lock_acquire(&filesys_lock);
     bool result = (filesys_create(file, initial_size));
-    // lock_release(&filesys_lock);
     return result;
 }
 
 bool sys_remove(const char *file) {
     if (file == NULL) sys_exit(-1);
-    // lock_acquire(&filesys_lock);
     bool result = (filesys_remove(file));
-    // lock_release(&filesys_lock);
     return result;
 }
 
@@ -96,20 +118,20 @@ int sys_open(const char *file) {
     if (f == NULL) {
         return -1;
     }
-    if (thread_current()->next_fd_idx >= 128) {
+    if (process_current()->next_fd_idx >= 128) {
         file_close(f);
         return -1;
     }
 
-    thread_current()->fd_table[thread_current()->next_fd_idx] = f;
-    return thread_current()->next_fd_idx++;
+    process_current()->fd_table[process_current()->next_fd_idx] = f;
+    return process_current()->next_fd_idx++;
 }
 
 int sys_filesize(int fd) {
-    if (fd < 0 || fd >= thread_current()->next_fd_idx) {
+    if (fd < 0 || fd >= process_current()->next_fd_idx) {
         return -1;
     }
-    struct file *f = thread_current()->fd_table[fd];
+    struct file *f = process_current()->fd_table[fd];
     if (f == NULL) {
         return -1;
     }
@@ -117,15 +139,15 @@ int sys_filesize(int fd) {
 }
 
 void sys_close(int fd) {
-    if (fd < 0 || fd >= thread_current()->next_fd_idx) {
+    if (fd < 0 || fd >= process_current()->next_fd_idx) {
         return;
     }
-    struct file *f = thread_current()->fd_table[fd];
+    struct file *f = process_current()->fd_table[fd];
     if (f == NULL) {
         return;
     }
     file_close(f);
-    thread_current()->fd_table[fd] = NULL;
+    process_current()->fd_table[fd] = NULL;
 }
 
 int sys_read(int fd, void *buffer, unsigned size) {
@@ -147,13 +169,12 @@ int sys_read(int fd, void *buffer, unsigned size) {
             buffer++;
         }
     } else if (2 <= fd && fd < 128) {
-        struct file *curr_file = thread_current()->fd_table[fd];
+        struct file *curr_file = process_current()->fd_table[fd];
         if (curr_file == NULL) return -1;
 
-        lock_acquire(&filesys_lock);  // lock 걸기
-        off_t read_result = file_read(curr_file, buffer, size);
-        lock_release(&filesys_lock);  // lock 풀기
-        return read_result;
+        /* 전역 락 없이 읽습니다. inode의 rwlock이 같은 파일에 대한 쓰기만
+         * 막으므로 다른 파일의 I/O와 겹쳐 진행됩니다. */
+        return file_read(curr_file, buffer, size);
     } else {
         return -1;
     }
@@ -165,12 +186,9 @@ int sys_write(int fd, const void *buffer, unsigned size) {
         return size;
 
     } else if (2 <= fd && fd < 128) {
-        struct file *curr_file = thread_current()->fd_table[fd];
+        struct file *curr_file = process_current()->fd_table[fd];
         if (curr_file == NULL) return -1;
-        lock_acquire(&filesys_lock);  // lock 걸기
-        off_t write_result = file_write(curr_file, buffer, size);
-        lock_release(&filesys_lock);  // lock 풀기
-        return write_result;
+        return file_write(curr_file, buffer, size);
     } else {
         return -1;
     }
@@ -192,7 +210,7 @@ void sys_seek(int fd, unsigned position) {
 /* 열린 파일의 위치(offset)를 알려주는 시스템 콜
    성공 시 파일의 위치(offset)를 반환, 실패 시 -1 반환 */
 unsigned sys_tell(int fd) {
-    if (fd < 0 || fd >= thread_current()->next_fd_idx) {
+    if (fd < 0 || fd >= process_current()->next_fd_idx) {
         return -1;
     }
 
@@ -205,7 +223,7 @@ unsigned sys_tell(int fd) {
 
 /* 파일 객체(struct file)를 검색하는 함수 */
 struct file *process_get_file(int fd) {
-    struct thread *cur = thread_current();
+    struct thread *cur = process_current();
     if (fd < 0 || fd >= cur->next_fd_idx) {
         return NULL;
     }
@@ -276,9 +294,34 @@ void syscall_handler(struct intr_frame *f) {
         case SYS_CLOSE:
             sys_close(f->R.rdi);
             break;
+        case SYS_CLONE:
+            check_address((void *)f->R.rdi);
+            check_address((void *)f->R.rdx);
+            f->R.rax = process_clone(f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10);
+            break;
+        case SYS_THREAD_EXIT:
+            sys_thread_exit(f->R.rdi);
+            break;
+        case SYS_THREAD_JOIN:
+            f->R.rax = process_thread_join(f->R.rdi);
+            break;
+        case SYS_FUTEX_WAIT:
+            check_futex_address((void *)f->R.rdi);
+            f->R.rax = futex_wait((const int *)f->R.rdi, f->R.rsi);
+            break;
+        case SYS_FUTEX_WAKE:
+            check_futex_address((void *)f->R.rdi);
+            f->R.rax = futex_wake((const int *)f->R.rdi, f->R.rsi);
+            break;
+        case SYS_SET_TLS:
+            process_set_tls(f->R.rdi);
+            break;
 
         default:
             sys_exit(-1);
             break;
     }
+
+    /* 다른 스레드가 프로세스를 끝내는 중이면 사용자 모드로 돌아가지 않습니다. */
+    process_exit_if_killed();
 }
\ No newline at end of file
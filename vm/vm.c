@@ -4,9 +4,16 @@
 
 #include "include/lib/kernel/hash.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
+#include "userprog/process.h"
 #include "vm/inspect.h"
 
 struct list frame_table;
+
+/* Caches for the page and frame structures, one per user page. */
+static struct kmem_cache page_cache;
+static struct kmem_cache frame_cache;
+
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
 void vm_init(void) {
@@ -19,6 +26,8 @@ void vm_init(void) {
     register_inspect_intr();
     /* DO NOT MODIFY UPPER LINES. */
     /* TODO: Your code goes here. */
+    kmem_cache_init(&page_cache, "page", sizeof(struct page), NULL);
+    kmem_cache_init(&frame_cache, "frame", sizeof(struct frame), NULL);
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -47,15 +56,19 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage,
                                     void *aux) {
     ASSERT(VM_TYPE(type) != VM_UNINIT)
 
-    struct supplemental_page_table *spt = &thread_current()->spt;
+    struct supplemental_page_table *spt = &process_current()->spt;
+    bool succ = false;
 
+    // 같은 프로세스의 스레드들이 spt를 함께 쓰므로 찾기와 넣기를 락 안에서 함.
+    lock_acquire(&spt->lock);
     /* Check wheter the upage is already occupied or not. */
     if (spt_find_page(spt, upage) == NULL) {
         /* TODO: Create the page, fetch the initialier according to the VM type,
          * TODO: and then create "uninit" page struct by calling uninit_new. You
          * TODO: should modify the field after calling the uninit_new. */
 
-        struct page *new_page = (struct page *)malloc(sizeof(struct page));
+        struct page *new_page = kmem_cache_alloc(&page_cache);
+        if (new_page == NULL) goto err;
         typedef bool (*page_initializer)(struct page *, enum vm_type,
                                          void *kva);
         page_initializer new_initializer = NULL;
@@ -71,10 +84,11 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage,
 
         /* TODO: Insert the page into the spt. */
         new_page->writable = writable;
-        return spt_insert_page(spt, new_page);
+        succ = spt_insert_page(spt, new_page);
     }
 err:
-    return false;
+    lock_release(&spt->lock);
+    return succ;
 }
 
 /* Find VA from spt and return page. On error, return NULL. */
@@ -83,17 +97,14 @@ err:
 실패했을 경우 NULL를 반환합니다.*/
 struct page *spt_find_page(struct supplemental_page_table *spt UNUSED,
                            void *va UNUSED) {
-    struct page *page = NULL;
     /* TODO: Fill this function. */
-    // struct page temp_page;
-    page = (struct page *)malloc(sizeof(struct page));
+    // 검색 키로만 쓰므로 스택에 두면 충분함 (fault 경로에서 malloc 없음).
+    struct page key;
     struct hash_elem *h_e;
 
-    page->va = pg_round_down(va);  // va를 페이지 경계로 내림하는 기능
-
-    h_e = hash_find(&spt->hash_table, &page->hash_elem);
+    key.va = pg_round_down(va);  // va를 페이지 경계로 내림하는 기능
 
-    free(page);
+    h_e = hash_find(&spt->hash_table, &key.hash_elem);
 
     if (h_e == NULL) {
         return NULL;
@@ -110,11 +121,10 @@ bool spt_insert_page(struct supplemental_page_table *spt UNUSED,
                      struct page *page UNUSED) {
     int succ = false;
     /* TODO: Fill this function. */
-    void *va_want_push = page->va;
-    if (spt_find_page(spt, va_want_push) == NULL) {
-        hash_insert(&spt->hash_table, &page->hash_elem);
-        succ = true;
-    }
+    // hash_insert()는 같은 va가 이미 있거나 메모리가 모자라 테이블을
+    // 키우지 못하면 넣지 않고 false를 돌려주므로 따로 spt_find_page()로
+    // 한 번 더 찾을 필요가 없음.
+    succ = hash_insert(&spt->hash_table, &page->hash_elem, NULL);
     return succ;
 }
 
@@ -146,7 +156,10 @@ static struct frame *vm_evict_frame(void) {
  * space.*/
 static struct frame *vm_get_frame(void) {
     struct frame *frame = NULL;
-    frame = (struct frame *)malloc(sizeof(struct frame));
+    frame = kmem_cache_alloc(&frame_cache);
+    if (frame == NULL) {
+        PANIC("cannot allocate frame");
+    }
 
     /* TODO: Fill this function. */
     frame->page = NULL;
@@ -173,31 +186,45 @@ static bool vm_handle_wp(struct page *page UNUSED) {}
 bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED,
                          bool user UNUSED, bool write UNUSED,
                          bool not_present UNUSED) {
-    struct supplemental_page_table *spt UNUSED = &thread_current()->spt;
+    struct supplemental_page_table *spt UNUSED = &process_current()->spt;
     struct page *page = NULL;
+    bool succ = false;
     /* TODO: Validate the fault */
     /* TODO: Your code goes here */
+    // page fault 처리 중에는 인터럽트가 켜져 있어 선점될 수 있으므로, 같은
+    // 페이지에 동시에 fault 난 스레드들이 찾기, 프레임 할당, 채우기를 한 번에
+    // 한 스레드씩 하도록 spt 락을 잡음.
+    lock_acquire(&spt->lock);
     page = spt_find_page(spt, addr);
-    return vm_do_claim_page(page);
+    if (page != NULL) {
+        // 먼저 들어온 스레드가 이미 채우고 매핑했다면 다시 접근하면 됨.
+        succ = page->frame != NULL || vm_do_claim_page(page);
+    }
+    lock_release(&spt->lock);
+    return succ;
 }
 
 /* Free the page.
  * DO NOT MODIFY THIS FUNCTION. */
 void vm_dealloc_page(struct page *page) {
     destroy(page);
-    free(page);
+    kmem_cache_free(&page_cache, page);
 }
 
 /* Claim the page that allocate on VA. */
 bool vm_claim_page(void *va UNUSED) {
     struct page *page = NULL;
     /* TODO: Fill this function */
-    page = spt_find_page(&thread_current()->spt, va);
-    if (page == NULL) {
-        return false;
-    }
+    struct supplemental_page_table *spt = &process_current()->spt;
+    bool succ = false;
 
-    return vm_do_claim_page(page);
+    lock_acquire(&spt->lock);
+    page = spt_find_page(spt, va);
+    if (page != NULL) {
+        succ = page->frame != NULL || vm_do_claim_page(page);
+    }
+    lock_release(&spt->lock);
+    return succ;
 }
 
 /* Claim the PAGE and set up the mmu. */
@@ -208,17 +235,22 @@ static bool vm_do_claim_page(struct page *page) {
     frame->page = page;   // 여기서  frame에 page를 할당.
     page->frame = frame;  // 서로가 서로를 할당하는 모습
 
-    bool set_page = false;
     /* TODO: Insert page table entry to map page's VA to frame's PA. */
+    // 프레임을 다 채운 뒤에 매핑해야, 같은 프로세스의 다른 스레드가 채워지지
+    // 않은 페이지를 읽지 않음.
     if (!pml4_get_page(thread_current()->pml4,
-                       page->va)) {  // NULL이어야 기존것이 아님.
-        set_page = pml4_set_page(thread_current()->pml4, page->va, frame->kva,
-                                 page->writable);
-        if (set_page) {
-            return swap_in(page, frame->kva);
-        }
+                       page->va) &&  // NULL이어야 기존것이 아님.
+        swap_in(page, frame->kva) &&
+        pml4_set_page(thread_current()->pml4, page->va, frame->kva,
+                      page->writable)) {
+        return true;
     }
 
+    // 실패하면 프레임을 되돌려 다음 fault에서 다시 시도할 수 있게 함.
+    page->frame = NULL;
+    list_remove(&frame->frame_elem);
+    palloc_free_page(frame->kva);
+    kmem_cache_free(&frame_cache, frame);
     return false;
 }
 
@@ -232,12 +264,13 @@ bool page_less(const struct hash_elem *a, const struct hash_elem *b,
 /* Returns a hash value for page p. */
 uint64_t page_hash(const struct hash_elem *h, void *aux UNUSED) {
     const struct page *p = hash_entry(h, struct page, hash_elem);
-    return hash_bytes(&p->va, sizeof p->va);
+    return hash_u64((uint64_t)p->va);
 }
 
 /* Initialize new supplemental page table */
 void supplemental_page_table_init(struct supplemental_page_table *spt UNUSED) {
     hash_init(&spt->hash_table, page_hash, page_less, NULL);
+    lock_init(&spt->lock);
 }
 
 /* Copy supplemental page table from src to dst */